@@ -0,0 +1,131 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/*
+  Example plugin: the d-pad and face buttons as keyboard keys and the
+  pen or finger as a scroll wheel. Build with
+
+    cc -shared -fPIC -I src/plugin -o example_plugin.so plugins/example_plugin.c
+
+  and run with
+
+    udraw-driver --plugin ./example_plugin.so:3
+
+  the optional argument is the scroll speed.
+*/
+
+#include <linux/input-event-codes.h>
+#include <stdlib.h>
+
+#include "udraw_plugin.h"
+
+struct example
+{
+  udraw_host* host;
+  udraw_host_api const* api;
+  int speed;
+
+  udraw_emitter* keys[8];
+  udraw_emitter* wheel;
+
+  int touching;
+  int last_y;
+};
+
+static int const key_codes[8] = {
+  KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT,
+  KEY_ENTER, KEY_ESC, KEY_SPACE, KEY_TAB,
+};
+
+static uint16_t const key_buttons[8] = {
+  UDRAW_BUTTON_UP, UDRAW_BUTTON_DOWN, UDRAW_BUTTON_LEFT, UDRAW_BUTTON_RIGHT,
+  UDRAW_BUTTON_CROSS, UDRAW_BUTTON_CIRCLE, UDRAW_BUTTON_SQUARE, UDRAW_BUTTON_TRIANGLE,
+};
+
+static void* example_create(udraw_host* host, udraw_host_api const* api, char const* args)
+{
+  struct example* self = calloc(1, sizeof(struct example));
+  if (!self) {
+    return NULL;
+  }
+
+  self->host = host;
+  self->api = api;
+  self->speed = (args[0] != '\0') ? atoi(args) : 1;
+  return self;
+}
+
+static int example_init(void* data)
+{
+  struct example* self = data;
+
+  udraw_device* keyboard = self->api->create_device(self->host, UDRAW_DEVICE_KEYBOARD, "uDraw Example Plugin (keyboard)");
+  udraw_device* mouse = self->api->create_device(self->host, UDRAW_DEVICE_MOUSE, "uDraw Example Plugin (mouse)");
+  if (!keyboard || !mouse) {
+    return -1;
+  }
+
+  for (int i = 0; i < 8; ++i) {
+    self->keys[i] = self->api->add_key(keyboard, key_codes[i]);
+    if (!self->keys[i]) {
+      return -1;
+    }
+  }
+
+  self->wheel = self->api->add_rel(mouse, REL_WHEEL);
+  return self->wheel ? 0 : -1;
+}
+
+static void example_receive(void* data, udraw_sample const* sample)
+{
+  struct example* self = data;
+
+  for (int i = 0; i < 8; ++i) {
+    self->api->send(self->keys[i], (sample->buttons & key_buttons[i]) ? 1 : 0);
+  }
+
+  int const touching = (sample->mode == UDRAW_MODE_PEN || sample->mode == UDRAW_MODE_TOUCH);
+  if (touching && self->touching) {
+    int const steps = (self->last_y - sample->y) * self->speed / 64;
+    if (steps != 0) {
+      self->api->send(self->wheel, steps);
+      self->last_y = sample->y;
+    }
+  } else if (touching) {
+    self->last_y = sample->y;
+  }
+  self->touching = touching;
+}
+
+static void example_destroy(void* data)
+{
+  free(data);
+}
+
+udraw_plugin const* udraw_plugin_entry(void)
+{
+  static udraw_plugin const plugin = {
+    UDRAW_PLUGIN_ABI_VERSION,
+    "example",
+    &example_create,
+    &example_init,
+    &example_receive,
+    &example_destroy,
+  };
+  return &plugin;
+}
+
+/* EOF */
@@ -0,0 +1,126 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "accel_filter.hpp"
+
+#include <cmath>
+
+namespace udraw {
+
+namespace {
+
+int const FRACTION_BITS = 8;
+
+/** the filter moves 1/4 of the way to each new average */
+int const SMOOTHING_SHIFT = 2;
+
+int to_degrees(int a, int b)
+{
+  return static_cast<int>(std::lround(std::atan2(static_cast<double>(a), static_cast<double>(b)) * 180.0 / M_PI));
+}
+
+} // namespace
+
+AccelFilter::AccelFilter() :
+  m_count(0),
+  m_sum_x(0),
+  m_sum_y(0),
+  m_sum_z(0),
+  m_filtered_x(0),
+  m_filtered_y(0),
+  m_filtered_z(0),
+  m_primed(false),
+  m_last_x(0),
+  m_last_y(0),
+  m_last_z(0),
+  m_tilt_x(0),
+  m_tilt_y(0),
+  m_up_sign(0),
+  m_flipped(false),
+  m_flip_steps(0)
+{
+}
+
+bool
+AccelFilter::step()
+{
+  static_assert((DECIMATION & (DECIMATION - 1)) == 0, "DECIMATION must be a power of two");
+
+  // the average of the summed up reports in fixed point
+  int const avg_x = m_sum_x * (1 << FRACTION_BITS) / DECIMATION;
+  int const avg_y = m_sum_y * (1 << FRACTION_BITS) / DECIMATION;
+  int const avg_z = m_sum_z * (1 << FRACTION_BITS) / DECIMATION;
+  m_sum_x = m_sum_y = m_sum_z = 0;
+  m_count = 0;
+
+  if (!m_primed) {
+    m_filtered_x = avg_x;
+    m_filtered_y = avg_y;
+    m_filtered_z = avg_z;
+    m_primed = true;
+  } else {
+    m_filtered_x += (avg_x - m_filtered_x) / (1 << SMOOTHING_SHIFT);
+    m_filtered_y += (avg_y - m_filtered_y) / (1 << SMOOTHING_SHIFT);
+    m_filtered_z += (avg_z - m_filtered_z) / (1 << SMOOTHING_SHIFT);
+  }
+
+  int const x = m_filtered_x / (1 << FRACTION_BITS);
+  int const y = m_filtered_y / (1 << FRACTION_BITS);
+  int const z = m_filtered_z / (1 << FRACTION_BITS);
+
+  // Turned upside down means gravity pulls towards the other edge.
+  // Only counts when the tablet is at least 30 degrees off flat,
+  // y^2 > (x^2 + y^2 + z^2) / 4, with no trigonometry needed. The
+  // first steep reading defines which way is up, the axis orientation
+  // of the sensor doesn't matter that way.
+  int64_t const yy = int64_t(y) * y;
+  int64_t const length2 = int64_t(x) * x + yy + int64_t(z) * z;
+  bool const steep = 4 * yy > length2;
+  int const sign = (y < 0) ? -1 : 1;
+  if (steep && m_up_sign == 0) {
+    m_up_sign = sign;
+  }
+  bool const other_way = steep && ((sign != m_up_sign) != m_flipped);
+
+  bool changed = false;
+  m_flip_steps = other_way ? m_flip_steps + 1 : 0;
+  if (m_flip_steps >= FLIP_STEPS) {
+    m_flipped = !m_flipped;
+    m_flip_steps = 0;
+    changed = true;
+  }
+
+  if (x == m_last_x && y == m_last_y && z == m_last_z) {
+    return changed;
+  }
+  m_last_x = x;
+  m_last_y = y;
+  m_last_z = z;
+
+  int const tilt_x = to_degrees(x, std::abs(z));
+  int const tilt_y = to_degrees(y, std::abs(z));
+  if (tilt_x != m_tilt_x || tilt_y != m_tilt_y) {
+    m_tilt_x = tilt_x;
+    m_tilt_y = tilt_y;
+    changed = true;
+  }
+
+  return changed;
+}
+
+} // namespace udraw
+
+/* EOF */
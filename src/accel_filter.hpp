@@ -0,0 +1,97 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_UDRAW_ACCEL_FILTER_HPP
+#define HEADER_UDRAW_ACCEL_FILTER_HPP
+
+#include <cstdint>
+
+namespace udraw {
+
+/** Turns the accelerometer stream into tilt angles and detects when the
+    tablet is turned upside down. Reports are summed up and only every
+    DECIMATION-th one runs the low-pass filter, the angles are only
+    recomputed when the filtered values change. */
+class AccelFilter
+{
+public:
+  /** reports per filter step */
+  static constexpr int DECIMATION = 8;
+
+  /** filter steps the tablet has to stay turned before it counts as
+      flipped, about half a second at 100 reports per second */
+  static constexpr int FLIP_STEPS = 6;
+
+public:
+  AccelFilter();
+
+  /** Returns true when tilt_x(), tilt_y() or flipped() changed */
+  bool add(int accel_x, int accel_y, int accel_z)
+  {
+    m_sum_x += accel_x;
+    m_sum_y += accel_y;
+    m_sum_z += accel_z;
+
+    if (++m_count < DECIMATION) {
+      return false;
+    }
+    return step();
+  }
+
+  /** tilt of the tablet in degrees, -90 to 90, relative to the
+      orientation it is used in */
+  int tilt_x() const { return m_flipped ? -m_tilt_x : m_tilt_x; }
+  int tilt_y() const { return m_flipped ? -m_tilt_y : m_tilt_y; }
+
+  /** the tablet is turned by 180 degrees from the way it was first
+      held at an angle */
+  bool flipped() const { return m_flipped; }
+
+private:
+  bool step();
+
+private:
+  int m_count;
+  int m_sum_x;
+  int m_sum_y;
+  int m_sum_z;
+
+  /** filtered acceleration in 24.8 fixed point */
+  int m_filtered_x;
+  int m_filtered_y;
+  int m_filtered_z;
+  bool m_primed;
+
+  /** integer part of the filtered values the angles were computed for */
+  int m_last_x;
+  int m_last_y;
+  int m_last_z;
+
+  int m_tilt_x;
+  int m_tilt_y;
+
+  /** sign of the y acceleration in the normal orientation, 0 until
+      the tablet was first held at an angle */
+  int m_up_sign;
+  bool m_flipped;
+  int m_flip_steps;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
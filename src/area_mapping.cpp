@@ -0,0 +1,148 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "area_mapping.hpp"
+
+#include <stdio.h>
+
+#include <cmath>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+namespace udraw {
+
+namespace {
+
+int64_t to_fixed(double value)
+{
+  return static_cast<int64_t>(std::llround(value * (1 << AreaMapping::FRACTION_BITS)));
+}
+
+} // namespace
+
+Rect rect_from_string(std::string const& text)
+{
+  Rect rect = {0, 0, 0, 0};
+  int end = -1;
+
+  if (sscanf(text.c_str(), "%dx%d%n+%d+%d%n", &rect.width, &rect.height, &end, &rect.x, &rect.y, &end) < 2 ||
+      end != static_cast<int>(text.size()) ||
+      rect.empty() || rect.x < 0 || rect.y < 0)
+  {
+    throw std::runtime_error(fmt::format("invalid geometry '{}', expected WIDTHxHEIGHT[+X+Y]", text));
+  }
+
+  return rect;
+}
+
+AreaMapping::AreaMapping(Rect input, Rect output, int screen_width, int screen_height,
+                         int rotation, bool keep_aspect) :
+  m_input(input),
+  m_output(output),
+  m_screen_width(screen_width),
+  m_screen_height(screen_height),
+  m_scale_x(),
+  m_scale_y(),
+  m_xx(),
+  m_xy(),
+  m_x0(),
+  m_yx(),
+  m_yy(),
+  m_y0()
+{
+  if (m_input.empty() || m_output.empty()) {
+    throw std::runtime_error("tablet area and output must not be empty");
+  }
+
+  if (m_output.x + m_output.width > m_screen_width ||
+      m_output.y + m_output.height > m_screen_height) {
+    throw std::runtime_error(fmt::format("output {}x{}+{}+{} is outside of the {}x{} screen",
+                                         m_output.width, m_output.height, m_output.x, m_output.y,
+                                         m_screen_width, m_screen_height));
+  }
+
+  // screen position (s, t) in [0, 1] for the normalized tablet
+  // position (u, v), as s = su * u + sv * v + s0
+  double su, sv, s0, tu, tv, t0;
+  switch (rotation)
+  {
+    case 0:   su =  1; sv =  0; s0 = 0; tu =  0; tv =  1; t0 = 0; break;
+    case 90:  su =  0; sv = -1; s0 = 1; tu =  1; tv =  0; t0 = 0; break;
+    case 180: su = -1; sv =  0; s0 = 1; tu =  0; tv = -1; t0 = 1; break;
+    case 270: su =  0; sv =  1; s0 = 0; tu = -1; tv =  0; t0 = 1; break;
+    default:
+      throw std::runtime_error(fmt::format("invalid rotation {}, must be 0, 90, 180 or 270", rotation));
+  }
+
+  bool const rotated = (rotation == 90 || rotation == 270);
+
+  if (keep_aspect)
+  {
+    // surface units are square, the screen is assumed to have square
+    // pixels as well
+    int extent_x = rotated ? m_input.height : m_input.width;
+    int extent_y = rotated ? m_input.width : m_input.height;
+    if (int64_t(extent_x) * m_output.height > int64_t(extent_y) * m_output.width) {
+      extent_x = static_cast<int>(int64_t(extent_y) * m_output.width / m_output.height);
+    } else {
+      extent_y = static_cast<int>(int64_t(extent_x) * m_output.height / m_output.width);
+    }
+
+    int const width = rotated ? extent_y : extent_x;
+    int const height = rotated ? extent_x : extent_y;
+    m_input.x += (m_input.width - width) / 2;
+    m_input.y += (m_input.height - height) / 2;
+    m_input.width = width;
+    m_input.height = height;
+  }
+
+  double const ow = m_output.width;
+  double const oh = m_output.height;
+  double const iw = m_input.width;
+  double const ih = m_input.height;
+  double const ix = m_input.x;
+  double const iy = m_input.y;
+
+  m_scale_x = ow / (rotated ? ih : iw);
+  m_scale_y = oh / (rotated ? iw : ih);
+
+  // half a unit in the offsets turns the truncating shift in map()
+  // into rounding
+  double const half = 0.5;
+  m_xx = to_fixed(ow * su / iw);
+  m_xy = to_fixed(ow * sv / ih);
+  m_x0 = to_fixed(m_output.x + ow * (s0 - su * ix / iw - sv * iy / ih) + half);
+  m_yx = to_fixed(oh * tu / iw);
+  m_yy = to_fixed(oh * tv / ih);
+  m_y0 = to_fixed(m_output.y + oh * (t0 - tu * ix / iw - tv * iy / ih) + half);
+}
+
+int
+AreaMapping::resolution_x(int input_resolution) const
+{
+  return static_cast<int>(std::lround(input_resolution * m_scale_x));
+}
+
+int
+AreaMapping::resolution_y(int input_resolution) const
+{
+  return static_cast<int>(std::lround(input_resolution * m_scale_y));
+}
+
+} // namespace udraw
+
+/* EOF */
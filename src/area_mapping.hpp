@@ -0,0 +1,96 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_UDRAW_AREA_MAPPING_HPP
+#define HEADER_UDRAW_AREA_MAPPING_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+namespace udraw {
+
+struct Rect
+{
+  int x;
+  int y;
+  int width;
+  int height;
+
+  bool empty() const { return width <= 0 || height <= 0; }
+};
+
+/** Parse an X11 style geometry, WIDTHxHEIGHT[+X+Y] */
+Rect rect_from_string(std::string const& text);
+
+/** Maps a rectangle of the tablet surface onto a region of the screen
+    with an affine transform in 16.16 fixed point, computed once at
+    startup. The output coordinates range over the whole screen, so the
+    abs ranges of the device can be advertised as its resolution. */
+class AreaMapping
+{
+public:
+  static constexpr int FRACTION_BITS = 16;
+
+public:
+  /** \a rotation is how far the tablet is turned clockwise, in
+      degrees, one of 0, 90, 180 or 270. With \a keep_aspect the
+      \a input area is shrunk around its center to the aspect ratio of
+      \a output, otherwise it is stretched. */
+  AreaMapping(Rect input, Rect output, int screen_width, int screen_height,
+              int rotation, bool keep_aspect);
+
+  void map(int x, int y, int& out_x, int& out_y) const
+  {
+    int64_t const sx = (m_xx * x + m_xy * y + m_x0) >> FRACTION_BITS;
+    int64_t const sy = (m_yx * x + m_yy * y + m_y0) >> FRACTION_BITS;
+    out_x = static_cast<int>(std::clamp<int64_t>(sx, m_output.x, m_output.x + m_output.width));
+    out_y = static_cast<int>(std::clamp<int64_t>(sy, m_output.y, m_output.y + m_output.height));
+  }
+
+  int screen_width() const { return m_screen_width; }
+  int screen_height() const { return m_screen_height; }
+
+  /** The tablet resolution in units per mm scaled to the output */
+  int resolution_x(int input_resolution) const;
+  int resolution_y(int input_resolution) const;
+
+  /** the surface area that is actually mapped, after the aspect lock */
+  Rect input() const { return m_input; }
+
+private:
+  Rect m_input;
+  Rect m_output;
+  int m_screen_width;
+  int m_screen_height;
+
+  /** output units per input unit along each screen axis */
+  double m_scale_x;
+  double m_scale_y;
+
+  int64_t m_xx;
+  int64_t m_xy;
+  int64_t m_x0;
+  int64_t m_yx;
+  int64_t m_yy;
+  int64_t m_y0;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -0,0 +1,218 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "async_log.hpp"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <fmt/args.h>
+#include <fmt/format.h>
+
+namespace udraw {
+namespace async_log {
+
+std::atomic<bool> g_enabled(false);
+
+namespace {
+
+struct Writer
+{
+  /** protects buffers, taken once per thread on its first message */
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  std::thread thread;
+  int wakeup_fd = -1;
+  int quit_fd = -1;
+  /** set by the first message after the writer went to sleep, so a
+      burst of messages costs a single wakeup */
+  std::atomic<bool> pending{false};
+};
+
+Writer g_writer;
+
+void write_records()
+{
+  std::vector<ThreadBuffer*> buffers;
+  {
+    std::lock_guard<std::mutex> lock(g_writer.mutex);
+    for (auto const& buffer : g_writer.buffers) {
+      buffers.push_back(buffer.get());
+    }
+  }
+
+  for (ThreadBuffer* buffer : buffers) {
+    buffer->drain([](Record const& record) {
+      write(record);
+    });
+  }
+}
+
+void run_writer()
+{
+  pollfd fds[2];
+  fds[0].fd = g_writer.wakeup_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = g_writer.quit_fd;
+  fds[1].events = POLLIN;
+
+  while (true)
+  {
+    int const ret = poll(fds, 2, -1);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      log_error("poll() failed: {}", strerror(errno));
+      return;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      return;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      uint64_t count;
+      if (read(g_writer.wakeup_fd, &count, sizeof(count)) != sizeof(count)) {
+        continue;
+      }
+
+      // clear before draining, a message committed after the drain
+      // looked at its ring sets it again and wakes us up
+      g_writer.pending.exchange(false, std::memory_order_acq_rel);
+      write_records();
+    }
+  }
+}
+
+} // namespace
+
+ThreadBuffer& thread_buffer()
+{
+  thread_local ThreadBuffer* t_buffer = nullptr;
+
+  if (!t_buffer) {
+    std::lock_guard<std::mutex> lock(g_writer.mutex);
+    g_writer.buffers.emplace_back(std::make_unique<ThreadBuffer>());
+    t_buffer = g_writer.buffers.back().get();
+  }
+
+  return *t_buffer;
+}
+
+void notify()
+{
+  if (!g_writer.pending.exchange(true, std::memory_order_acq_rel)) {
+    uint64_t const one = 1;
+    if (::write(g_writer.wakeup_fd, &one, sizeof(one)) != sizeof(one)) {
+      g_writer.pending.store(false, std::memory_order_relaxed);
+    }
+  }
+}
+
+void write(Record const& record)
+{
+  fmt::dynamic_format_arg_store<fmt::format_context> store;
+  for (uint8_t i = 0; i < record.argc; ++i) {
+    Arg const& arg = record.args[i];
+    switch (arg.type)
+    {
+      case Arg::Type::INT: store.push_back(arg.i); break;
+      case Arg::Type::UINT: store.push_back(arg.u); break;
+      case Arg::Type::DOUBLE: store.push_back(arg.d); break;
+      case Arg::Type::BOOL: store.push_back(arg.b); break;
+      case Arg::Type::STRING: store.push_back(fmt::string_view(record.strings + arg.s.offset, arg.s.length)); break;
+    }
+  }
+
+  std::string message;
+  try {
+    message = fmt::vformat(record.format, store);
+  } catch (std::exception const& err) {
+    log_error("invalid log format \"{}\": {}", record.format, err.what());
+    return;
+  }
+
+  switch (record.level)
+  {
+    case logmich::LogLevel::ERROR: log_error("{}", message); break;
+    case logmich::LogLevel::WARNING: log_warn("{}", message); break;
+    case logmich::LogLevel::INFO: log_info("{}", message); break;
+    default: log_debug("{}", message); break;
+  }
+}
+
+void start()
+{
+  g_writer.wakeup_fd = eventfd(0, EFD_CLOEXEC);
+  if (g_writer.wakeup_fd < 0) {
+    throw std::runtime_error(fmt::format("eventfd() failed: {}", strerror(errno)));
+  }
+
+  g_writer.quit_fd = eventfd(0, EFD_CLOEXEC);
+  if (g_writer.quit_fd < 0) {
+    close(g_writer.wakeup_fd);
+    throw std::runtime_error(fmt::format("eventfd() failed: {}", strerror(errno)));
+  }
+
+  g_writer.thread = std::thread(run_writer);
+  g_enabled.store(true, std::memory_order_relaxed);
+}
+
+void stop()
+{
+  if (!g_writer.thread.joinable()) {
+    return;
+  }
+
+  g_enabled.store(false, std::memory_order_relaxed);
+
+  uint64_t const one = 1;
+  if (::write(g_writer.quit_fd, &one, sizeof(one)) != sizeof(one)) {
+    log_error("failed to signal log writer thread: {}", strerror(errno));
+  }
+  g_writer.thread.join();
+
+  // messages that were queued while the writer shut down
+  write_records();
+
+  uint64_t dropped = 0;
+  for (auto const& buffer : g_writer.buffers) {
+    dropped += buffer->dropped();
+  }
+  if (dropped != 0) {
+    log_warn("log buffers overflowed, {} messages dropped", dropped);
+  }
+
+  close(g_writer.quit_fd);
+  close(g_writer.wakeup_fd);
+  g_writer.quit_fd = -1;
+  g_writer.wakeup_fd = -1;
+}
+
+} // namespace async_log
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,264 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_UDRAW_ASYNC_LOG_HPP
+#define HEADER_UDRAW_ASYNC_LOG_HPP
+
+/*
+  Logging for the input path. async_log_debug() and friends take a fmt
+  format string literal and its arguments, calls below the build-time
+  UDRAW_LOG_LEVEL compile to dead code that never evaluates them. Between
+  async_log::start() and async_log::stop() the arguments are copied
+  into a per-thread ring and formatted and written by a background
+  thread, so a slow terminal or journal never stalls the input thread.
+  When a ring is full the message is dropped and counted. Outside of
+  start() and stop() messages are formatted and logged right away.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <logmich/log.hpp>
+
+#define UDRAW_LOG_LEVEL_NONE    0
+#define UDRAW_LOG_LEVEL_ERROR   1
+#define UDRAW_LOG_LEVEL_WARNING 2
+#define UDRAW_LOG_LEVEL_INFO    3
+#define UDRAW_LOG_LEVEL_DEBUG   4
+
+#ifndef UDRAW_LOG_LEVEL
+#  define UDRAW_LOG_LEVEL UDRAW_LOG_LEVEL_DEBUG
+#endif
+
+namespace udraw {
+namespace async_log {
+
+struct Arg
+{
+  enum class Type : uint8_t { INT, UINT, DOUBLE, BOOL, STRING };
+
+  Type type;
+  union {
+    int64_t i;
+    uint64_t u;
+    double d;
+    bool b;
+    /** slice of Record::strings */
+    struct { uint16_t offset; uint16_t length; } s;
+  };
+};
+
+/** A log call with its arguments captured by value */
+struct Record
+{
+  static constexpr size_t MAX_ARGS = 6;
+  /** string arguments are truncated to what fits */
+  static constexpr size_t STRING_CAPACITY = 128;
+
+  logmich::LogLevel level;
+  /** a string literal, only the pointer is kept */
+  char const* format;
+  uint8_t argc;
+  uint16_t strings_used;
+  Arg args[MAX_ARGS];
+  char strings[STRING_CAPACITY];
+};
+
+inline void capture(Record& record, bool value)
+{
+  Arg& arg = record.args[record.argc++];
+  arg.type = Arg::Type::BOOL;
+  arg.b = value;
+}
+
+template<typename T>
+inline std::enable_if_t<std::is_integral<T>::value && std::is_signed<T>::value>
+capture(Record& record, T value)
+{
+  Arg& arg = record.args[record.argc++];
+  arg.type = Arg::Type::INT;
+  arg.i = value;
+}
+
+template<typename T>
+inline std::enable_if_t<std::is_integral<T>::value && std::is_unsigned<T>::value && !std::is_same<T, bool>::value>
+capture(Record& record, T value)
+{
+  Arg& arg = record.args[record.argc++];
+  arg.type = Arg::Type::UINT;
+  arg.u = value;
+}
+
+inline void capture(Record& record, double value)
+{
+  Arg& arg = record.args[record.argc++];
+  arg.type = Arg::Type::DOUBLE;
+  arg.d = value;
+}
+
+inline void capture(Record& record, std::string_view value)
+{
+  size_t const length = std::min(value.size(), Record::STRING_CAPACITY - record.strings_used);
+  memcpy(record.strings + record.strings_used, value.data(), length);
+
+  Arg& arg = record.args[record.argc++];
+  arg.type = Arg::Type::STRING;
+  arg.s.offset = record.strings_used;
+  arg.s.length = static_cast<uint16_t>(length);
+  record.strings_used = static_cast<uint16_t>(record.strings_used + length);
+}
+
+inline void capture(Record& record, char const* value) { capture(record, std::string_view(value)); }
+inline void capture(Record& record, std::string const& value) { capture(record, std::string_view(value)); }
+
+/** Single producer, single consumer ring, written by its thread and
+    drained by the background writer */
+class ThreadBuffer
+{
+public:
+  static constexpr size_t CAPACITY = 256;
+
+public:
+  ThreadBuffer() :
+    m_head(0),
+    m_tail(0),
+    m_dropped(0),
+    m_records()
+  {}
+
+  /** The slot to fill in, nullptr when the ring is full */
+  Record* claim()
+  {
+    uint64_t const head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) == CAPACITY) {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &m_records[head & (CAPACITY - 1)];
+  }
+
+  /** Hand the slot returned by claim() to the writer */
+  void commit()
+  {
+    m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  template<typename F>
+  void drain(F&& func)
+  {
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    uint64_t const head = m_head.load(std::memory_order_acquire);
+    for (; tail != head; ++tail) {
+      func(m_records[tail & (CAPACITY - 1)]);
+    }
+    m_tail.store(tail, std::memory_order_release);
+  }
+
+  uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+  alignas(64) std::atomic<uint64_t> m_head;
+  alignas(64) std::atomic<uint64_t> m_tail;
+  std::atomic<uint64_t> m_dropped;
+  Record m_records[CAPACITY];
+};
+
+extern std::atomic<bool> g_enabled;
+
+/** The calling thread's buffer, registered on first use */
+ThreadBuffer& thread_buffer();
+
+/** Wake the writer after a commit() */
+void notify();
+
+/** Format \a record and pass it to logmich */
+void write(Record const& record);
+
+template<size_t N, typename... Args>
+inline void log(logmich::LogLevel level, char const (&format)[N], Args const&... args)
+{
+  static_assert(sizeof...(Args) <= Record::MAX_ARGS, "too many log arguments");
+
+  if (logmich::g_logger.get_log_level() < level) {
+    return;
+  }
+
+  if (!g_enabled.load(std::memory_order_relaxed)) {
+    Record record;
+    record.level = level;
+    record.format = format;
+    record.argc = 0;
+    record.strings_used = 0;
+    (capture(record, args), ...);
+    write(record);
+    return;
+  }
+
+  ThreadBuffer& buffer = thread_buffer();
+  if (Record* record = buffer.claim()) {
+    record->level = level;
+    record->format = format;
+    record->argc = 0;
+    record->strings_used = 0;
+    (capture(*record, args), ...);
+    buffer.commit();
+    notify();
+  }
+}
+
+/** Start the background writer, messages are queued from now on */
+void start();
+
+/** Write out the queued messages, later ones are logged right away.
+    Call it once the threads that log are gone. */
+void stop();
+
+} // namespace async_log
+} // namespace udraw
+
+#if UDRAW_LOG_LEVEL >= UDRAW_LOG_LEVEL_ERROR
+#  define async_log_error(...) ::udraw::async_log::log(::logmich::LogLevel::ERROR, __VA_ARGS__)
+#else
+#  define async_log_error(...) do { if (false) ::udraw::async_log::log(::logmich::LogLevel::ERROR, __VA_ARGS__); } while (false)
+#endif
+
+#if UDRAW_LOG_LEVEL >= UDRAW_LOG_LEVEL_WARNING
+#  define async_log_warn(...) ::udraw::async_log::log(::logmich::LogLevel::WARNING, __VA_ARGS__)
+#else
+#  define async_log_warn(...) do { if (false) ::udraw::async_log::log(::logmich::LogLevel::WARNING, __VA_ARGS__); } while (false)
+#endif
+
+#if UDRAW_LOG_LEVEL >= UDRAW_LOG_LEVEL_INFO
+#  define async_log_info(...) ::udraw::async_log::log(::logmich::LogLevel::INFO, __VA_ARGS__)
+#else
+#  define async_log_info(...) do { if (false) ::udraw::async_log::log(::logmich::LogLevel::INFO, __VA_ARGS__); } while (false)
+#endif
+
+#if UDRAW_LOG_LEVEL >= UDRAW_LOG_LEVEL_DEBUG
+#  define async_log_debug(...) ::udraw::async_log::log(::logmich::LogLevel::DEBUG, __VA_ARGS__)
+#else
+#  define async_log_debug(...) do { if (false) ::udraw::async_log::log(::logmich::LogLevel::DEBUG, __VA_ARGS__); } while (false)
+#endif
+
+#endif
+
+/* EOF */
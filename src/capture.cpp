@@ -0,0 +1,148 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "capture.hpp"
+
+#include <errno.h>
+#include <string.h>
+
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+
+namespace udraw {
+
+namespace {
+
+char const capture_magic[8] = { 'U', 'D', 'R', 'A', 'W', 'C', 'A', 'P' };
+uint32_t const capture_version = 1;
+
+size_t const header_size = 16;
+size_t const record_header_size = 12;
+
+} // namespace
+
+CaptureWriter::CaptureWriter(std::string const& filename) :
+  m_filename(filename),
+  m_fp(fopen(filename.c_str(), "wbe"))
+{
+  if (!m_fp) {
+    throw std::runtime_error(fmt::format("{}: {}", m_filename, strerror(errno)));
+  }
+
+  uint8_t header[header_size] = {};
+  memcpy(header, capture_magic, sizeof(capture_magic));
+  memcpy(header + 8, &capture_version, sizeof(capture_version));
+
+  if (fwrite(header, sizeof(header), 1, m_fp) != 1) {
+    fclose(m_fp);
+    throw std::runtime_error(fmt::format("{}: write failed: {}", m_filename, strerror(errno)));
+  }
+}
+
+CaptureWriter::~CaptureWriter()
+{
+  if (m_fp) {
+    if (fclose(m_fp) != 0) {
+      log_error("{}: close failed: {}", m_filename, strerror(errno));
+    }
+  }
+}
+
+void
+CaptureWriter::write(int64_t timestamp, uint8_t const* data, size_t size)
+{
+  uint8_t header[record_header_size];
+  uint32_t const size32 = static_cast<uint32_t>(size);
+  memcpy(header, &timestamp, sizeof(timestamp));
+  memcpy(header + 8, &size32, sizeof(size32));
+
+  if (fwrite(header, sizeof(header), 1, m_fp) != 1 ||
+      (size != 0 && fwrite(data, size, 1, m_fp) != 1))
+  {
+    throw std::runtime_error(fmt::format("{}: write failed: {}", m_filename, strerror(errno)));
+  }
+}
+
+void
+CaptureWriter::close()
+{
+  FILE* fp = m_fp;
+  m_fp = nullptr;
+  if (fclose(fp) != 0) {
+    throw std::runtime_error(fmt::format("{}: close failed: {}", m_filename, strerror(errno)));
+  }
+}
+
+bool
+CaptureReader::is_capture(char const* magic)
+{
+  return memcmp(magic, capture_magic, sizeof(capture_magic)) == 0;
+}
+
+CaptureReader::CaptureReader(std::string const& filename) :
+  m_file(filename),
+  m_pos(header_size)
+{
+  uint32_t version = 0;
+  if (m_file.size() >= header_size) {
+    memcpy(&version, m_file.data() + 8, sizeof(version));
+  }
+
+  if (m_file.size() < header_size ||
+      !is_capture(reinterpret_cast<char const*>(m_file.data())) ||
+      version != capture_version)
+  {
+    throw std::runtime_error(fmt::format("{}: not a capture file", filename));
+  }
+}
+
+CaptureReader::~CaptureReader()
+{
+}
+
+bool
+CaptureReader::next(CaptureRecord& record)
+{
+  uint8_t const* const data = m_file.data();
+  size_t const file_size = m_file.size();
+
+  if (file_size - m_pos < record_header_size) {
+    return false;
+  }
+
+  uint32_t size;
+  memcpy(&record.timestamp, data + m_pos, sizeof(record.timestamp));
+  memcpy(&size, data + m_pos + 8, sizeof(size));
+
+  if (file_size - m_pos - record_header_size < size) {
+    log_warn("{}: truncated record at offset {}", m_file.filename(), m_pos);
+    m_pos = file_size;
+    return false;
+  }
+
+  record.data = data + m_pos + record_header_size;
+  record.size = size;
+  m_pos += record_header_size + size;
+
+  return true;
+}
+
+} // namespace udraw
+
+/* EOF */
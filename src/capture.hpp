@@ -0,0 +1,91 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_CAPTURE_HPP
+#define HEADER_UDRAW_CAPTURE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "mapped_file.hpp"
+#include "report_reader.hpp"
+
+namespace udraw {
+
+/*
+  Capture file format, all integers are little endian:
+
+    char     magic[8];    // "UDRAWCAP"
+    uint32_t version;     // 1
+    uint32_t reserved;
+
+  followed by records until the end of the file:
+
+    int64_t  timestamp;   // CLOCK_MONOTONIC in nanoseconds
+    uint32_t size;
+    uint8_t  data[size];
+*/
+
+class CaptureWriter
+{
+public:
+  CaptureWriter(std::string const& filename);
+  ~CaptureWriter();
+
+  void write(int64_t timestamp, uint8_t const* data, size_t size);
+  void close();
+
+private:
+  std::string m_filename;
+  FILE* m_fp;
+
+private:
+  CaptureWriter(const CaptureWriter&) = delete;
+  CaptureWriter& operator=(const CaptureWriter&) = delete;
+};
+
+/** Reads a capture file through mmap(), records are handed out without
+    copying and the file is never loaded into memory as a whole */
+class CaptureReader : public ReportReader
+{
+public:
+  /** \a magic are the first eight bytes of a file */
+  static bool is_capture(char const* magic);
+
+public:
+  CaptureReader(std::string const& filename);
+  ~CaptureReader() override;
+
+  /** \a record points into the mapping and stays valid as long as the reader */
+  bool next(CaptureRecord& record) override;
+
+private:
+  MappedFile m_file;
+  size_t m_pos;
+
+private:
+  CaptureReader(const CaptureReader&) = delete;
+  CaptureReader& operator=(const CaptureReader&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
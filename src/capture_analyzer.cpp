@@ -0,0 +1,389 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "capture_analyzer.hpp"
+
+#include <math.h>
+
+#include <algorithm>
+#include <memory>
+#include <ostream>
+
+#include <fmt/format.h>
+
+#include "report_reader.hpp"
+
+namespace udraw {
+
+namespace {
+
+char const* mode_name(int mode)
+{
+  switch (static_cast<UDrawDecoder::Mode>(mode))
+  {
+    case UDrawDecoder::Mode::NONE: return "none";
+    case UDrawDecoder::Mode::PEN: return "pen";
+    case UDrawDecoder::Mode::TOUCH: return "touch";
+    case UDrawDecoder::Mode::MULTITOUCH: return "multitouch";
+    case UDrawDecoder::Mode::UNKNOWN: return "unknown";
+  }
+  return "invalid";
+}
+
+/** nearest-rank percentile of a sorted series */
+int64_t percentile(std::vector<int64_t> const& sorted, double p)
+{
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t const rank = static_cast<size_t>(ceil(p / 100.0 * static_cast<double>(sorted.size())));
+  return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+double to_msec(double nsec)
+{
+  return nsec / 1000000.0;
+}
+
+} // namespace
+
+void
+RunningStats::add(double value)
+{
+  count += 1;
+  double const delta = value - mean;
+  mean += delta / static_cast<double>(count);
+  m2 += delta * (value - mean);
+  min = std::min(min, value);
+  max = std::max(max, value);
+}
+
+void
+RunningStats::merge(RunningStats const& other)
+{
+  if (other.count == 0) {
+    return;
+  }
+
+  uint64_t const total = count + other.count;
+  double const delta = other.mean - mean;
+  mean += delta * static_cast<double>(other.count) / static_cast<double>(total);
+  m2 += other.m2 + delta * delta * static_cast<double>(count) * static_cast<double>(other.count) / static_cast<double>(total);
+  count = total;
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+}
+
+double
+RunningStats::stddev() const
+{
+  return sqrt(variance());
+}
+
+CaptureAnalyzer::CaptureAnalyzer() :
+  m_reports(0),
+  m_rejected(),
+  m_have_last(false),
+  m_last_timestamp(0),
+  m_last_mode(UDrawDecoder::Mode::NONE),
+  m_intervals(),
+  m_mode_duration(),
+  m_mode_reports(),
+  m_segment_mode(UDrawDecoder::Mode::NONE),
+  m_segment_x(0),
+  m_segment_y(0),
+  m_segment_stats_x(),
+  m_segment_stats_y(),
+  m_noise_x(),
+  m_noise_y(),
+  m_stationary_segments(),
+  m_pressure_floor(),
+  m_accel_x(),
+  m_accel_y(),
+  m_accel_z(),
+  m_accel_magnitude()
+{
+}
+
+void
+CaptureAnalyzer::add(int64_t timestamp, uint8_t const* data, size_t size)
+{
+  UDrawDecoder::Error error;
+  std::optional<UDrawDecoder> const decoder = UDrawDecoder::parse(data, size, error);
+  if (!decoder) {
+    m_rejected[static_cast<size_t>(error)] += 1;
+    return;
+  }
+
+  m_reports += 1;
+
+  UDrawDecoder::Mode const mode = decoder->mode();
+  int const mode_idx = static_cast<int>(mode);
+
+  // the time until the next report is spent in the mode of this one
+  if (m_have_last) {
+    int64_t const interval = timestamp - m_last_timestamp;
+    m_intervals.push_back(interval);
+    m_mode_duration[static_cast<size_t>(m_last_mode)] += interval;
+  }
+  m_have_last = true;
+  m_last_timestamp = timestamp;
+  m_last_mode = mode;
+  m_mode_reports[static_cast<size_t>(mode_idx)] += 1;
+
+  if (mode == UDrawDecoder::Mode::PEN || mode == UDrawDecoder::Mode::TOUCH)
+  {
+    int const x = decoder->x();
+    int const y = decoder->y();
+
+    if (m_segment_stats_x.count == 0 || mode != m_segment_mode ||
+        abs(x - m_segment_x) > STATIONARY_RADIUS ||
+        abs(y - m_segment_y) > STATIONARY_RADIUS)
+    {
+      close_segment();
+      m_segment_mode = mode;
+      m_segment_x = x;
+      m_segment_y = y;
+    }
+
+    m_segment_stats_x.add(x);
+    m_segment_stats_y.add(y);
+  }
+  else
+  {
+    close_segment();
+  }
+
+  if (mode != UDrawDecoder::Mode::PEN) {
+    m_pressure_floor[data[Ps3Layout::PRESSURE]] += 1;
+  }
+
+  int const ax = decoder->accel_x();
+  int const ay = decoder->accel_y();
+  int const az = decoder->accel_z();
+  m_accel_x.add(ax);
+  m_accel_y.add(ay);
+  m_accel_z.add(az);
+  m_accel_magnitude.add(sqrt(static_cast<double>(ax * ax + ay * ay + az * az)));
+}
+
+void
+CaptureAnalyzer::close_segment()
+{
+  if (m_segment_stats_x.count >= STATIONARY_MIN_REPORTS) {
+    size_t const idx = static_cast<size_t>(m_segment_mode);
+
+    // pool the variance around each segment's own mean, so that slow
+    // drift between segments doesn't count as noise
+    RunningStats x = m_segment_stats_x;
+    RunningStats y = m_segment_stats_y;
+    x.mean = 0.0;
+    y.mean = 0.0;
+    x.min -= m_segment_stats_x.mean;
+    x.max -= m_segment_stats_x.mean;
+    y.min -= m_segment_stats_y.mean;
+    y.max -= m_segment_stats_y.mean;
+
+    m_noise_x[idx].merge(x);
+    m_noise_y[idx].merge(y);
+    m_stationary_segments[idx] += 1;
+  }
+
+  m_segment_stats_x = RunningStats();
+  m_segment_stats_y = RunningStats();
+}
+
+void
+CaptureAnalyzer::finish()
+{
+  close_segment();
+}
+
+void
+CaptureAnalyzer::merge(CaptureAnalyzer const& other)
+{
+  m_reports += other.m_reports;
+  for (size_t i = 0; i < m_rejected.size(); ++i) {
+    m_rejected[i] += other.m_rejected[i];
+  }
+
+  m_intervals.insert(m_intervals.end(), other.m_intervals.begin(), other.m_intervals.end());
+
+  for (size_t i = 0; i < MODE_COUNT; ++i) {
+    m_mode_duration[i] += other.m_mode_duration[i];
+    m_mode_reports[i] += other.m_mode_reports[i];
+    m_noise_x[i].merge(other.m_noise_x[i]);
+    m_noise_y[i].merge(other.m_noise_y[i]);
+    m_stationary_segments[i] += other.m_stationary_segments[i];
+  }
+
+  for (size_t i = 0; i < m_pressure_floor.size(); ++i) {
+    m_pressure_floor[i] += other.m_pressure_floor[i];
+  }
+
+  m_accel_x.merge(other.m_accel_x);
+  m_accel_y.merge(other.m_accel_y);
+  m_accel_z.merge(other.m_accel_z);
+  m_accel_magnitude.merge(other.m_accel_magnitude);
+}
+
+void
+CaptureAnalyzer::print(std::ostream& os) const
+{
+  fmt::memory_buffer out;
+  auto it = std::back_inserter(out);
+
+  fmt::format_to(it, "reports: {}", m_reports);
+  for (size_t i = 1; i < m_rejected.size(); ++i) {
+    if (m_rejected[i] != 0) {
+      fmt::format_to(it, ", {}: {}", to_string(static_cast<UDrawDecoder::Error>(i)), m_rejected[i]);
+    }
+  }
+  fmt::format_to(it, "\n");
+
+  // report intervals
+  if (!m_intervals.empty())
+  {
+    std::vector<int64_t> sorted = m_intervals;
+    std::sort(sorted.begin(), sorted.end());
+
+    RunningStats interval;
+    for (int64_t const value : sorted) {
+      interval.add(static_cast<double>(value));
+    }
+
+    fmt::format_to(it, "\nreport interval (ms):\n");
+    fmt::format_to(it, "  mean {:.3f}  stddev {:.3f}  min {:.3f}  max {:.3f}\n",
+                   to_msec(interval.mean), to_msec(interval.stddev()),
+                   to_msec(interval.min), to_msec(interval.max));
+    fmt::format_to(it, "  p50 {:.3f}  p90 {:.3f}  p99 {:.3f}  p99.9 {:.3f}\n",
+                   to_msec(static_cast<double>(percentile(sorted, 50.0))),
+                   to_msec(static_cast<double>(percentile(sorted, 90.0))),
+                   to_msec(static_cast<double>(percentile(sorted, 99.0))),
+                   to_msec(static_cast<double>(percentile(sorted, 99.9))));
+
+    // histogram in 1ms buckets, everything above 32ms is lumped together
+    constexpr size_t BUCKETS = 33;
+    std::array<uint64_t, BUCKETS> histogram = {};
+    for (int64_t const value : sorted) {
+      size_t const bucket = static_cast<size_t>(std::max<int64_t>(value, 0) / 1000000);
+      histogram[std::min(bucket, BUCKETS - 1)] += 1;
+    }
+
+    for (size_t i = 0; i < BUCKETS; ++i) {
+      if (histogram[i] == 0) {
+        continue;
+      }
+      double const fraction = static_cast<double>(histogram[i]) / static_cast<double>(sorted.size());
+      if (i == BUCKETS - 1) {
+        fmt::format_to(it, "  >={:2d}ms {:10d} {:6.2f}%\n", i, histogram[i], fraction * 100.0);
+      } else {
+        fmt::format_to(it, "  {:2d}-{:2d}ms {:9d} {:6.2f}%\n", i, i + 1, histogram[i], fraction * 100.0);
+      }
+    }
+  }
+
+  // mode duration
+  fmt::format_to(it, "\nmode duration:\n");
+  for (int i = 0; i < MODE_COUNT; ++i) {
+    if (m_mode_reports[i] != 0) {
+      fmt::format_to(it, "  {:<10} {:10.3f}s {:10d} reports\n",
+                     mode_name(i), static_cast<double>(m_mode_duration[i]) / 1e9, m_mode_reports[i]);
+    }
+  }
+
+  // position noise
+  fmt::format_to(it, "\nstationary position noise (radius {}, at least {} reports):\n",
+                 STATIONARY_RADIUS, STATIONARY_MIN_REPORTS);
+  for (int i = 0; i < MODE_COUNT; ++i) {
+    RunningStats const& x = m_noise_x[i];
+    RunningStats const& y = m_noise_y[i];
+    if (x.count != 0) {
+      fmt::format_to(it, "  {:<10} segments {:6d}  reports {:8d}  "
+                     "x stddev {:.3f} range [{:+.2f}, {:+.2f}]  "
+                     "y stddev {:.3f} range [{:+.2f}, {:+.2f}]\n",
+                     mode_name(i), m_stationary_segments[i], x.count,
+                     x.stddev(), x.min, x.max,
+                     y.stddev(), y.min, y.max);
+    }
+  }
+
+  // pressure noise floor
+  uint64_t floor_count = 0;
+  double floor_sum = 0.0;
+  double floor_sum2 = 0.0;
+  int floor_min = 0;
+  int floor_max = 0;
+  for (size_t i = 0; i < m_pressure_floor.size(); ++i) {
+    if (m_pressure_floor[i] != 0) {
+      int const value = static_cast<int>(i) - Ps3Layout::PRESSURE_BIAS;
+      double const n = static_cast<double>(m_pressure_floor[i]);
+      if (floor_count == 0) {
+        floor_min = value;
+      }
+      floor_max = value;
+      floor_count += m_pressure_floor[i];
+      floor_sum += n * value;
+      floor_sum2 += n * value * value;
+    }
+  }
+  fmt::format_to(it, "\npressure without pen contact:\n");
+  if (floor_count != 0) {
+    double const n = static_cast<double>(floor_count);
+    double const mean = floor_sum / n;
+    double const variance = floor_count > 1 ? (floor_sum2 - n * mean * mean) / (n - 1.0) : 0.0;
+    fmt::format_to(it, "  mean {:.3f}  stddev {:.3f}  min {}  max {}\n",
+                   mean, sqrt(std::max(variance, 0.0)), floor_min, floor_max);
+    for (size_t i = 0; i < m_pressure_floor.size(); ++i) {
+      if (m_pressure_floor[i] != 0) {
+        fmt::format_to(it, "  0x{:02x} ({:+4d}) {:10d} {:6.2f}%\n",
+                       i, static_cast<int>(i) - Ps3Layout::PRESSURE_BIAS, m_pressure_floor[i],
+                       100.0 * static_cast<double>(m_pressure_floor[i]) / n);
+      }
+    }
+  }
+
+  // accelerometer
+  fmt::format_to(it, "\naccelerometer:\n");
+  auto print_accel = [&it](char const* name, RunningStats const& stats) {
+    if (stats.count != 0) {
+      fmt::format_to(it, "  {:<9} mean {:8.3f}  stddev {:7.3f}  min {:6.1f}  max {:6.1f}\n",
+                     name, stats.mean, stats.stddev(), stats.min, stats.max);
+    }
+  };
+  print_accel("x", m_accel_x);
+  print_accel("y", m_accel_y);
+  print_accel("z", m_accel_z);
+  print_accel("magnitude", m_accel_magnitude);
+
+  os << fmt::to_string(out);
+}
+
+void analyze_file(std::string const& filename, CaptureAnalyzer& analyzer)
+{
+  std::unique_ptr<ReportReader> reader = open_report_reader(filename);
+
+  CaptureRecord record;
+  while (reader->next(record)) {
+    analyzer.add(record.timestamp, record.data, record.size);
+  }
+  analyzer.finish();
+}
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,128 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_CAPTURE_ANALYZER_HPP
+#define HEADER_UDRAW_CAPTURE_ANALYZER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "udraw_decoder.hpp"
+
+namespace udraw {
+
+/** Count, mean, variance and range of a series, using Welford's
+    algorithm so that long captures don't lose precision */
+struct RunningStats
+{
+  uint64_t count = 0;
+  double mean = 0.0;
+  double m2 = 0.0;
+  double min = std::numeric_limits<double>::infinity();
+  double max = -std::numeric_limits<double>::infinity();
+
+  void add(double value);
+  void merge(RunningStats const& other);
+
+  double variance() const { return count > 1 ? m2 / static_cast<double>(count - 1) : 0.0; }
+  double stddev() const;
+};
+
+/** Collects timing and sensor noise statistics over a stream of raw
+    reports, used to tune the filter and threshold constants */
+class CaptureAnalyzer
+{
+public:
+  static constexpr int MODE_COUNT = 5;
+
+  /** maximum distance from the start of a segment that still counts as
+      stationary, pen coordinates move in steps of three */
+  static constexpr int STATIONARY_RADIUS = 6;
+
+  /** shortest run of reports that is taken as the pen or finger
+      resting, shorter runs are just slow movement */
+  static constexpr size_t STATIONARY_MIN_REPORTS = 16;
+
+public:
+  CaptureAnalyzer();
+
+  void add(int64_t timestamp, uint8_t const* data, size_t size);
+
+  /** Close the open stationary segment, call after the last report */
+  void finish();
+
+  /** Combine the results of another analyzer, e.g. from another file */
+  void merge(CaptureAnalyzer const& other);
+
+  void print(std::ostream& os) const;
+
+private:
+  void close_segment();
+
+private:
+  uint64_t m_reports;
+  std::array<uint64_t, UDrawDecoder::ERROR_COUNT> m_rejected;
+
+  bool m_have_last;
+  int64_t m_last_timestamp;
+  UDrawDecoder::Mode m_last_mode;
+
+  /** report intervals in nanoseconds */
+  std::vector<int64_t> m_intervals;
+
+  /** nanoseconds and reports spent in each UDrawDecoder::Mode */
+  std::array<int64_t, MODE_COUNT> m_mode_duration;
+  std::array<uint64_t, MODE_COUNT> m_mode_reports;
+
+  // current stationary candidate
+  UDrawDecoder::Mode m_segment_mode;
+  int m_segment_x;
+  int m_segment_y;
+  RunningStats m_segment_stats_x;
+  RunningStats m_segment_stats_y;
+
+  /** pooled noise of all stationary segments, indexed by mode */
+  std::array<RunningStats, MODE_COUNT> m_noise_x;
+  std::array<RunningStats, MODE_COUNT> m_noise_y;
+  std::array<uint64_t, MODE_COUNT> m_stationary_segments;
+
+  /** raw pressure byte while the pen is not down */
+  std::array<uint64_t, 256> m_pressure_floor;
+
+  RunningStats m_accel_x;
+  RunningStats m_accel_y;
+  RunningStats m_accel_z;
+  RunningStats m_accel_magnitude;
+
+private:
+  CaptureAnalyzer(const CaptureAnalyzer&) = delete;
+  CaptureAnalyzer& operator=(const CaptureAnalyzer&) = delete;
+};
+
+/** Run every report of \a filename through \a analyzer */
+void analyze_file(std::string const& filename, CaptureAnalyzer& analyzer);
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
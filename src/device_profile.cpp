@@ -0,0 +1,112 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "device_profile.hpp"
+
+#include <stdio.h>
+
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "report_format.hpp"
+
+namespace udraw {
+
+namespace {
+
+/** Only devices whose IDs and report layout have been verified, in the
+    order they are looked for */
+DeviceProfile const device_profiles[] = {
+  { "PS3 uDraw GameTablet", 0x20d6, 0xcb17, 0, 3, &report_format<Ps3Layout> },
+};
+
+} // namespace
+
+std::optional<DeviceProfile>
+find_device_profile(libusb_context* ctx)
+{
+  libusb_device** list;
+  ssize_t const count = libusb_get_device_list(ctx, &list);
+  if (count < 0) {
+    throw std::runtime_error(fmt::format("libusb_get_device_list: {}",
+                                         libusb_strerror(static_cast<int>(count))));
+  }
+
+  std::optional<DeviceProfile> result;
+  for (DeviceProfile const& profile : device_profiles)
+  {
+    for (ssize_t i = 0; i < count && !result; ++i)
+    {
+      libusb_device_descriptor desc;
+      if (libusb_get_device_descriptor(list[i], &desc) != LIBUSB_SUCCESS) {
+        continue;
+      }
+
+      if (desc.idVendor == profile.vendor_id && desc.idProduct == profile.product_id) {
+        result = profile;
+      }
+    }
+
+    if (result) {
+      break;
+    }
+  }
+
+  libusb_free_device_list(list, 1);
+  return result;
+}
+
+DeviceProfile const*
+find_device_profile(uint16_t vendor_id, uint16_t product_id)
+{
+  for (DeviceProfile const& profile : device_profiles) {
+    if (profile.vendor_id == vendor_id && profile.product_id == product_id) {
+      return &profile;
+    }
+  }
+  return nullptr;
+}
+
+DeviceProfile const&
+default_device_profile()
+{
+  return device_profiles[0];
+}
+
+DeviceProfile
+device_profile_from_string(std::string const& text)
+{
+  unsigned int vendor_id;
+  unsigned int product_id;
+  int end = -1;
+  if (sscanf(text.c_str(), "%x:%x%n", &vendor_id, &product_id, &end) != 2 ||
+      end != static_cast<int>(text.size()) ||
+      vendor_id > 0xffff || product_id > 0xffff)
+  {
+    throw std::runtime_error(fmt::format("invalid device '{}', expected VID:PID in hex", text));
+  }
+
+  DeviceProfile profile = default_device_profile();
+  profile.name = "user supplied";
+  profile.vendor_id = static_cast<uint16_t>(vendor_id);
+  profile.product_id = static_cast<uint16_t>(product_id);
+  return profile;
+}
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,60 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_UDRAW_DEVICE_PROFILE_HPP
+#define HEADER_UDRAW_DEVICE_PROFILE_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include <libusb.h>
+
+#include "fwd.hpp"
+
+namespace udraw {
+
+/** A USB device and the layout of its reports. A device with a new
+    report layout needs the Layout, added to UDRAW_FOR_EACH_LAYOUT, and
+    its report_format<Layout> here. */
+struct DeviceProfile
+{
+  char const* name;
+  uint16_t vendor_id;
+  uint16_t product_id;
+  int interface;
+  int endpoint;
+  ReportFormat const* format;
+};
+
+/** The first connected device that is in the profile table */
+std::optional<DeviceProfile> find_device_profile(libusb_context* ctx);
+
+/** The table entry for the IDs, nullptr for an unknown device */
+DeviceProfile const* find_device_profile(uint16_t vendor_id, uint16_t product_id);
+
+/** The PS3 tablet, assumed for captures and generated reports */
+DeviceProfile const& default_device_profile();
+
+/** A profile for a device that isn't in the table, for VID:PID in hex,
+    which is assumed to behave like the PS3 tablet */
+DeviceProfile device_profile_from_string(std::string const& text);
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
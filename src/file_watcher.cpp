@@ -0,0 +1,132 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "file_watcher.hpp"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+
+namespace udraw {
+
+FileWatcher::FileWatcher(std::string const& filename, std::function<void ()> callback) :
+  m_basename(),
+  m_callback(std::move(callback)),
+  m_inotify_fd(-1),
+  m_quit_fd(-1),
+  m_thread()
+{
+  std::string::size_type const slash = filename.rfind('/');
+  std::string const dirname = (slash == std::string::npos) ? "." : filename.substr(0, slash + 1);
+  m_basename = (slash == std::string::npos) ? filename : filename.substr(slash + 1);
+
+  m_inotify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+  if (m_inotify_fd < 0) {
+    throw std::runtime_error(fmt::format("inotify_init1() failed: {}", strerror(errno)));
+  }
+
+  if (inotify_add_watch(m_inotify_fd, dirname.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    int const err = errno;
+    close(m_inotify_fd);
+    throw std::runtime_error(fmt::format("{}: inotify_add_watch() failed: {}", dirname, strerror(err)));
+  }
+
+  m_quit_fd = eventfd(0, EFD_CLOEXEC);
+  if (m_quit_fd < 0) {
+    close(m_inotify_fd);
+    throw std::runtime_error(fmt::format("eventfd() failed: {}", strerror(errno)));
+  }
+
+  m_thread = std::thread([this]{ run(); });
+}
+
+FileWatcher::~FileWatcher()
+{
+  uint64_t const one = 1;
+  if (write(m_quit_fd, &one, sizeof(one)) != sizeof(one)) {
+    log_error("failed to signal file watcher thread: {}", strerror(errno));
+  }
+  m_thread.join();
+
+  close(m_quit_fd);
+  close(m_inotify_fd);
+}
+
+void
+FileWatcher::run()
+{
+  pollfd fds[2];
+  fds[0].fd = m_inotify_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = m_quit_fd;
+  fds[1].events = POLLIN;
+
+  alignas(inotify_event) char buffer[4096];
+
+  while (true)
+  {
+    int const ret = poll(fds, 2, -1);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      log_error("poll() failed: {}", strerror(errno));
+      return;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      return;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      ssize_t const len = read(m_inotify_fd, buffer, sizeof(buffer));
+      if (len < 0) {
+        if (errno != EAGAIN && errno != EINTR) {
+          log_error("read() from inotify failed: {}", strerror(errno));
+          return;
+        }
+        continue;
+      }
+
+      // a burst of events for the same file only needs one callback
+      bool changed = false;
+      for (ssize_t offset = 0; offset < len;)
+      {
+        auto const* event = reinterpret_cast<inotify_event const*>(buffer + offset);
+        if (event->len > 0 && m_basename == event->name) {
+          changed = true;
+        }
+        offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+      }
+
+      if (changed) {
+        m_callback();
+      }
+    }
+  }
+}
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,55 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_UDRAW_FILE_WATCHER_HPP
+#define HEADER_UDRAW_FILE_WATCHER_HPP
+
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace udraw {
+
+/** Calls back from a separate thread whenever a file got written or
+    replaced. The directory is watched with inotify instead of the
+    file itself, so editors that save by renaming a new file over the
+    old one are noticed as well. */
+class FileWatcher
+{
+public:
+  FileWatcher(std::string const& filename, std::function<void ()> callback);
+  ~FileWatcher();
+
+private:
+  void run();
+
+private:
+  std::string m_basename;
+  std::function<void ()> m_callback;
+  int m_inotify_fd;
+  int m_quit_fd;
+  std::thread m_thread;
+
+private:
+  FileWatcher(const FileWatcher&) = delete;
+  FileWatcher& operator=(const FileWatcher&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -0,0 +1,74 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "flight_recorder.hpp"
+
+#include <stdexcept>
+
+#include "capture.hpp"
+
+namespace udraw {
+
+FlightRecorder::FlightRecorder(size_t capacity, int64_t window) :
+  m_entries(std::max<size_t>(capacity, 1)),
+  m_window(window),
+  m_next(0),
+  m_count(0)
+{
+}
+
+void
+FlightRecorder::copy_from(FlightRecorder const& other)
+{
+  if (other.m_entries.size() != m_entries.size() || other.m_window != m_window) {
+    throw std::runtime_error("flight recorder capacity mismatch");
+  }
+
+  std::copy(other.m_entries.begin(), other.m_entries.end(), m_entries.begin());
+  m_next = other.m_next;
+  m_count = other.m_count;
+}
+
+size_t
+FlightRecorder::dump(std::string const& filename) const
+{
+  CaptureWriter writer(filename);
+
+  size_t first = (m_next + m_entries.size() - m_count) % m_entries.size();
+  size_t count = m_count;
+
+  // at a lower report rate the ring reaches further back than the window
+  if (count != 0) {
+    int64_t const newest = m_entries[(m_next + m_entries.size() - 1) % m_entries.size()].timestamp;
+    while (count != 0 && m_entries[first].timestamp < newest - m_window) {
+      first = (first + 1) % m_entries.size();
+      count -= 1;
+    }
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    Entry const& entry = m_entries[(first + i) % m_entries.size()];
+    writer.write(entry.timestamp, entry.data, entry.size);
+  }
+
+  writer.close();
+  return count;
+}
+
+} // namespace udraw
+
+/* EOF */
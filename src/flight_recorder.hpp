@@ -0,0 +1,86 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_FLIGHT_RECORDER_HPP
+#define HEADER_UDRAW_FLIGHT_RECORDER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace udraw {
+
+/** Keeps the most recent raw reports in a fixed-size ring, so that
+    they can be dumped as a capture file when something went wrong. The
+    ring is sized for the highest report rate, a dump only contains the
+    reports from the last \a window nanoseconds before the newest one. */
+class FlightRecorder
+{
+public:
+  /** largest interrupt packet on a full speed device */
+  static constexpr size_t MAX_REPORT_SIZE = 64;
+
+public:
+  FlightRecorder(size_t capacity, int64_t window);
+
+  void record(int64_t timestamp, uint8_t const* data, size_t size)
+  {
+    Entry& entry = m_entries[m_next];
+    entry.timestamp = timestamp;
+    entry.size = static_cast<uint32_t>(std::min(size, MAX_REPORT_SIZE));
+    std::memcpy(entry.data, data, entry.size);
+
+    m_next = (m_next + 1 == m_entries.size()) ? 0 : m_next + 1;
+    m_count = std::min(m_count + 1, m_entries.size());
+  }
+
+  /** Take over the reports of \a other, which must have the same
+      capacity and window, without allocating */
+  void copy_from(FlightRecorder const& other);
+
+  /** Write the reports within the window, oldest first, in the
+      capture format, returns the number of reports written */
+  size_t dump(std::string const& filename) const;
+
+  size_t size() const { return m_count; }
+
+private:
+  struct Entry
+  {
+    int64_t timestamp;
+    uint32_t size;
+    uint8_t data[MAX_REPORT_SIZE];
+  };
+
+  std::vector<Entry> m_entries;
+  int64_t m_window;
+  size_t m_next;
+  size_t m_count;
+
+private:
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder& operator=(const FlightRecorder&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
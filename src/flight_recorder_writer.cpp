@@ -0,0 +1,148 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "flight_recorder_writer.hpp"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+
+#include "async_log.hpp"
+
+namespace udraw {
+
+FlightRecorderWriter::FlightRecorderWriter(size_t capacity, int64_t window, std::string directory) :
+  m_directory(std::move(directory)),
+  m_snapshot(capacity, window),
+  m_reason(nullptr),
+  m_index(0),
+  m_busy(false),
+  m_wakeup_fd(-1),
+  m_quit_fd(-1),
+  m_thread()
+{
+  m_wakeup_fd = eventfd(0, EFD_CLOEXEC);
+  if (m_wakeup_fd < 0) {
+    throw std::runtime_error(fmt::format("eventfd() failed: {}", strerror(errno)));
+  }
+
+  m_quit_fd = eventfd(0, EFD_CLOEXEC);
+  if (m_quit_fd < 0) {
+    close(m_wakeup_fd);
+    throw std::runtime_error(fmt::format("eventfd() failed: {}", strerror(errno)));
+  }
+
+  m_thread = std::thread([this]{ run(); });
+}
+
+FlightRecorderWriter::~FlightRecorderWriter()
+{
+  uint64_t const one = 1;
+  if (write(m_quit_fd, &one, sizeof(one)) != sizeof(one)) {
+    log_error("failed to signal flight recorder thread: {}", strerror(errno));
+  }
+  m_thread.join();
+
+  // a dump submitted right before the quit
+  if (m_busy.load(std::memory_order_acquire)) {
+    write_snapshot();
+  }
+
+  close(m_quit_fd);
+  close(m_wakeup_fd);
+}
+
+bool
+FlightRecorderWriter::submit(FlightRecorder const& recorder, char const* reason, int index)
+{
+  if (m_busy.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  m_snapshot.copy_from(recorder);
+  m_reason = reason;
+  m_index = index;
+  m_busy.store(true, std::memory_order_release);
+
+  uint64_t const one = 1;
+  if (write(m_wakeup_fd, &one, sizeof(one)) != sizeof(one)) {
+    // the destructor still writes it
+    async_log_error("failed to signal flight recorder thread: {}", strerror(errno));
+  }
+  return true;
+}
+
+void
+FlightRecorderWriter::run()
+{
+  pollfd fds[2];
+  fds[0].fd = m_wakeup_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = m_quit_fd;
+  fds[1].events = POLLIN;
+
+  while (true)
+  {
+    int const ret = poll(fds, 2, -1);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      log_error("poll() failed: {}", strerror(errno));
+      return;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      return;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      uint64_t count;
+      if (read(m_wakeup_fd, &count, sizeof(count)) != sizeof(count)) {
+        continue;
+      }
+
+      if (m_busy.load(std::memory_order_acquire)) {
+        write_snapshot();
+      }
+    }
+  }
+}
+
+void
+FlightRecorderWriter::write_snapshot()
+{
+  std::string const filename = fmt::format("{}/udraw-{}-{}.udrawcap", m_directory, getpid(), m_index);
+  try {
+    size_t const count = m_snapshot.dump(filename);
+    log_info("flight recorder ({}): {} reports written to {}", m_reason, count, filename);
+  } catch (std::exception const& err) {
+    log_error("flight recorder ({}): {}", m_reason, err.what());
+  }
+
+  m_busy.store(false, std::memory_order_release);
+}
+
+} // namespace udraw
+
+/* EOF */
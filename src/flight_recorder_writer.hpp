@@ -0,0 +1,72 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_UDRAW_FLIGHT_RECORDER_WRITER_HPP
+#define HEADER_UDRAW_FLIGHT_RECORDER_WRITER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "flight_recorder.hpp"
+
+namespace udraw {
+
+/** Writes flight recorder dumps from a background thread. The input
+    thread only copies the ring into a preallocated snapshot, the file
+    name, the file I/O and the log message happen on the writer. */
+class FlightRecorderWriter
+{
+public:
+  /** \a capacity and \a window must match the FlightRecorder that
+      gets submitted */
+  FlightRecorderWriter(size_t capacity, int64_t window, std::string directory);
+  ~FlightRecorderWriter();
+
+  /** Have the reports in \a recorder written as dump number \a index,
+      returns false while the previous dump is still being written */
+  bool submit(FlightRecorder const& recorder, char const* reason, int index);
+
+private:
+  void run();
+  void write_snapshot();
+
+private:
+  std::string m_directory;
+  FlightRecorder m_snapshot;
+  char const* m_reason;
+  int m_index;
+
+  /** set by submit(), cleared by the writer once the file is written,
+      the snapshot belongs to the writer while it is set */
+  std::atomic<bool> m_busy;
+
+  int m_wakeup_fd;
+  int m_quit_fd;
+  std::thread m_thread;
+
+private:
+  FlightRecorderWriter(const FlightRecorderWriter&) = delete;
+  FlightRecorderWriter& operator=(const FlightRecorderWriter&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
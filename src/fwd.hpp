@@ -22,7 +22,16 @@
 namespace udraw {
 
 class Driver;
+struct DeviceProfile;
+class FileWatcher;
+class FlightRecorder;
+class FlightRecorderWriter;
 class Options;
+class PerfCounters;
+struct ReportFormat;
+class ReportReader;
+class SampleRingWriter;
+class TuningStore;
 class USBDevice;
 
 } // namespace udraw
@@ -16,59 +16,142 @@
 
 #include "gamepad_driver.hpp"
 
+#include <cmath>
+
+#include <uinpp/event_emitter.hpp>
 #include <uinpp/multi_device.hpp>
 
+#include "device_profile.hpp"
+#include "options.hpp"
 #include "udraw_decoder.hpp"
+#include "trace.hpp"
 
 namespace udraw {
 
-GamepadDriver::GamepadDriver(uinpp::MultiDevice& evdev) :
-  m_evdev(evdev)
+namespace {
+
+int const stick_max = 32767;
+
+} // namespace
+
+template<typename Layout>
+GamepadDriver<Layout>::GamepadDriver(uinpp::MultiDevice& evdev, Options const& opts, DeviceProfile const& profile) :
+  m_evdev(evdev),
+  m_opts(opts),
+  m_profile(profile),
+  m_hat_x(),
+  m_hat_y(),
+  m_btn_a(),
+  m_btn_b(),
+  m_btn_x(),
+  m_btn_y(),
+  m_btn_start(),
+  m_btn_select(),
+  m_btn_mode(),
+  m_stick_x(),
+  m_stick_y(),
+  m_stick_radius(std::max(opts.stick_radius, 1)),
+  m_stick_lut(static_cast<size_t>(2 * m_stick_radius + 1)),
+  m_stick_active(false),
+  m_stick_origin_x(0),
+  m_stick_origin_y(0)
 {
+  // offsets inside the deadzone are 0, the rest is rescaled to 0..1
+  // and bent by the response curve
+  for (int offset = -m_stick_radius; offset <= m_stick_radius; ++offset)
+  {
+    double const distance = std::abs(offset) / static_cast<double>(m_stick_radius);
+    double value = 0.0;
+    if (distance > m_opts.stick_deadzone) {
+      value = std::pow((distance - m_opts.stick_deadzone) / (1.0 - m_opts.stick_deadzone),
+                       m_opts.stick_curve);
+    }
+    m_stick_lut[static_cast<size_t>(offset + m_stick_radius)] =
+      static_cast<int16_t>((offset < 0 ? -1 : 1) * std::lround(value * stick_max));
+  }
 }
 
-GamepadDriver::~GamepadDriver()
+template<typename Layout>
+GamepadDriver<Layout>::~GamepadDriver()
 {
 }
 
+template<typename Layout>
 void
-GamepadDriver::init()
+GamepadDriver<Layout>::init()
 {
-  m_evdev.add_abs(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), ABS_X, -1, 1, 0, 0, 0);
-  m_evdev.add_abs(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), ABS_Y, -1, 1, 0, 0, 0);
+  uinpp::VirtualDevice* gamepad = m_evdev.create_device(0, uinpp::DeviceType::JOYSTICK);
+  gamepad->set_name("uDraw Gamepad Driver");
+  gamepad->set_usbid(0x3, m_profile.vendor_id, m_profile.product_id, 0x110);
+
+  m_hat_x = gamepad->add_abs(ABS_HAT0X, -1, 1, 0, 0, 0);
+  m_hat_y = gamepad->add_abs(ABS_HAT0Y, -1, 1, 0, 0, 0);
 
-  m_evdev.add_key(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), BTN_A);
-  m_evdev.add_key(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), BTN_B);
-  m_evdev.add_key(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), BTN_X);
-  m_evdev.add_key(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), BTN_Y);
+  if (m_opts.virtual_stick) {
+    m_stick_x = gamepad->add_abs(ABS_X, -stick_max, stick_max, 0, 0, 0);
+    m_stick_y = gamepad->add_abs(ABS_Y, -stick_max, stick_max, 0, 0, 0);
+  }
 
-  m_evdev.add_key(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), BTN_START);
-  m_evdev.add_key(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), BTN_SELECT);
-  m_evdev.add_key(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), BTN_MODE);
+  m_btn_a = gamepad->add_key(BTN_A);
+  m_btn_b = gamepad->add_key(BTN_B);
+  m_btn_x = gamepad->add_key(BTN_X);
+  m_btn_y = gamepad->add_key(BTN_Y);
+
+  m_btn_start = gamepad->add_key(BTN_START);
+  m_btn_select = gamepad->add_key(BTN_SELECT);
+  m_btn_mode = gamepad->add_key(BTN_MODE);
 
   m_evdev.finish();
 }
 
+template<typename Layout>
 void
-GamepadDriver::receive_data(uint8_t const* data, size_t size)
+GamepadDriver<Layout>::receive_data(uint8_t const* data, size_t size)
 {
-  UDrawDecoder decoder(data, size);
-
-  m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), EV_ABS, ABS_X, -1 * decoder.left() + 1 * decoder.right());
-  m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), EV_ABS, ABS_Y, -1 * decoder.up()   + 1 * decoder.down());
-
-  m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), EV_KEY, BTN_A, decoder.cross());
-  m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), EV_KEY, BTN_B, decoder.circle());
-  m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), EV_KEY, BTN_X, decoder.square());
-  m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), EV_KEY, BTN_Y, decoder.triangle());
-
-  m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), EV_KEY, BTN_START, decoder.start());
-  m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), EV_KEY, BTN_SELECT, decoder.select());
-  m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), EV_KEY, BTN_MODE, decoder.guide());
-
-  m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::JOYSTICK), EV_SYN, SYN_REPORT, 0);
+  BasicUDrawDecoder<Layout> decoder(data, size);
+
+  m_hat_x->send(decoder.right() - decoder.left());
+  m_hat_y->send(decoder.down() - decoder.up());
+
+  m_btn_a->send(decoder.cross());
+  m_btn_b->send(decoder.circle());
+  m_btn_x->send(decoder.square());
+  m_btn_y->send(decoder.triangle());
+
+  m_btn_start->send(decoder.start());
+  m_btn_select->send(decoder.select());
+  m_btn_mode->send(decoder.guide());
+
+  if (m_stick_x)
+  {
+    // the stick is centered wherever the finger or pen comes down
+    bool const touching = (decoder.mode() == UDrawDecoderBase::Mode::TOUCH ||
+                           decoder.mode() == UDrawDecoderBase::Mode::PEN);
+    if (touching && !m_stick_active) {
+      m_stick_origin_x = decoder.x();
+      m_stick_origin_y = decoder.y();
+    }
+    m_stick_active = touching;
+
+    if (touching) {
+      m_stick_x->send(stick_value(decoder.x() - m_stick_origin_x));
+      m_stick_y->send(stick_value(decoder.y() - m_stick_origin_y));
+    } else {
+      m_stick_x->send(0);
+      m_stick_y->send(0);
+    }
+  }
+
+  {
+    UDRAW_TRACE_SCOPE("sync");
+    m_evdev.sync();
+  }
 }
 
+#define INSTANTIATE(Layout) template class GamepadDriver<Layout>;
+UDRAW_FOR_EACH_LAYOUT(INSTANTIATE)
+#undef INSTANTIATE
+
 } // namespace udraw
 
 /* EOF */
@@ -19,21 +19,60 @@
 
 #include "driver.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
 #include "fwd.hpp"
 
 namespace udraw {
 
+template<typename Layout>
 class GamepadDriver : public Driver
 {
 public:
-  GamepadDriver(uinpp::MultiDevice& evdev);
+  GamepadDriver(uinpp::MultiDevice& evdev, Options const& opts, DeviceProfile const& profile);
   ~GamepadDriver() override;
 
   void init() override;
   void receive_data(uint8_t const* data, size_t size) override;
 
+private:
+  /** Stick value for an offset from the touchdown position, indexed
+      by the offset clamped to +-stick_radius */
+  int stick_value(int offset) const
+  {
+    int const index = std::clamp(offset, -m_stick_radius, m_stick_radius) + m_stick_radius;
+    return m_stick_lut[static_cast<size_t>(index)];
+  }
+
 private:
   uinpp::MultiDevice& m_evdev;
+  Options const& m_opts;
+  DeviceProfile const& m_profile;
+
+  uinpp::EventEmitter* m_hat_x;
+  uinpp::EventEmitter* m_hat_y;
+
+  uinpp::EventEmitter* m_btn_a;
+  uinpp::EventEmitter* m_btn_b;
+  uinpp::EventEmitter* m_btn_x;
+  uinpp::EventEmitter* m_btn_y;
+
+  uinpp::EventEmitter* m_btn_start;
+  uinpp::EventEmitter* m_btn_select;
+  uinpp::EventEmitter* m_btn_mode;
+
+  /** virtual analog stick, only with Options::virtual_stick */
+  uinpp::EventEmitter* m_stick_x;
+  uinpp::EventEmitter* m_stick_y;
+
+  int m_stick_radius;
+  /** deadzone and response curve for offsets -radius to radius */
+  std::vector<int16_t> m_stick_lut;
+  bool m_stick_active;
+  int m_stick_origin_x;
+  int m_stick_origin_y;
 
 public:
   GamepadDriver(const GamepadDriver&) = delete;
@@ -0,0 +1,232 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "hot_zones.hpp"
+
+#include <errno.h>
+#include <linux/input-event-codes.h>
+#include <string.h>
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+namespace udraw {
+
+namespace {
+
+struct KeyName
+{
+  char const* name;
+  int code;
+};
+
+#define UDRAW_KEY(code) { #code, code }
+
+KeyName const key_names[] = {
+  UDRAW_KEY(KEY_ESC), UDRAW_KEY(KEY_TAB), UDRAW_KEY(KEY_ENTER), UDRAW_KEY(KEY_SPACE),
+  UDRAW_KEY(KEY_BACKSPACE), UDRAW_KEY(KEY_DELETE), UDRAW_KEY(KEY_INSERT),
+  UDRAW_KEY(KEY_HOME), UDRAW_KEY(KEY_END), UDRAW_KEY(KEY_PAGEUP), UDRAW_KEY(KEY_PAGEDOWN),
+  UDRAW_KEY(KEY_UP), UDRAW_KEY(KEY_DOWN), UDRAW_KEY(KEY_LEFT), UDRAW_KEY(KEY_RIGHT),
+  UDRAW_KEY(KEY_LEFTCTRL), UDRAW_KEY(KEY_RIGHTCTRL), UDRAW_KEY(KEY_LEFTSHIFT), UDRAW_KEY(KEY_RIGHTSHIFT),
+  UDRAW_KEY(KEY_LEFTALT), UDRAW_KEY(KEY_RIGHTALT), UDRAW_KEY(KEY_LEFTMETA), UDRAW_KEY(KEY_RIGHTMETA),
+  UDRAW_KEY(KEY_A), UDRAW_KEY(KEY_B), UDRAW_KEY(KEY_C), UDRAW_KEY(KEY_D), UDRAW_KEY(KEY_E),
+  UDRAW_KEY(KEY_F), UDRAW_KEY(KEY_G), UDRAW_KEY(KEY_H), UDRAW_KEY(KEY_I), UDRAW_KEY(KEY_J),
+  UDRAW_KEY(KEY_K), UDRAW_KEY(KEY_L), UDRAW_KEY(KEY_M), UDRAW_KEY(KEY_N), UDRAW_KEY(KEY_O),
+  UDRAW_KEY(KEY_P), UDRAW_KEY(KEY_Q), UDRAW_KEY(KEY_R), UDRAW_KEY(KEY_S), UDRAW_KEY(KEY_T),
+  UDRAW_KEY(KEY_U), UDRAW_KEY(KEY_V), UDRAW_KEY(KEY_W), UDRAW_KEY(KEY_X), UDRAW_KEY(KEY_Y),
+  UDRAW_KEY(KEY_Z),
+  UDRAW_KEY(KEY_0), UDRAW_KEY(KEY_1), UDRAW_KEY(KEY_2), UDRAW_KEY(KEY_3), UDRAW_KEY(KEY_4),
+  UDRAW_KEY(KEY_5), UDRAW_KEY(KEY_6), UDRAW_KEY(KEY_7), UDRAW_KEY(KEY_8), UDRAW_KEY(KEY_9),
+  UDRAW_KEY(KEY_MINUS), UDRAW_KEY(KEY_EQUAL), UDRAW_KEY(KEY_LEFTBRACE), UDRAW_KEY(KEY_RIGHTBRACE),
+  UDRAW_KEY(KEY_SEMICOLON), UDRAW_KEY(KEY_APOSTROPHE), UDRAW_KEY(KEY_GRAVE), UDRAW_KEY(KEY_BACKSLASH),
+  UDRAW_KEY(KEY_COMMA), UDRAW_KEY(KEY_DOT), UDRAW_KEY(KEY_SLASH),
+  UDRAW_KEY(KEY_F1), UDRAW_KEY(KEY_F2), UDRAW_KEY(KEY_F3), UDRAW_KEY(KEY_F4), UDRAW_KEY(KEY_F5),
+  UDRAW_KEY(KEY_F6), UDRAW_KEY(KEY_F7), UDRAW_KEY(KEY_F8), UDRAW_KEY(KEY_F9), UDRAW_KEY(KEY_F10),
+  UDRAW_KEY(KEY_F11), UDRAW_KEY(KEY_F12),
+  UDRAW_KEY(KEY_KP0), UDRAW_KEY(KEY_KP1), UDRAW_KEY(KEY_KP2), UDRAW_KEY(KEY_KP3), UDRAW_KEY(KEY_KP4),
+  UDRAW_KEY(KEY_KP5), UDRAW_KEY(KEY_KP6), UDRAW_KEY(KEY_KP7), UDRAW_KEY(KEY_KP8), UDRAW_KEY(KEY_KP9),
+  UDRAW_KEY(KEY_KPDOT), UDRAW_KEY(KEY_KPENTER), UDRAW_KEY(KEY_KPPLUS), UDRAW_KEY(KEY_KPMINUS),
+  UDRAW_KEY(KEY_KPASTERISK), UDRAW_KEY(KEY_KPSLASH),
+  UDRAW_KEY(KEY_MUTE), UDRAW_KEY(KEY_VOLUMEDOWN), UDRAW_KEY(KEY_VOLUMEUP),
+  UDRAW_KEY(KEY_PLAYPAUSE), UDRAW_KEY(KEY_NEXTSONG), UDRAW_KEY(KEY_PREVIOUSSONG),
+  UDRAW_KEY(KEY_BACK), UDRAW_KEY(KEY_FORWARD), UDRAW_KEY(KEY_UNDO), UDRAW_KEY(KEY_REDO),
+  UDRAW_KEY(KEY_COPY), UDRAW_KEY(KEY_PASTE), UDRAW_KEY(KEY_CUT),
+};
+
+#undef UDRAW_KEY
+
+/** number pad rows, top to bottom */
+int const keypad_layout[4][3] = {
+  { KEY_KP7, KEY_KP8, KEY_KP9 },
+  { KEY_KP4, KEY_KP5, KEY_KP6 },
+  { KEY_KP1, KEY_KP2, KEY_KP3 },
+  { KEY_KP0, KEY_KPDOT, KEY_KPENTER },
+};
+
+int key_from_string(std::string const& name)
+{
+  for (KeyName const& key : key_names) {
+    if (name == key.name) {
+      return key.code;
+    }
+  }
+
+  // plain key codes for everything not in the table
+  char* end = nullptr;
+  long const code = strtol(name.c_str(), &end, 0);
+  if (!name.empty() && *end == '\0' && code > 0 && code < KEY_MAX) {
+    return static_cast<int>(code);
+  }
+
+  throw std::runtime_error(fmt::format("unknown key: {}", name));
+}
+
+std::vector<int> keys_from_string(std::string const& text)
+{
+  std::vector<int> keys;
+  std::istringstream in(text);
+  std::string name;
+  while (std::getline(in, name, '+')) {
+    keys.push_back(key_from_string(name));
+  }
+  return keys;
+}
+
+void add_keypad(std::vector<HotZone>& zones, int x1, int y1, int x2, int y2)
+{
+  int const rows = 4;
+  int const columns = 3;
+  for (int row = 0; row < rows; ++row) {
+    for (int column = 0; column < columns; ++column) {
+      zones.push_back(HotZone{
+          HotZone::Type::BUTTON,
+          x1 + (x2 - x1) * column / columns,
+          y1 + (y2 - y1) * row / rows,
+          x1 + (x2 - x1) * (column + 1) / columns,
+          y1 + (y2 - y1) * (row + 1) / rows,
+          { keypad_layout[row][column] }});
+    }
+  }
+}
+
+} // namespace
+
+HotZoneMap
+HotZoneMap::default_layout()
+{
+  return HotZoneMap({
+      HotZone{HotZone::Type::SCROLL, 0, 0, 120, TOUCH_SURFACE_HEIGHT, {}},
+      HotZone{HotZone::Type::SCROLL, 1800, 0, TOUCH_SURFACE_WIDTH, TOUCH_SURFACE_HEIGHT, {}},
+    });
+}
+
+HotZoneMap
+HotZoneMap::from_file(std::string const& filename)
+{
+  std::ifstream in(filename);
+  if (!in) {
+    throw std::runtime_error(fmt::format("{}: {}", filename, strerror(errno)));
+  }
+
+  std::vector<HotZone> zones;
+  std::string line;
+  for (int line_number = 1; std::getline(in, line); ++line_number)
+  {
+    std::istringstream words(line.substr(0, line.find('#')));
+    std::string type;
+    if (!(words >> type)) {
+      continue;
+    }
+
+    try {
+      int x1, y1, x2, y2;
+      if (!(words >> x1 >> y1 >> x2 >> y2)) {
+        throw std::runtime_error("expected X1 Y1 X2 Y2");
+      }
+
+      if (x1 >= x2 || y1 >= y2) {
+        throw std::runtime_error("empty rectangle");
+      }
+
+      std::string keys;
+      if (type == "pointer") {
+        zones.push_back(HotZone{HotZone::Type::POINTER, x1, y1, x2, y2, {}});
+      } else if (type == "scroll") {
+        zones.push_back(HotZone{HotZone::Type::SCROLL, x1, y1, x2, y2, {}});
+      } else if (type == "hscroll") {
+        zones.push_back(HotZone{HotZone::Type::HSCROLL, x1, y1, x2, y2, {}});
+      } else if (type == "button") {
+        if (!(words >> keys)) {
+          throw std::runtime_error("expected KEY[+KEY]...");
+        }
+        zones.push_back(HotZone{HotZone::Type::BUTTON, x1, y1, x2, y2, keys_from_string(keys)});
+      } else if (type == "keypad") {
+        add_keypad(zones, x1, y1, x2, y2);
+      } else {
+        throw std::runtime_error(fmt::format("unknown zone type '{}'", type));
+      }
+
+      std::string rest;
+      if (words >> rest) {
+        throw std::runtime_error(fmt::format("trailing garbage '{}'", rest));
+      }
+    } catch (std::exception const& err) {
+      throw std::runtime_error(fmt::format("{}:{}: {}", filename, line_number, err.what()));
+    }
+  }
+
+  return HotZoneMap(std::move(zones));
+}
+
+HotZoneMap::HotZoneMap(std::vector<HotZone> zones) :
+  m_zones(),
+  m_grid(static_cast<size_t>(COLUMNS * ROWS), 0)
+{
+  // index 0 is the pointer area below everything else
+  m_zones.push_back(HotZone{HotZone::Type::POINTER, 0, 0, TOUCH_SURFACE_WIDTH, TOUCH_SURFACE_HEIGHT, {}});
+  m_zones.insert(m_zones.end(), zones.begin(), zones.end());
+
+  if (m_zones.size() > MAX_ZONES) {
+    throw std::runtime_error(fmt::format("too many hot zones: {}, at most {}", zones.size(), MAX_ZONES - 1));
+  }
+
+  for (size_t i = 1; i < m_zones.size(); ++i)
+  {
+    HotZone const& zone = m_zones[i];
+    for (int row = 0; row < ROWS; ++row)
+    {
+      int const center_y = row * CELL_SIZE + CELL_SIZE / 2;
+      if (center_y < zone.y1 || center_y >= zone.y2) {
+        continue;
+      }
+
+      for (int column = 0; column < COLUMNS; ++column)
+      {
+        int const center_x = column * CELL_SIZE + CELL_SIZE / 2;
+        if (zone.x1 <= center_x && center_x < zone.x2) {
+          m_grid[static_cast<size_t>(row * COLUMNS + column)] = static_cast<uint8_t>(i);
+        }
+      }
+    }
+  }
+}
+
+} // namespace udraw
+
+/* EOF */
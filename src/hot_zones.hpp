@@ -0,0 +1,106 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_UDRAW_HOT_ZONES_HPP
+#define HEADER_UDRAW_HOT_ZONES_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "touch_contacts.hpp"
+
+namespace udraw {
+
+/** A rectangle of the touch surface, [x1, x2) x [y1, y2) */
+struct HotZone
+{
+  enum class Type : uint8_t {
+    /** relative pointer motion and tap to click */
+    POINTER,
+    /** vertical motion scrolls the wheel */
+    SCROLL,
+    /** horizontal motion scrolls the horizontal wheel */
+    HSCROLL,
+    /** \a keys are held while the finger is down */
+    BUTTON,
+  };
+
+  Type type;
+  int x1;
+  int y1;
+  int x2;
+  int y2;
+  std::vector<int> keys;
+};
+
+/** The touch surface split into zones. The layout is rasterized into
+    a grid of CELL_SIZE cells at construction, so lookup() costs the
+    same however many zones there are. Each cell belongs to the topmost
+    zone that covers its center. */
+class HotZoneMap
+{
+public:
+  static constexpr int CELL_SHIFT = 3;
+  static constexpr int CELL_SIZE = 1 << CELL_SHIFT;
+  static constexpr int COLUMNS = (TOUCH_SURFACE_WIDTH + CELL_SIZE - 1) >> CELL_SHIFT;
+  static constexpr int ROWS = (TOUCH_SURFACE_HEIGHT + CELL_SIZE - 1) >> CELL_SHIFT;
+  static constexpr size_t MAX_ZONES = 256;
+
+public:
+  /** Pointer in the middle, scroll strips on the left and right edge */
+  static HotZoneMap default_layout();
+
+  /** Load a layout, one zone per line, later lines on top:
+
+        pointer X1 Y1 X2 Y2
+        scroll X1 Y1 X2 Y2
+        hscroll X1 Y1 X2 Y2
+        button X1 Y1 X2 Y2 KEY[+KEY]...
+        keypad X1 Y1 X2 Y2
+
+      Keys are Linux key names, e.g. KEY_LEFTCTRL+KEY_Z. A keypad is
+      split into a 3x4 grid of number pad keys. Whatever no zone
+      covers is pointer area. */
+  static HotZoneMap from_file(std::string const& filename);
+
+  /** \a zones are stacked bottom to top, keypads already expanded */
+  HotZoneMap(std::vector<HotZone> zones);
+
+  /** Index into zones() for a position, positions outside the surface
+      are clamped to its border */
+  uint8_t lookup(int x, int y) const
+  {
+    unsigned const column = static_cast<unsigned>(std::clamp(x, 0, TOUCH_SURFACE_WIDTH - 1)) >> CELL_SHIFT;
+    unsigned const row = static_cast<unsigned>(std::clamp(y, 0, TOUCH_SURFACE_HEIGHT - 1)) >> CELL_SHIFT;
+    return m_grid[row * COLUMNS + column];
+  }
+
+  HotZone const& zone(uint8_t index) const { return m_zones[index]; }
+  std::vector<HotZone> const& zones() const { return m_zones; }
+
+private:
+  std::vector<HotZone> m_zones;
+  std::vector<uint8_t> m_grid;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
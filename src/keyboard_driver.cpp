@@ -19,20 +19,24 @@
 #include <uinpp/multi_device.hpp>
 
 #include "udraw_decoder.hpp"
+#include "trace.hpp"
 
 namespace udraw {
 
-KeyboardDriver::KeyboardDriver(uinpp::MultiDevice& evdev) :
+template<typename Layout>
+KeyboardDriver<Layout>::KeyboardDriver(uinpp::MultiDevice& evdev) :
   m_evdev(evdev)
 {
 }
 
-KeyboardDriver::~KeyboardDriver()
+template<typename Layout>
+KeyboardDriver<Layout>::~KeyboardDriver()
 {
 }
 
+template<typename Layout>
 void
-KeyboardDriver::init()
+KeyboardDriver<Layout>::init()
 {
   m_evdev.add_key(static_cast<uint32_t>(uinpp::DeviceType::KEYBOARD), KEY_LEFT);
   m_evdev.add_key(static_cast<uint32_t>(uinpp::DeviceType::KEYBOARD), KEY_RIGHT);
@@ -50,10 +54,11 @@ KeyboardDriver::init()
   m_evdev.finish();
 }
 
+template<typename Layout>
 void
-KeyboardDriver::receive_data(uint8_t const* data, size_t size)
+KeyboardDriver<Layout>::receive_data(uint8_t const* data, size_t size)
 {
-  UDrawDecoder decoder(data, size);
+  BasicUDrawDecoder<Layout> decoder(data, size);
 
   m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::KEYBOARD), EV_KEY, KEY_LEFT,  decoder.left());
   m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::KEYBOARD), EV_KEY, KEY_RIGHT, decoder.right());
@@ -68,9 +73,16 @@ KeyboardDriver::receive_data(uint8_t const* data, size_t size)
   m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::KEYBOARD), EV_KEY, KEY_ESC,  decoder.start());
   m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::KEYBOARD), EV_KEY, KEY_TAB, decoder.select());
 
-  m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::KEYBOARD), EV_SYN, SYN_REPORT, 0);
+  {
+    UDRAW_TRACE_SCOPE("sync");
+    m_evdev.send(static_cast<uint32_t>(uinpp::DeviceType::KEYBOARD), EV_SYN, SYN_REPORT, 0);
+  }
 }
 
+#define INSTANTIATE(Layout) template class KeyboardDriver<Layout>;
+UDRAW_FOR_EACH_LAYOUT(INSTANTIATE)
+#undef INSTANTIATE
+
 } // namespace udraw
 
 /* EOF */
@@ -22,6 +22,7 @@
 
 namespace udraw {
 
+template<typename Layout>
 class KeyboardDriver : public Driver
 {
 public:
@@ -0,0 +1,139 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "kinetic_scroller.hpp"
+
+#include <cmath>
+
+namespace udraw {
+
+namespace {
+
+/** only samples this close to the release are used for the velocity */
+auto const velocity_window = std::chrono::milliseconds(100);
+
+/** a release this long after the last movement is no fling */
+auto const release_timeout = std::chrono::milliseconds(50);
+
+/** time constant of the exponential decay */
+double const decay_time_constant_sec = 0.325;
+
+/** velocities in units per second, 120 units is one wheel notch */
+double const min_release_velocity = 240.0;
+double const min_velocity = 60.0;
+
+} // namespace
+
+KineticScroller::KineticScroller() :
+  m_samples(),
+  m_num_samples(0),
+  m_next_sample(0),
+  m_position(0),
+  m_velocity(0.0),
+  m_remainder(0.0)
+{
+}
+
+void
+KineticScroller::add_sample(clock::time_point time, int delta)
+{
+  m_position += delta;
+
+  m_samples[m_next_sample] = Sample{time, m_position};
+  m_next_sample = (m_next_sample + 1) % m_samples.size();
+  if (m_num_samples < m_samples.size()) {
+    m_num_samples += 1;
+  }
+}
+
+void
+KineticScroller::reset()
+{
+  m_num_samples = 0;
+  m_next_sample = 0;
+  m_position = 0;
+  m_velocity = 0.0;
+  m_remainder = 0.0;
+}
+
+bool
+KineticScroller::release(clock::time_point time)
+{
+  if (m_num_samples < 2) {
+    reset();
+    return false;
+  }
+
+  size_t const newest_idx = (m_next_sample + m_samples.size() - 1) % m_samples.size();
+  Sample const& newest = m_samples[newest_idx];
+
+  if (time - newest.time > release_timeout) {
+    reset();
+    return false;
+  }
+
+  // walk back to the oldest sample that is still inside the window
+  Sample const* oldest = &newest;
+  for (size_t i = 1; i < m_num_samples; ++i) {
+    Sample const& sample = m_samples[(newest_idx + m_samples.size() - i) % m_samples.size()];
+    if (newest.time - sample.time > velocity_window) {
+      break;
+    }
+    oldest = &sample;
+  }
+
+  double const dt = std::chrono::duration<double>(newest.time - oldest->time).count();
+  double const velocity = (dt > 0.0) ? (newest.position - oldest->position) / dt : 0.0;
+
+  reset();
+
+  if (std::abs(velocity) < min_release_velocity) {
+    return false;
+  }
+
+  m_velocity = velocity;
+  return true;
+}
+
+int
+KineticScroller::step(std::chrono::nanoseconds dt)
+{
+  if (m_velocity == 0.0) {
+    return 0;
+  }
+
+  double const dt_sec = std::chrono::duration<double>(dt).count();
+
+  // integral of the decaying velocity over the interval
+  double const decay = std::exp(-dt_sec / decay_time_constant_sec);
+  double const distance = m_velocity * decay_time_constant_sec * (1.0 - decay) + m_remainder;
+  m_velocity *= decay;
+
+  int const units = static_cast<int>(distance);
+  m_remainder = distance - units;
+
+  if (std::abs(m_velocity) < min_velocity) {
+    m_velocity = 0.0;
+    m_remainder = 0.0;
+  }
+
+  return units;
+}
+
+} // namespace udraw
+
+/* EOF */
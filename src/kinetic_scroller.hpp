@@ -0,0 +1,73 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_KINETIC_SCROLLER_HPP
+#define HEADER_UDRAW_KINETIC_SCROLLER_HPP
+
+#include <array>
+#include <chrono>
+
+namespace udraw {
+
+/** Estimates the release velocity of a scroll gesture and lets it
+    decay exponentially afterwards. Units are whatever the caller
+    feeds in, the TouchpadDriver uses REL_WHEEL_HI_RES units. */
+class KineticScroller
+{
+public:
+  using clock = std::chrono::steady_clock;
+
+public:
+  KineticScroller();
+
+  /** Record \a delta units of scrolling that happened at \a time */
+  void add_sample(clock::time_point time, int delta);
+
+  /** Forget the recorded samples and stop any ongoing scroll */
+  void reset();
+
+  /** The fingers got lifted, returns true if the release was fast
+      enough to start a kinetic scroll */
+  bool release(clock::time_point time);
+
+  /** Advance the scroll by \a dt and return the units to emit */
+  int step(std::chrono::nanoseconds dt);
+
+  bool active() const { return m_velocity != 0.0; }
+
+private:
+  struct Sample
+  {
+    clock::time_point time;
+    int position;
+  };
+
+  std::array<Sample, 8> m_samples;
+  size_t m_num_samples;
+  size_t m_next_sample;
+  int m_position;
+
+  /** units per second */
+  double m_velocity;
+  double m_remainder;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -14,9 +14,12 @@
 //  You should have received a copy of the GNU General Public License
 //  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <cmath>
 #include <memory>
+#include <optional>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <signal.h>
 #include <libusb.h>
 #include <sstream>
@@ -35,20 +38,20 @@
 #include <logmich/log.hpp>
 #include <uinpp/multi_device.hpp>
 
+#include "async_log.hpp"
+#include "device_profile.hpp"
 #include "options.hpp"
+#include "report_generator.hpp"
+#include "signals.hpp"
+#include "trace.hpp"
 #include "udraw_decoder.hpp"
 #include "udraw_driver.hpp"
 #include "usb_device.hpp"
 
 namespace udraw {
 
-uint16_t const UDRAW_VENDOR_ID = 0x20d6;
-uint16_t const UDRAW_PRODUCT_ID = 0xcb17;
-
 class USBDevice;
 
-bool global_interrupt = false;
-
 void print_help(const char* argv0)
 {
   std::cout << "Usage: " << argv0 << "[OPTION]...\n"
@@ -58,23 +61,87 @@ void print_help(const char* argv0)
             << "  -h, --help     display this help\n"
             << "  -v, --verbose  be more verbose\n"
             << "  -v, --version  print version number\n"
+            << "  --shm PATH     publish decoded samples in shared memory at PATH,\n"
+            << "                 e.g. /dev/shm/udraw, readable by everyone\n"
+            << "  --shm-group GROUP  only let members of GROUP read the shared memory\n"
+            << "  --replay FILE  read reports from a capture or usbmon file instead of the device\n"
+            << "  --device VID:PID  open this USB device, for tablets with an unknown ID\n"
+            << "  --trace FILE   write a Chrome trace of the input pipeline to FILE\n"
+            << "  --no-idle      process reports that repeat the previous one\n"
+            << "  --perf-counters  measure CPU counters for each report, printed on exit\n"
+            << "  --config FILE  read the tap, wheel and pressure thresholds from FILE,\n"
+            << "                 changes to FILE are applied while running\n"
+            << "\n"
+            << "Load Testing:\n"
+            << "  --generate PATTERN    feed synthetic reports instead of reading the device,\n"
+            << "                        PATTERN is strokes, toggle, buttons, walk or mixed\n"
+            << "  --generate-rate HZ    reports per second (default: 100, 0 is unthrottled)\n"
+            << "  --generate-count N    stop after N reports (default: run until interrupted)\n"
+            << "\n"
+            << "Flight Recorder:\n"
+            << "  --recorder-seconds N  keep the last N seconds of reports (default: 10, 0 disables)\n"
+            << "  --recorder-dir DIR    write dumps to DIR (default: /tmp)\n"
+            << "  The recorded reports are dumped on SIGUSR1, on errors and on exit,\n"
+            << "  SIGUSR1 also logs the activity statistics.\n"
             << "\n"
             << "Modes:\n"
             << "  --test         pretty print data (default)\n"
             << "  --raw          print raw data\n"
             << "  --touchpad     use the device as touchpad\n"
+            << "  --multitouch   use the device as multitouch touchpad\n"
             << "  --tablet       use the device as graphic tablet\n"
             << "  --gamepad      use the device as gamepad\n"
             << "  --keyboard     use the device as keyboard\n"
+            << "  --uhid         create the tablet or multitouch device through /dev/uhid\n"
+            << "  --plugin PATH[:ARGS]  pass the reports to a plugin, can be given more than once\n"
+            << "\n"
+            << "Touchpad Options:\n"
+            << "  --no-kinetic   stop scrolling when the fingers are lifted\n"
+            << "  --rate HZ      coalesce motion and emit it at most HZ times per second\n"
+            << "  --zones FILE   split the surface into pointer, scroll, button and keypad zones\n"
+            << "\n"
+            << "Gamepad Options:\n"
+            << "  --stick            turn touch motion into an analog stick on ABS_X/ABS_Y\n"
+            << "  --stick-radius N   surface units for full deflection (default: 200)\n"
+            << "  --stick-deadzone F share of the radius that reads as centered (default: 0.1)\n"
+            << "  --stick-curve F    response curve exponent, 1 is linear (default: 1.0)\n"
+            << "\n"
+            << "Tablet Options:\n"
+            << "  --area WxH+X+Y    use only this part of the surface (default: 1920x1080+0+0)\n"
+            << "  --output WxH+X+Y  map it to this region of the screen (default: the whole screen)\n"
+            << "  --screen WxH      size of the screen the compositor maps the tablet to\n"
+            << "                    (default: the size of the output, 1920x1080 without one)\n"
+            << "  --rotate DEGREES  the tablet is turned clockwise by 0, 90, 180 or 270 degrees\n"
+            << "  --keep-aspect     shrink the area to the aspect ratio of the output\n"
+            << "  --auto-rotate     follow the tablet when it is turned upside down\n"
+            << "  --resample HZ     emit the pen at a fixed rate, interpolated between reports\n"
             << std::endl;
 }
 
+/** A timer rate in Hz, rejects NaN, infinity and rates whose period
+    would truncate to zero nanoseconds */
+double rate_from_string(char const* text)
+{
+  double const rate = std::stod(text);
+  if (!std::isfinite(rate) || rate <= 0.0 || rate > 1e9) {
+    throw std::runtime_error(fmt::format("invalid rate: {}", text));
+  }
+  return rate;
+}
+
 Options parse_args(int argc, char** argv)
 {
   Options opts;
 
   for(int i = 1; i < argc; ++i)
   {
+    auto next_arg = [&]() -> char const* {
+      if (i + 1 >= argc) {
+        throw std::runtime_error(fmt::format("{} requires an argument", argv[i]));
+      }
+      return argv[++i];
+    };
+
     if (strcmp("--test", argv[i]) == 0) {
       opts.mode = Options::Mode::TEST;
     } else if (strcmp("--raw", argv[i]) == 0) {
@@ -87,6 +154,71 @@ Options parse_args(int argc, char** argv)
       opts.mode = Options::Mode::TABLET;
     } else if (strcmp("--touchpad", argv[i]) == 0) {
       opts.mode = Options::Mode::TOUCHPAD;
+    } else if (strcmp("--multitouch", argv[i]) == 0) {
+      opts.mode = Options::Mode::MULTITOUCH;
+    } else if (strcmp("--plugin", argv[i]) == 0) {
+      opts.mode = Options::Mode::PLUGIN;
+      opts.plugins.emplace_back(next_arg());
+    } else if (strcmp("--uhid", argv[i]) == 0) {
+      opts.uhid = true;
+    } else if (strcmp("--no-idle", argv[i]) == 0) {
+      opts.idle_skip = false;
+    } else if (strcmp("--perf-counters", argv[i]) == 0) {
+      opts.perf_counters = true;
+    } else if (strcmp("--config", argv[i]) == 0) {
+      opts.config_filename = next_arg();
+    } else if (strcmp("--no-kinetic", argv[i]) == 0) {
+      opts.kinetic_scrolling = false;
+    } else if (strcmp("--zones", argv[i]) == 0) {
+      opts.zones_filename = next_arg();
+    } else if (strcmp("--stick", argv[i]) == 0) {
+      opts.virtual_stick = true;
+    } else if (strcmp("--stick-radius", argv[i]) == 0) {
+      opts.stick_radius = std::stoi(next_arg());
+    } else if (strcmp("--stick-deadzone", argv[i]) == 0) {
+      opts.stick_deadzone = std::stod(next_arg());
+    } else if (strcmp("--stick-curve", argv[i]) == 0) {
+      opts.stick_curve = std::stod(next_arg());
+    } else if (strcmp("--area", argv[i]) == 0) {
+      opts.tablet_area = rect_from_string(next_arg());
+    } else if (strcmp("--output", argv[i]) == 0) {
+      opts.tablet_output = rect_from_string(next_arg());
+    } else if (strcmp("--screen", argv[i]) == 0) {
+      opts.screen = rect_from_string(next_arg());
+    } else if (strcmp("--rotate", argv[i]) == 0) {
+      opts.tablet_rotation = std::stoi(next_arg());
+    } else if (strcmp("--keep-aspect", argv[i]) == 0) {
+      opts.keep_aspect = true;
+    } else if (strcmp("--auto-rotate", argv[i]) == 0) {
+      opts.auto_rotate = true;
+    } else if (strcmp("--resample", argv[i]) == 0) {
+      opts.resample_rate = rate_from_string(next_arg());
+    } else if (strcmp("--rate", argv[i]) == 0) {
+      opts.output_rate = rate_from_string(next_arg());
+    } else if (strcmp("--shm", argv[i]) == 0) {
+      opts.shm_path = next_arg();
+    } else if (strcmp("--shm-group", argv[i]) == 0) {
+      opts.shm_group = next_arg();
+    } else if (strcmp("--device", argv[i]) == 0) {
+      opts.device = next_arg();
+      device_profile_from_string(opts.device);
+    } else if (strcmp("--replay", argv[i]) == 0) {
+      opts.replay_filename = next_arg();
+    } else if (strcmp("--generate", argv[i]) == 0) {
+      opts.generate_pattern = next_arg();
+    } else if (strcmp("--generate-rate", argv[i]) == 0) {
+      opts.generate_rate = std::stod(next_arg());
+      if (opts.generate_rate < 0.0) {
+        throw std::runtime_error(fmt::format("invalid rate: {}", argv[i]));
+      }
+    } else if (strcmp("--generate-count", argv[i]) == 0) {
+      opts.generate_count = std::stoull(next_arg());
+    } else if (strcmp("--trace", argv[i]) == 0) {
+      opts.trace_filename = next_arg();
+    } else if (strcmp("--recorder-seconds", argv[i]) == 0) {
+      opts.flight_recorder_seconds = std::stoi(next_arg());
+    } else if (strcmp("--recorder-dir", argv[i]) == 0) {
+      opts.flight_recorder_dir = next_arg();
     } else if (strcmp("--verbose", argv[i]) == 0 ||
                strcmp("-v", argv[i]) == 0) {
       opts.verbose = true;
@@ -105,6 +237,35 @@ Options parse_args(int argc, char** argv)
     }
   }
 
+  if (!opts.plugins.empty() && opts.mode != Options::Mode::PLUGIN) {
+    throw std::runtime_error("--plugin can't be combined with another mode");
+  }
+
+  if (!opts.shm_group.empty() && opts.shm_path.empty()) {
+    throw std::runtime_error("--shm-group requires --shm");
+  }
+
+  if (opts.uhid &&
+      opts.mode != Options::Mode::TABLET &&
+      opts.mode != Options::Mode::MULTITOUCH) {
+    throw std::runtime_error("--uhid requires --tablet or --multitouch");
+  }
+
+  // NaN passes every comparison below
+  if (!std::isfinite(opts.stick_deadzone) || !std::isfinite(opts.stick_curve) ||
+      opts.stick_radius <= 0 ||
+      opts.stick_deadzone < 0.0 || opts.stick_deadzone >= 1.0 ||
+      opts.stick_curve <= 0.0) {
+    throw std::runtime_error("--stick-radius and --stick-curve must be positive, --stick-deadzone within [0, 1)");
+  }
+
+  bool const tablet_options = !opts.tablet_area.empty() || !opts.tablet_output.empty() ||
+    !opts.screen.empty() || opts.tablet_rotation != 0 || opts.keep_aspect || opts.auto_rotate ||
+    opts.resample_rate != 0.0;
+  if (tablet_options && (opts.mode != Options::Mode::TABLET || opts.uhid)) {
+    throw std::runtime_error("--area, --output, --screen, --rotate, --keep-aspect, --auto-rotate and --resample require --tablet without --uhid");
+  }
+
   return opts;
 }
 
@@ -116,21 +277,66 @@ void run(int argc, char** argv)
     logmich::g_logger.set_log_level(logmich::LogLevel::DEBUG);
   }
 
-  libusb_context* usb_ctx;
-  int err = libusb_init(&usb_ctx);
-  if (err != LIBUSB_SUCCESS) {
-    throw std::runtime_error(libusb_strerror(err));
+  install_signal_handlers();
+  async_log::start();
+
+  if (!opts.trace_filename.empty()) {
+#ifdef UDRAW_TRACING
+    trace::start(opts.trace_filename);
+#else
+    throw std::runtime_error("--trace requires a build with -DUDRAW_TRACING=ON");
+#endif
   }
 
-  {
-    USBDevice usbdev(usb_ctx, UDRAW_VENDOR_ID, UDRAW_PRODUCT_ID);
-    //uinpp::MultiDevice evdev;
+  if (!opts.replay_filename.empty()) {
+    DeviceProfile const profile = opts.device.empty() ?
+      default_device_profile() : device_profile_from_string(opts.device);
     uinpp::MultiDevice evdev;
-    UDrawDriver driver(usbdev, evdev, opts);
-    driver.run();
+    UDrawDriver driver(evdev, opts, profile);
+    driver.replay(opts.replay_filename);
+  } else if (!opts.generate_pattern.empty()) {
+    ReportGenerator generator(ReportGenerator::pattern_from_string(opts.generate_pattern),
+                              opts.generate_rate, opts.generate_count,
+                              static_cast<uint32_t>(time(nullptr)));
+    DeviceProfile const profile = opts.device.empty() ?
+      default_device_profile() : device_profile_from_string(opts.device);
+    uinpp::MultiDevice evdev;
+    UDrawDriver driver(evdev, opts, profile);
+    driver.replay(generator);
+  } else {
+    libusb_context* usb_ctx;
+    int err = libusb_init(&usb_ctx);
+    if (err != LIBUSB_SUCCESS) {
+      throw std::runtime_error(libusb_strerror(err));
+    }
+
+    {
+      std::optional<DeviceProfile> profile;
+      if (!opts.device.empty()) {
+        profile = device_profile_from_string(opts.device);
+      } else {
+        profile = find_device_profile(usb_ctx);
+        if (!profile) {
+          throw std::runtime_error("error: no udraw tablet found");
+        }
+      }
+      log_info("using {} ({:04x}:{:04x})", profile->name, profile->vendor_id, profile->product_id);
+
+      USBDevice usbdev(usb_ctx, profile->vendor_id, profile->product_id);
+      //uinpp::MultiDevice evdev;
+      uinpp::MultiDevice evdev;
+      UDrawDriver driver(evdev, opts, *profile);
+      driver.run(usbdev);
+    }
+
+    libusb_exit(usb_ctx);
   }
 
-  libusb_exit(usb_ctx);
+#ifdef UDRAW_TRACING
+  trace::stop();
+#endif
+
+  async_log::stop();
 }
 
 } // namespace udraw
@@ -140,6 +346,11 @@ int main(int argc, char** argv) try
   udraw::run(argc, argv);
   return EXIT_SUCCESS;
 } catch (std::exception const& err) {
+  // the writer threads must be joined before static destruction
+#ifdef UDRAW_TRACING
+  udraw::trace::stop();
+#endif
+  udraw::async_log::stop();
   log_error("exception: {}", err.what());
   return EXIT_FAILURE;
 }
@@ -0,0 +1,74 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "mapped_file.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+namespace udraw {
+
+MappedFile::MappedFile(std::string const& filename) :
+  m_filename(filename),
+  m_fd(-1),
+  m_data(nullptr),
+  m_size(0)
+{
+  m_fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (m_fd < 0) {
+    throw std::runtime_error(fmt::format("{}: {}", m_filename, strerror(errno)));
+  }
+
+  struct stat st;
+  if (fstat(m_fd, &st) < 0) {
+    close(m_fd);
+    throw std::runtime_error(fmt::format("{}: {}", m_filename, strerror(errno)));
+  }
+  m_size = static_cast<size_t>(st.st_size);
+
+  if (m_size == 0) {
+    return;
+  }
+
+  void* mem = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+  if (mem == MAP_FAILED) {
+    close(m_fd);
+    throw std::runtime_error(fmt::format("{}: mmap() failed: {}", m_filename, strerror(errno)));
+  }
+  madvise(mem, m_size, MADV_SEQUENTIAL);
+  m_data = static_cast<uint8_t const*>(mem);
+}
+
+MappedFile::~MappedFile()
+{
+  if (m_data) {
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+  }
+  close(m_fd);
+}
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,54 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_MAPPED_FILE_HPP
+#define HEADER_UDRAW_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace udraw {
+
+/** Read-only mmap() of a whole file, set up for sequential access so
+    that large captures are streamed by the page cache */
+class MappedFile
+{
+public:
+  MappedFile(std::string const& filename);
+  ~MappedFile();
+
+  std::string const& filename() const { return m_filename; }
+  uint8_t const* data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  std::string m_filename;
+  int m_fd;
+  uint8_t const* m_data;
+  size_t m_size;
+
+private:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -0,0 +1,221 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "multitouch_driver.hpp"
+
+#include <algorithm>
+
+#include <uinpp/multi_device.hpp>
+#include <uinpp/event_emitter.hpp>
+
+#include "device_profile.hpp"
+#include "touch_contacts.hpp"
+#include "udraw_decoder.hpp"
+#include "trace.hpp"
+
+namespace udraw {
+
+namespace {
+
+int distance2(int x0, int y0, int x1, int y1)
+{
+  return (x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0);
+}
+
+} // namespace
+
+template<typename Layout>
+MultitouchDriver<Layout>::MultitouchDriver(uinpp::MultiDevice& evdev, DeviceProfile const& profile) :
+  m_evdev(evdev),
+  m_profile(profile),
+  m_start(),
+  m_select(),
+  m_guide(),
+  m_space(),
+  m_enter(),
+  m_btn_left(),
+  m_btn_right(),
+  m_btn_middle(),
+  m_btn_touch(),
+  m_btn_tool_finger(),
+  m_btn_tool_doubletap(),
+  m_abs_x(),
+  m_abs_y(),
+  m_mt_slot(),
+  m_mt_tracking_id(),
+  m_mt_position_x(),
+  m_mt_position_y(),
+  m_slots(),
+  m_next_tracking_id(0)
+{
+}
+
+template<typename Layout>
+MultitouchDriver<Layout>::~MultitouchDriver()
+{
+}
+
+template<typename Layout>
+void
+MultitouchDriver<Layout>::init()
+{
+  uinpp::VirtualDevice* keyboard = m_evdev.create_device(0, uinpp::DeviceType::KEYBOARD);
+  keyboard->set_name("uDraw Touchpad Driver (keyboard)");
+  keyboard->set_usbid(0x3, m_profile.vendor_id, m_profile.product_id, 0x110);
+
+  m_start = keyboard->add_key(KEY_FORWARD);
+  m_select = keyboard->add_key(KEY_BACK);
+  m_guide = keyboard->add_key(KEY_ESC);
+  m_space = keyboard->add_key(KEY_SPACE);
+  m_enter = keyboard->add_key(KEY_ENTER);
+
+  uinpp::VirtualDevice* touchpad = m_evdev.create_device(0, uinpp::DeviceType::GENERIC);
+  touchpad->set_name("uDraw Touchpad Driver (multitouch)");
+  touchpad->set_usbid(0x3, m_profile.vendor_id, m_profile.product_id, 0x110);
+  touchpad->set_phys("uDraw touchpad");
+  touchpad->set_prop(INPUT_PROP_POINTER);
+
+  m_btn_left = touchpad->add_key(BTN_LEFT);
+  m_btn_right = touchpad->add_key(BTN_RIGHT);
+  m_btn_middle = touchpad->add_key(BTN_MIDDLE);
+
+  m_btn_touch = touchpad->add_key(BTN_TOUCH);
+  m_btn_tool_finger = touchpad->add_key(BTN_TOOL_FINGER);
+  m_btn_tool_doubletap = touchpad->add_key(BTN_TOOL_DOUBLETAP);
+
+  m_abs_x = touchpad->add_abs(ABS_X, 0, TOUCH_SURFACE_WIDTH, 0, 0, 12);
+  m_abs_y = touchpad->add_abs(ABS_Y, 0, TOUCH_SURFACE_HEIGHT, 0, 0, 12);
+
+  m_mt_slot = touchpad->add_abs(ABS_MT_SLOT, 0, static_cast<int>(m_slots.size()) - 1, 0, 0, 0);
+  m_mt_tracking_id = touchpad->add_abs(ABS_MT_TRACKING_ID, 0, 0xffff, 0, 0, 0);
+  m_mt_position_x = touchpad->add_abs(ABS_MT_POSITION_X, 0, TOUCH_SURFACE_WIDTH, 0, 0, 12);
+  m_mt_position_y = touchpad->add_abs(ABS_MT_POSITION_Y, 0, TOUCH_SURFACE_HEIGHT, 0, 0, 12);
+
+  m_evdev.finish();
+}
+
+template<typename Layout>
+void
+MultitouchDriver<Layout>::receive_data(uint8_t const* data, size_t size)
+{
+  BasicUDrawDecoder<Layout> decoder(data, size);
+
+  m_start->send(decoder.start());
+  m_select->send(decoder.select());
+  m_guide->send(decoder.guide());
+  m_space->send(decoder.down());
+  m_enter->send(decoder.cross());
+
+  m_btn_left->send(decoder.square() || decoder.right());
+  m_btn_right->send(decoder.circle() || decoder.left());
+  m_btn_middle->send(decoder.triangle() || decoder.up());
+
+  TouchContact contacts[2];
+  int const num_contacts = touch_contacts(decoder, contacts);
+
+  update_contacts(contacts, num_contacts);
+
+  m_btn_touch->send(num_contacts > 0);
+  m_btn_tool_finger->send(num_contacts == 1);
+  m_btn_tool_doubletap->send(num_contacts == 2);
+
+  if (num_contacts > 0) {
+    m_abs_x->send(contacts[0].x);
+    m_abs_y->send(contacts[0].y);
+  }
+
+  {
+    UDRAW_TRACE_SCOPE("sync");
+    m_evdev.sync();
+  }
+}
+
+template<typename Layout>
+void
+MultitouchDriver<Layout>::update_contacts(TouchContact const* contacts, int num_contacts)
+{
+  // keep contacts in the slot they were in the last report, so
+  // that a finger doesn't jump when the other one is lifted or added
+  int assignment[2] = { 0, 1 };
+
+  if (num_contacts == 1) {
+    if (m_slots[1].active &&
+        (!m_slots[0].active ||
+         distance2(contacts[0].x, contacts[0].y, m_slots[1].x, m_slots[1].y) <
+         distance2(contacts[0].x, contacts[0].y, m_slots[0].x, m_slots[0].y)))
+    {
+      assignment[0] = 1;
+    }
+  } else if (num_contacts == 2) {
+    int const cost_keep =
+      (m_slots[0].active ? distance2(contacts[0].x, contacts[0].y, m_slots[0].x, m_slots[0].y) : 0) +
+      (m_slots[1].active ? distance2(contacts[1].x, contacts[1].y, m_slots[1].x, m_slots[1].y) : 0);
+    int const cost_swap =
+      (m_slots[0].active ? distance2(contacts[1].x, contacts[1].y, m_slots[0].x, m_slots[0].y) : 0) +
+      (m_slots[1].active ? distance2(contacts[0].x, contacts[0].y, m_slots[1].x, m_slots[1].y) : 0);
+    if (cost_swap < cost_keep) {
+      std::swap(assignment[0], assignment[1]);
+    }
+  }
+
+  bool used[2] = { false, false };
+  for (int i = 0; i < num_contacts; ++i) {
+    send_slot(assignment[i], true, contacts[i].x, contacts[i].y);
+    used[assignment[i]] = true;
+  }
+
+  for (int slot_idx = 0; slot_idx < 2; ++slot_idx) {
+    if (!used[slot_idx] && m_slots[slot_idx].active) {
+      send_slot(slot_idx, false, 0, 0);
+    }
+  }
+}
+
+template<typename Layout>
+void
+MultitouchDriver<Layout>::send_slot(int slot_idx, bool active, int x, int y)
+{
+  Slot& slot = m_slots[slot_idx];
+
+  m_mt_slot->send(slot_idx);
+
+  if (!active) {
+    m_mt_tracking_id->send(-1);
+    slot.active = false;
+    return;
+  }
+
+  if (!slot.active) {
+    m_mt_tracking_id->send(m_next_tracking_id);
+    m_next_tracking_id = (m_next_tracking_id + 1) & 0xffff;
+    slot.active = true;
+  }
+
+  m_mt_position_x->send(x);
+  m_mt_position_y->send(y);
+
+  slot.x = x;
+  slot.y = y;
+}
+
+#define INSTANTIATE(Layout) template class MultitouchDriver<Layout>;
+UDRAW_FOR_EACH_LAYOUT(INSTANTIATE)
+#undef INSTANTIATE
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,91 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_MULTITOUCH_DRIVER_HPP
+#define HEADER_MULTITOUCH_DRIVER_HPP
+
+#include "driver.hpp"
+
+#include <array>
+
+#include "fwd.hpp"
+#include "touch_contacts.hpp"
+
+namespace udraw {
+
+/** Presents the tablet as a touchpad speaking multitouch protocol
+    type B, gesture recognition is left to libinput */
+template<typename Layout>
+class MultitouchDriver : public Driver
+{
+public:
+  MultitouchDriver(uinpp::MultiDevice& evdev, DeviceProfile const& profile);
+  ~MultitouchDriver() override;
+
+  void init() override;
+  void receive_data(uint8_t const* data, size_t size) override;
+
+private:
+  struct Slot
+  {
+    bool active;
+    int x;
+    int y;
+  };
+
+  void update_contacts(TouchContact const* contacts, int num_contacts);
+  void send_slot(int slot_idx, bool active, int x, int y);
+
+private:
+  uinpp::MultiDevice& m_evdev;
+  DeviceProfile const& m_profile;
+
+  uinpp::EventEmitter* m_start;
+  uinpp::EventEmitter* m_select;
+  uinpp::EventEmitter* m_guide;
+  uinpp::EventEmitter* m_space;
+  uinpp::EventEmitter* m_enter;
+
+  uinpp::EventEmitter* m_btn_left;
+  uinpp::EventEmitter* m_btn_right;
+  uinpp::EventEmitter* m_btn_middle;
+
+  uinpp::EventEmitter* m_btn_touch;
+  uinpp::EventEmitter* m_btn_tool_finger;
+  uinpp::EventEmitter* m_btn_tool_doubletap;
+
+  uinpp::EventEmitter* m_abs_x;
+  uinpp::EventEmitter* m_abs_y;
+
+  uinpp::EventEmitter* m_mt_slot;
+  uinpp::EventEmitter* m_mt_tracking_id;
+  uinpp::EventEmitter* m_mt_position_x;
+  uinpp::EventEmitter* m_mt_position_y;
+
+  std::array<Slot, 2> m_slots;
+  int m_next_tracking_id;
+
+public:
+  MultitouchDriver(const MultitouchDriver&) = delete;
+  MultitouchDriver& operator=(const MultitouchDriver&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
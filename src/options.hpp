@@ -17,6 +17,12 @@
 #ifndef HEADER_UDRAW_OPTIONS_HPP
 #define HEADER_UDRAW_OPTIONS_HPP
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "area_mapping.hpp"
+
 namespace udraw {
 
 struct Options
@@ -27,11 +33,101 @@ struct Options
     GAMEPAD,
     KEYBOARD,
     TOUCHPAD,
+    MULTITOUCH,
     TABLET,
+    PLUGIN,
   };
 
   bool verbose = false;
   Mode mode = Mode::TEST;
+
+  /** present the tablet and multitouch modes through /dev/uhid
+      instead of uinput */
+  bool uhid = false;
+
+  /** PATH[:ARGS] of the plugins used in plugin mode */
+  std::vector<std::string> plugins;
+
+  /** skip all processing of reports that are byte-identical to the
+      previous one, the device repeats its last state while idle */
+  bool idle_skip = true;
+
+  /** thresholds of the touchpad and tablet modes, see
+      Tuning::from_file(), reloaded whenever the file changes */
+  std::string config_filename;
+
+  /** hot zone layout of the touchpad, see HotZoneMap::from_file(),
+      empty uses the default scroll strips */
+  std::string zones_filename;
+
+  /** tablet mode: part of the surface that is used, empty for all of it */
+  Rect tablet_area = {0, 0, 0, 0};
+  /** tablet mode: region of the screen the area is mapped to, empty
+      for the whole screen */
+  Rect tablet_output = {0, 0, 0, 0};
+  /** tablet mode: size of the screen, empty for the size of the output */
+  Rect screen = {0, 0, 0, 0};
+  /** tablet mode: clockwise rotation of the tablet in degrees */
+  int tablet_rotation = 0;
+  /** tablet mode: shrink the area to the aspect ratio of the output */
+  bool keep_aspect = false;
+  /** tablet mode: turn the mapping around when the accelerometer sees
+      the tablet held upside down */
+  bool auto_rotate = false;
+  /** tablet mode: emit the pen at this rate in Hz, interpolated between
+      reports, 0 emits it with every report */
+  double resample_rate = 0.0;
+
+  /** gamepad mode: an analog stick centered where the finger or pen
+      touches down */
+  bool virtual_stick = false;
+  /** surface units for full deflection */
+  int stick_radius = 200;
+  /** share of the radius that reads as centered */
+  double stick_deadzone = 0.1;
+  /** exponent of the response curve, above 1 gives finer control
+      near the center */
+  double stick_curve = 1.0;
+
+  /** keep scrolling after the fingers got lifted */
+  bool kinetic_scrolling = true;
+
+  /** rate in Hz at which relative motion is emitted, 0 emits it with
+      every report */
+  double output_rate = 0.0;
+
+  /** publish decoded samples in shared memory at this path */
+  std::string shm_path;
+
+  /** only members of this group can read the shared memory, everyone
+      can when empty */
+  std::string shm_group;
+
+  /** seconds of raw reports kept for dumping, 0 disables the recorder */
+  int flight_recorder_seconds = 10;
+  std::string flight_recorder_dir = "/tmp";
+
+  /** VID:PID of the device to open instead of looking for one from
+      the profile table */
+  std::string device;
+
+  /** read reports from this capture file instead of the device */
+  std::string replay_filename;
+
+  /** feed synthetic reports of this ReportGenerator pattern instead of
+      reading the device */
+  std::string generate_pattern;
+  /** reports per second, 0 feeds them as fast as possible */
+  double generate_rate = 100.0;
+  /** number of reports, 0 generates until interrupted */
+  uint64_t generate_count = 0;
+
+  /** count cycles, cache misses and the like for every report that
+      reaches the output driver */
+  bool perf_counters = false;
+
+  /** write a Chrome trace of the input pipeline, needs UDRAW_TRACING */
+  std::string trace_filename;
 };
 
 } // namespace udraw
@@ -0,0 +1,132 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "pen_resampler.hpp"
+
+#include <cstdint>
+
+namespace udraw {
+
+namespace {
+
+/** the device repeats its last report while the pen is at rest,
+    those repeats are dropped before they reach the driver */
+auto const idle_time = std::chrono::milliseconds(50);
+
+int lerp(int a, int b, int64_t num, int64_t den)
+{
+  return a + static_cast<int>((static_cast<int64_t>(b - a) * num + den / 2) / den);
+}
+
+} // namespace
+
+PenResampler::PenResampler(std::chrono::nanoseconds period) :
+  m_period(period),
+  m_samples(),
+  m_num_samples(0),
+  m_next_sample(0)
+{
+}
+
+void
+PenResampler::reset(Sample const& sample)
+{
+  m_num_samples = 0;
+  m_next_sample = 0;
+  add(sample);
+}
+
+void
+PenResampler::add(Sample const& sample)
+{
+  m_samples[m_next_sample] = sample;
+  m_next_sample = (m_next_sample + 1) % m_samples.size();
+  if (m_num_samples < m_samples.size()) {
+    m_num_samples += 1;
+  }
+}
+
+PenResampler::Sample
+PenResampler::sample(clock::time_point now) const
+{
+  clock::time_point const time = now - m_period;
+
+  // walk from the newest sample back to the first one at or before time
+  Sample const* later = nullptr;
+  for (size_t i = 1; i <= m_num_samples; ++i)
+  {
+    Sample const& earlier = m_samples[(m_next_sample + m_samples.size() - i) % m_samples.size()];
+    if (earlier.time <= time)
+    {
+      if (!later) {
+        return extrapolate(time);
+      }
+
+      int64_t const num = std::chrono::duration_cast<std::chrono::nanoseconds>(time - earlier.time).count();
+      int64_t const den = std::chrono::duration_cast<std::chrono::nanoseconds>(later->time - earlier.time).count();
+      if (den <= 0) {
+        return *later;
+      }
+
+      return Sample{
+        time,
+        lerp(earlier.x, later->x, num, den),
+        lerp(earlier.y, later->y, num, den),
+        lerp(earlier.pressure, later->pressure, num, den)
+      };
+    }
+    later = &earlier;
+  }
+
+  // the whole history is newer, start from its oldest report
+  return *later;
+}
+
+PenResampler::Sample
+PenResampler::extrapolate(clock::time_point time) const
+{
+  Sample const& last = newest();
+
+  // a pen at rest sends nothing, continuing its motion would make it drift
+  if (m_num_samples < 2 || time - last.time > idle_time) {
+    return last;
+  }
+
+  Sample const& prev = m_samples[(m_next_sample + m_samples.size() - 2) % m_samples.size()];
+  int64_t const den = std::chrono::duration_cast<std::chrono::nanoseconds>(last.time - prev.time).count();
+  if (den <= 0) {
+    return last;
+  }
+
+  // pressure is held, so it can't run out of the device's range
+  int64_t const num = den + std::chrono::duration_cast<std::chrono::nanoseconds>(time - last.time).count();
+  return Sample{
+    time,
+    lerp(prev.x, last.x, num, den),
+    lerp(prev.y, last.y, num, den),
+    last.pressure
+  };
+}
+
+bool
+PenResampler::idle(clock::time_point now) const
+{
+  return now - newest().time > m_period + idle_time;
+}
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,82 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_UDRAW_PEN_RESAMPLER_HPP
+#define HEADER_UDRAW_PEN_RESAMPLER_HPP
+
+#include <array>
+#include <chrono>
+
+namespace udraw {
+
+/** Turns pen reports that arrive with jitter into samples at a fixed
+    rate. The output trails the reports by one period and positions
+    and pressure in between are interpolated linearly. When the next
+    report is late the position is extrapolated from the last two
+    reports, so the output never lags more than one period behind.
+    Only once no report arrived for longer than the device takes to
+    go quiet is the newest report held. */
+class PenResampler
+{
+public:
+  using clock = std::chrono::steady_clock;
+
+  struct Sample
+  {
+    clock::time_point time;
+    int x;
+    int y;
+    int pressure;
+  };
+
+public:
+  PenResampler(std::chrono::nanoseconds period);
+
+  /** Forget the history and continue from \a sample, used on pen
+      down and up so that no stroke gets interpolated across them */
+  void reset(Sample const& sample);
+
+  /** Record a report, times must be increasing */
+  void add(Sample const& sample);
+
+  /** The pen as it was one period before \a now, needs at least
+      one report and two to extrapolate */
+  Sample sample(clock::time_point now) const;
+
+  Sample const& newest() const { return m_samples[(m_next_sample + m_samples.size() - 1) % m_samples.size()]; }
+
+  /** No report for a while, the output won't change anymore */
+  bool idle(clock::time_point now) const;
+
+  std::chrono::nanoseconds period() const { return m_period; }
+
+private:
+  /** The newest report is before \a time, continue the motion between
+      the last two */
+  Sample extrapolate(clock::time_point time) const;
+
+private:
+  std::chrono::nanoseconds m_period;
+  std::array<Sample, 4> m_samples;
+  size_t m_num_samples;
+  size_t m_next_sample;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -0,0 +1,273 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "perf_counters.hpp"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <string>
+
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+
+namespace udraw {
+
+namespace {
+
+struct EventType
+{
+  char const* name;
+  uint32_t type;
+  uint64_t config;
+};
+
+EventType const perf_events[] = {
+  { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+  { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+  { "cache misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+  { "branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+  { "ctx switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+  { "task clock ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+};
+
+int perf_event_open(perf_event_attr* attr, int group_fd)
+{
+  // the calling thread on any CPU
+  return static_cast<int>(syscall(SYS_perf_event_open, attr, 0, -1, group_fd, 0));
+}
+
+int64_t now_nsec()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+uint64_t to_nsec(timeval const& tv)
+{
+  return uint64_t(tv.tv_sec) * 1000000000 + uint64_t(tv.tv_usec) * 1000;
+}
+
+/** nearest-rank percentile of a sorted series */
+uint64_t percentile(std::vector<uint64_t> const& sorted, double p)
+{
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t const rank = static_cast<size_t>(ceil(p / 100.0 * static_cast<double>(sorted.size())));
+  return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+} // namespace
+
+PerfCounters::PerfCounters() :
+  m_source(Source::RUSAGE),
+  m_group_fd(-1),
+  m_fds(),
+  m_counters(),
+  m_rusage_cpu(false),
+  m_rusage_switches(false),
+  m_count(0),
+  m_begin()
+{
+  m_counters.push_back(Counter{"wall ns", 0, 0, {}});
+
+  // counting kernel time needs perf_event_paranoid <= 1, the uinput
+  // writes are in the kernel, so only fall back to user space when
+  // nothing else is allowed
+  open_perf(false);
+  if (m_fds.empty()) {
+    open_perf(true);
+  }
+
+  if (m_fds.empty()) {
+    log_warn("perf_event_open: {}, falling back to getrusage()", strerror(errno));
+    m_source = Source::RUSAGE;
+    m_rusage_cpu = true;
+    m_counters.push_back(Counter{"cpu ns", 0, 0, {}});
+  }
+
+  bool const has_switches = std::any_of(m_counters.begin(), m_counters.end(), [](Counter const& counter) {
+    return strcmp(counter.name, "ctx switches") == 0;
+  });
+  if (!has_switches) {
+    m_rusage_switches = true;
+    m_counters.push_back(Counter{"ctx switches", 0, 0, {}});
+  }
+
+  for (Counter& counter : m_counters) {
+    counter.window.resize(WINDOW);
+  }
+
+  if (m_group_fd >= 0) {
+    ioctl(m_group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(m_group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+
+  std::string names;
+  for (size_t i = 1; i < m_counters.size(); ++i) {
+    names += (i == 1 ? "" : ", ");
+    names += m_counters[i].name;
+  }
+  log_info("perf counters ({}): {}", to_string(m_source), names);
+}
+
+PerfCounters::~PerfCounters()
+{
+  for (int const fd : m_fds) {
+    close(fd);
+  }
+}
+
+void
+PerfCounters::open_perf(bool user_only)
+{
+  bool hardware = false;
+
+  for (EventType const& event : perf_events)
+  {
+    // context switches happen in the kernel and always read zero
+    // when it is excluded
+    if (user_only && event.type == PERF_TYPE_SOFTWARE &&
+        event.config == PERF_COUNT_SW_CONTEXT_SWITCHES) {
+      continue;
+    }
+
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.disabled = (m_group_fd < 0);
+    attr.exclude_kernel = user_only;
+    attr.exclude_hv = 1;
+
+    int const fd = perf_event_open(&attr, m_group_fd);
+    if (fd < 0) {
+      log_debug("perf_event_open({}): {}", event.name, strerror(errno));
+      continue;
+    }
+
+    if (m_group_fd < 0) {
+      m_group_fd = fd;
+    }
+    m_fds.push_back(fd);
+    m_counters.push_back(Counter{event.name, 0, 0, {}});
+    hardware = hardware || event.type == PERF_TYPE_HARDWARE;
+  }
+
+  m_source = hardware ? Source::HARDWARE : Source::SOFTWARE;
+  if (user_only && !m_fds.empty()) {
+    log_info("perf counters only cover user space, lower /proc/sys/kernel/perf_event_paranoid to include the kernel");
+  }
+}
+
+void
+PerfCounters::read_values(uint64_t* values) const
+{
+  values[0] = static_cast<uint64_t>(now_nsec());
+  size_t idx = 1;
+
+  if (m_group_fd >= 0)
+  {
+    // PERF_FORMAT_GROUP: { nr, value[nr] }
+    uint64_t buf[1 + MAX_COUNTERS];
+    ssize_t const len = ::read(m_group_fd, buf, sizeof(buf));
+    size_t const nr = (len >= static_cast<ssize_t>(sizeof(uint64_t))) ? std::min<size_t>(buf[0], m_fds.size()) : 0;
+    for (size_t i = 0; i < m_fds.size(); ++i) {
+      values[idx++] = (i < nr) ? buf[1 + i] : 0;
+    }
+  }
+
+  if (m_rusage_cpu || m_rusage_switches)
+  {
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    if (m_rusage_cpu) {
+      values[idx++] = to_nsec(usage.ru_utime) + to_nsec(usage.ru_stime);
+    }
+    if (m_rusage_switches) {
+      values[idx++] = static_cast<uint64_t>(usage.ru_nvcsw + usage.ru_nivcsw);
+    }
+  }
+}
+
+void
+PerfCounters::add(std::array<uint64_t, MAX_COUNTERS> const& values)
+{
+  size_t const slot = m_count % WINDOW;
+  for (size_t i = 0; i < m_counters.size(); ++i) {
+    Counter& counter = m_counters[i];
+    uint64_t const delta = values[i] - m_begin[i];
+    counter.sum += delta;
+    counter.max = std::max(counter.max, delta);
+    counter.window[slot] = delta;
+  }
+  m_count += 1;
+}
+
+void
+PerfCounters::print(std::ostream& out) const
+{
+  out << fmt::format("perf counters ({}), {} reports:\n", to_string(m_source), m_count);
+  if (m_count == 0) {
+    return;
+  }
+
+  out << fmt::format("  {:<14} {:>10} {:>10} {:>10} {:>10} {:>10}\n",
+                     "", "mean", "p50", "p99", "p99.9", "max");
+
+  size_t const size = static_cast<size_t>(std::min<uint64_t>(m_count, WINDOW));
+  std::vector<uint64_t> sorted;
+  for (Counter const& counter : m_counters)
+  {
+    sorted.assign(counter.window.begin(), counter.window.begin() + static_cast<std::ptrdiff_t>(size));
+    std::sort(sorted.begin(), sorted.end());
+    out << fmt::format("  {:<14} {:>10.1f} {:>10} {:>10} {:>10} {:>10}\n",
+                       counter.name,
+                       static_cast<double>(counter.sum) / static_cast<double>(m_count),
+                       percentile(sorted, 50.0),
+                       percentile(sorted, 99.0),
+                       percentile(sorted, 99.9),
+                       counter.max);
+  }
+}
+
+char const* to_string(PerfCounters::Source source)
+{
+  switch (source)
+  {
+    case PerfCounters::Source::HARDWARE: return "hardware";
+    case PerfCounters::Source::SOFTWARE: return "software";
+    case PerfCounters::Source::RUSAGE: return "getrusage";
+  }
+  return "invalid";
+}
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,103 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_UDRAW_PERF_COUNTERS_HPP
+#define HEADER_UDRAW_PERF_COUNTERS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace udraw {
+
+/** Per-thread CPU counters around a section of code. Hardware counters
+    (cycles, instructions, cache and branch misses) and context switches
+    are read through perf_event_open(). Where perf is restricted, as in
+    most containers, only the kernel's software counters are used, and
+    without perf at all the thread's getrusage() values. Wall time is
+    always measured. */
+class PerfCounters
+{
+public:
+  enum class Source { HARDWARE, SOFTWARE, RUSAGE };
+
+  static constexpr size_t MAX_COUNTERS = 8;
+
+  /** number of most recent sections kept for the percentiles */
+  static constexpr size_t WINDOW = 1 << 16;
+
+public:
+  /** Opens the counters for the calling thread, begin() and end() must
+      be called from that thread */
+  PerfCounters();
+  ~PerfCounters();
+
+  void begin()
+  {
+    read_values(m_begin.data());
+  }
+
+  void end()
+  {
+    std::array<uint64_t, MAX_COUNTERS> values;
+    read_values(values.data());
+    add(values);
+  }
+
+  Source source() const { return m_source; }
+  uint64_t count() const { return m_count; }
+
+  /** Mean over all sections, percentiles over the last WINDOW */
+  void print(std::ostream& out) const;
+
+private:
+  void open_perf(bool user_only);
+  void open_rusage();
+  void read_values(uint64_t* values) const;
+  void add(std::array<uint64_t, MAX_COUNTERS> const& values);
+
+private:
+  struct Counter
+  {
+    char const* name;
+    uint64_t sum;
+    uint64_t max;
+    std::vector<uint64_t> window;
+  };
+
+  Source m_source;
+  int m_group_fd;
+  std::vector<int> m_fds;
+  std::vector<Counter> m_counters;
+  bool m_rusage_cpu;
+  bool m_rusage_switches;
+  uint64_t m_count;
+  std::array<uint64_t, MAX_COUNTERS> m_begin;
+
+private:
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+};
+
+char const* to_string(PerfCounters::Source source);
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
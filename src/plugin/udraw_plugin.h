@@ -0,0 +1,154 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_UDRAW_PLUGIN_H
+#define HEADER_UDRAW_PLUGIN_H
+
+/*
+  Plugin interface for udraw-driver, loaded with --plugin PATH[:ARGS].
+
+  A plugin is a shared object that exports udraw_plugin_entry(). The
+  driver calls create() once, init() once to let the plugin set up its
+  devices and then receive() from the input thread for every report,
+  with the report already decoded. Events are sent through emitters
+  obtained in init(), receive() ends with a sync() to flush them.
+
+  This header is plain C. Structs are only ever extended at the end,
+  incompatible changes bump UDRAW_PLUGIN_ABI_VERSION.
+*/
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UDRAW_PLUGIN_ABI_VERSION 1
+
+enum udraw_mode {
+  UDRAW_MODE_NONE = 0,
+  UDRAW_MODE_PEN = 1,
+  UDRAW_MODE_TOUCH = 2,
+  UDRAW_MODE_MULTITOUCH = 3,
+  UDRAW_MODE_UNKNOWN = 4,
+};
+
+enum udraw_button {
+  UDRAW_BUTTON_SQUARE   = 1 << 0,
+  UDRAW_BUTTON_CROSS    = 1 << 1,
+  UDRAW_BUTTON_CIRCLE   = 1 << 2,
+  UDRAW_BUTTON_TRIANGLE = 1 << 3,
+  UDRAW_BUTTON_START    = 1 << 4,
+  UDRAW_BUTTON_SELECT   = 1 << 5,
+  UDRAW_BUTTON_GUIDE    = 1 << 6,
+  UDRAW_BUTTON_UP       = 1 << 7,
+  UDRAW_BUTTON_DOWN     = 1 << 8,
+  UDRAW_BUTTON_LEFT     = 1 << 9,
+  UDRAW_BUTTON_RIGHT    = 1 << 10,
+};
+
+/** A decoded report, same layout as the shared memory samples */
+typedef struct udraw_sample
+{
+  /** CLOCK_MONOTONIC in nanoseconds */
+  int64_t timestamp;
+
+  /** bitmask of udraw_button */
+  uint16_t buttons;
+  /** udraw_mode */
+  uint8_t mode;
+  uint8_t orientation;
+  uint8_t pinch_distance;
+  uint8_t reserved;
+
+  int16_t x;
+  int16_t y;
+  int16_t pressure;
+  int16_t accel_x;
+  int16_t accel_y;
+  int16_t accel_z;
+
+  uint8_t padding[6];
+} udraw_sample;
+
+enum udraw_device_type {
+  UDRAW_DEVICE_GENERIC = 0,
+  UDRAW_DEVICE_KEYBOARD = 1,
+  UDRAW_DEVICE_MOUSE = 2,
+  UDRAW_DEVICE_JOYSTICK = 3,
+};
+
+enum udraw_log_level {
+  UDRAW_LOG_ERROR = 0,
+  UDRAW_LOG_WARNING = 1,
+  UDRAW_LOG_INFO = 2,
+  UDRAW_LOG_DEBUG = 3,
+};
+
+typedef struct udraw_host udraw_host;
+typedef struct udraw_device udraw_device;
+typedef struct udraw_emitter udraw_emitter;
+
+/** Functions the driver provides, only valid while the plugin is
+    loaded. Devices and emitters can only be created in init(), they
+    return NULL on error. */
+typedef struct udraw_host_api
+{
+  uint32_t abi_version;
+
+  udraw_device* (*create_device)(udraw_host* host, int type, char const* name);
+  udraw_emitter* (*add_key)(udraw_device* device, int code);
+  udraw_emitter* (*add_rel)(udraw_device* device, int code);
+  udraw_emitter* (*add_abs)(udraw_device* device, int code, int min, int max,
+                            int fuzz, int flat, int resolution);
+
+  /** queue an event, values that didn't change are dropped */
+  void (*send)(udraw_emitter* emitter, int value);
+  /** write out the queued events of all devices */
+  void (*sync)(udraw_host* host);
+
+  void (*log)(udraw_host* host, int level, char const* message);
+} udraw_host_api;
+
+typedef struct udraw_plugin
+{
+  /** must be UDRAW_PLUGIN_ABI_VERSION */
+  uint32_t abi_version;
+  char const* name;
+
+  /** \a args is the text after the ':' of --plugin, or "". Returns the
+      plugin's state, passed to the other functions, or NULL on error. */
+  void* (*create)(udraw_host* host, udraw_host_api const* api, char const* args);
+
+  /** create devices and emitters, return 0 on success */
+  int (*init)(void* self);
+
+  /** called for every report, must not block */
+  void (*receive)(void* self, udraw_sample const* sample);
+
+  void (*destroy)(void* self);
+} udraw_plugin;
+
+/** The one symbol a plugin exports */
+udraw_plugin const* udraw_plugin_entry(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* EOF */
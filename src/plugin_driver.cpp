@@ -0,0 +1,296 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "plugin_driver.hpp"
+
+#include <dlfcn.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+#include <uinpp/event_emitter.hpp>
+#include <uinpp/multi_device.hpp>
+#include <uinpp/virtual_device.hpp>
+
+#include "async_log.hpp"
+#include "device_profile.hpp"
+#include "trace.hpp"
+#include "udraw_decoder.hpp"
+
+namespace udraw {
+
+namespace {
+
+static_assert(sizeof(udraw_sample) == sizeof(Sample), "udraw_sample must match Sample");
+static_assert(offsetof(udraw_sample, x) == offsetof(Sample, x), "udraw_sample must match Sample");
+static_assert(offsetof(udraw_sample, accel_z) == offsetof(Sample, accel_z), "udraw_sample must match Sample");
+static_assert(UDRAW_MODE_MULTITOUCH == static_cast<int>(UDrawDecoderBase::Mode::MULTITOUCH), "udraw_mode must match");
+static_assert(static_cast<int>(UDRAW_BUTTON_RIGHT) == static_cast<int>(Sample::RIGHT), "udraw_button must match Sample::Button");
+
+int64_t now_nsec()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// The host API is called from C, nothing may throw through it
+
+udraw_device* host_create_device(udraw_host* host, int type, char const* name)
+{
+  if (!host->initializing) {
+    log_error("{}: devices can only be created in init()", host->name);
+    return nullptr;
+  }
+
+  uinpp::DeviceType device_type;
+  switch (type)
+  {
+    case UDRAW_DEVICE_GENERIC: device_type = uinpp::DeviceType::GENERIC; break;
+    case UDRAW_DEVICE_KEYBOARD: device_type = uinpp::DeviceType::KEYBOARD; break;
+    case UDRAW_DEVICE_MOUSE: device_type = uinpp::DeviceType::MOUSE; break;
+    case UDRAW_DEVICE_JOYSTICK: device_type = uinpp::DeviceType::JOYSTICK; break;
+    default:
+      log_error("{}: unknown device type {}", host->name, type);
+      return nullptr;
+  }
+
+  try {
+    uinpp::VirtualDevice* device = host->evdev->create_device(host->device_id, device_type);
+    device->set_name(name ? name : host->name);
+    device->set_usbid(0x3, host->profile->vendor_id, host->profile->product_id, 0x110);
+    return reinterpret_cast<udraw_device*>(device);
+  } catch (std::exception const& err) {
+    log_error("{}: create_device: {}", host->name, err.what());
+    return nullptr;
+  }
+}
+
+template<typename F>
+udraw_emitter* add_event(udraw_device* device, char const* what, int code, F&& func)
+{
+  try {
+    return reinterpret_cast<udraw_emitter*>(func(reinterpret_cast<uinpp::VirtualDevice*>(device)));
+  } catch (std::exception const& err) {
+    async_log_error("{}({}): {}", what, code, err.what());
+    return nullptr;
+  }
+}
+
+udraw_emitter* host_add_key(udraw_device* device, int code)
+{
+  return add_event(device, "add_key", code, [&](uinpp::VirtualDevice* dev) { return dev->add_key(code); });
+}
+
+udraw_emitter* host_add_rel(udraw_device* device, int code)
+{
+  return add_event(device, "add_rel", code, [&](uinpp::VirtualDevice* dev) { return dev->add_rel(code); });
+}
+
+udraw_emitter* host_add_abs(udraw_device* device, int code, int min, int max,
+                            int fuzz, int flat, int resolution)
+{
+  return add_event(device, "add_abs", code, [&](uinpp::VirtualDevice* dev) {
+    return dev->add_abs(code, min, max, fuzz, flat, resolution);
+  });
+}
+
+void host_send(udraw_emitter* emitter, int value)
+{
+  try {
+    reinterpret_cast<uinpp::EventEmitter*>(emitter)->send(value);
+  } catch (std::exception const& err) {
+    async_log_error("send: {}", err.what());
+  }
+}
+
+void host_sync(udraw_host* host)
+{
+  try {
+    host->evdev->sync();
+  } catch (std::exception const& err) {
+    async_log_error("{}: sync: {}", host->name, err.what());
+  }
+}
+
+void host_log(udraw_host* host, int level, char const* message)
+{
+  switch (level)
+  {
+    case UDRAW_LOG_ERROR: async_log_error("{}: {}", host->name, message); break;
+    case UDRAW_LOG_WARNING: async_log_warn("{}: {}", host->name, message); break;
+    case UDRAW_LOG_INFO: async_log_info("{}: {}", host->name, message); break;
+    default: async_log_debug("{}: {}", host->name, message); break;
+  }
+}
+
+udraw_host_api const host_api = {
+  UDRAW_PLUGIN_ABI_VERSION,
+  &host_create_device,
+  &host_add_key,
+  &host_add_rel,
+  &host_add_abs,
+  &host_send,
+  &host_sync,
+  &host_log,
+};
+
+} // namespace
+
+template<typename Layout>
+PluginDriver<Layout>::PluginDriver(uinpp::MultiDevice& evdev, std::vector<std::string> const& specs,
+                                   DeviceProfile const& profile) :
+  m_evdev(evdev),
+  m_profile(profile),
+  m_plugins()
+{
+  for (std::string const& spec : specs) {
+    load(spec);
+  }
+}
+
+template<typename Layout>
+PluginDriver<Layout>::~PluginDriver()
+{
+  for (Plugin& plugin : m_plugins)
+  {
+    if (plugin.count > 0) {
+      log_info("plugin {}: {} reports, {:.2f} usec mean, {:.2f} usec max",
+               plugin.host->name, plugin.count,
+               static_cast<double>(plugin.total_nsec) / static_cast<double>(plugin.count) / 1000.0,
+               static_cast<double>(plugin.max_nsec) / 1000.0);
+    }
+
+    if (plugin.self) {
+      plugin.entry->destroy(plugin.self);
+    }
+    dlclose(plugin.handle);
+  }
+}
+
+template<typename Layout>
+void
+PluginDriver<Layout>::load(std::string const& spec)
+{
+  // the arguments follow the first ':' after the directory part
+  std::string::size_type const slash = spec.rfind('/');
+  std::string::size_type const colon = spec.find(':', slash == std::string::npos ? 0 : slash);
+  std::string const path = spec.substr(0, colon);
+  std::string const args = (colon == std::string::npos) ? std::string() : spec.substr(colon + 1);
+
+  void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!handle) {
+    // dlerror() already names the file
+    throw std::runtime_error(dlerror());
+  }
+
+  Plugin plugin{path, handle, nullptr, nullptr, nullptr, 0, 0, 0};
+  try {
+    auto const entry_func = reinterpret_cast<udraw_plugin const* (*)()>(dlsym(handle, "udraw_plugin_entry"));
+    if (!entry_func) {
+      throw std::runtime_error("udraw_plugin_entry() not found");
+    }
+
+    plugin.entry = entry_func();
+    if (!plugin.entry || plugin.entry->abi_version != UDRAW_PLUGIN_ABI_VERSION) {
+      throw std::runtime_error(fmt::format("plugin ABI version {}, driver has {}",
+                                           plugin.entry ? plugin.entry->abi_version : 0,
+                                           UDRAW_PLUGIN_ABI_VERSION));
+    }
+
+    if (!plugin.entry->create || !plugin.entry->init ||
+        !plugin.entry->receive || !plugin.entry->destroy) {
+      throw std::runtime_error("plugin is missing functions");
+    }
+
+    plugin.host = std::make_unique<udraw_host>(udraw_host{
+        &m_evdev,
+        static_cast<uint32_t>(m_plugins.size()),
+        &m_profile,
+        plugin.entry->name ? plugin.entry->name : path,
+        false});
+
+    plugin.self = plugin.entry->create(plugin.host.get(), &host_api, args.c_str());
+    if (!plugin.self) {
+      throw std::runtime_error("create() failed");
+    }
+  } catch (std::exception const& err) {
+    dlclose(handle);
+    throw std::runtime_error(fmt::format("{}: {}", path, err.what()));
+  }
+
+  log_info("loaded plugin {} from {}", plugin.host->name, path);
+  m_plugins.push_back(std::move(plugin));
+}
+
+template<typename Layout>
+void
+PluginDriver<Layout>::init()
+{
+  for (Plugin& plugin : m_plugins)
+  {
+    plugin.host->initializing = true;
+    int const ret = plugin.entry->init(plugin.self);
+    plugin.host->initializing = false;
+
+    if (ret != 0) {
+      throw std::runtime_error(fmt::format("{}: init() failed: {}", plugin.path, ret));
+    }
+  }
+
+  m_evdev.finish();
+}
+
+template<typename Layout>
+void
+PluginDriver<Layout>::receive_data(uint8_t const* data, size_t size)
+{
+  udraw_sample sample;
+  Sample const decoded = to_sample(BasicUDrawDecoder<Layout>(data, size), now_nsec());
+  std::memcpy(&sample, &decoded, sizeof(sample));
+
+  int64_t start = now_nsec();
+
+  for (Plugin& plugin : m_plugins)
+  {
+    plugin.entry->receive(plugin.self, &sample);
+
+    int64_t const end = now_nsec();
+    int64_t const elapsed = end - start;
+    plugin.count += 1;
+    plugin.total_nsec += elapsed;
+    plugin.max_nsec = std::max(plugin.max_nsec, elapsed);
+    start = end;
+  }
+
+  {
+    UDRAW_TRACE_SCOPE("sync");
+    m_evdev.sync();
+  }
+}
+
+#define INSTANTIATE(Layout) template class PluginDriver<Layout>;
+UDRAW_FOR_EACH_LAYOUT(INSTANTIATE)
+#undef INSTANTIATE
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,88 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_UDRAW_PLUGIN_DRIVER_HPP
+#define HEADER_UDRAW_PLUGIN_DRIVER_HPP
+
+#include "driver.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fwd.hpp"
+#include "plugin/udraw_plugin.h"
+
+struct udraw_host
+{
+  uinpp::MultiDevice* evdev;
+  uint32_t device_id;
+  /** the IDs given to the created devices */
+  udraw::DeviceProfile const* profile;
+  std::string name;
+  /** devices can only be created before MultiDevice::finish() */
+  bool initializing;
+};
+
+namespace udraw {
+
+/** Runs Drivers loaded from shared objects, see plugin/udraw_plugin.h */
+template<typename Layout>
+class PluginDriver : public Driver
+{
+public:
+  /** \a specs are PATH[:ARGS], the plugins receive each report in
+      that order */
+  PluginDriver(uinpp::MultiDevice& evdev, std::vector<std::string> const& specs,
+               DeviceProfile const& profile);
+  ~PluginDriver() override;
+
+  void init() override;
+  void receive_data(uint8_t const* data, size_t size) override;
+
+private:
+  struct Plugin
+  {
+    std::string path;
+    void* handle;
+    udraw_plugin const* entry;
+    std::unique_ptr<udraw_host> host;
+    void* self;
+
+    /** time spent in receive() */
+    uint64_t count;
+    int64_t total_nsec;
+    int64_t max_nsec;
+  };
+
+  void load(std::string const& spec);
+
+private:
+  uinpp::MultiDevice& m_evdev;
+  DeviceProfile const& m_profile;
+  std::vector<Plugin> m_plugins;
+
+private:
+  PluginDriver(const PluginDriver&) = delete;
+  PluginDriver& operator=(const PluginDriver&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
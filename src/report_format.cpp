@@ -0,0 +1,82 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "report_format.hpp"
+
+#include "options.hpp"
+
+#include "gamepad_driver.hpp"
+#include "keyboard_driver.hpp"
+#include "multitouch_driver.hpp"
+#include "plugin_driver.hpp"
+#include "tablet_driver.hpp"
+#include "touchpad_driver.hpp"
+#include "uhid_multitouch_driver.hpp"
+#include "uhid_tablet_driver.hpp"
+
+namespace udraw {
+
+template<typename Layout>
+std::unique_ptr<Driver> create_driver(uinpp::MultiDevice& evdev, Options const& opts,
+                                      TuningStore const& tuning, DeviceProfile const& profile)
+{
+  if (opts.mode == Options::Mode::KEYBOARD)
+  {
+    return std::make_unique<KeyboardDriver<Layout>>(evdev);
+  }
+  else if (opts.mode == Options::Mode::GAMEPAD)
+  {
+    return std::make_unique<GamepadDriver<Layout>>(evdev, opts, profile);
+  }
+  else if (opts.mode == Options::Mode::TABLET && opts.uhid)
+  {
+    return std::make_unique<UHIDTabletDriver<Layout>>(tuning, profile);
+  }
+  else if (opts.mode == Options::Mode::TABLET)
+  {
+    return std::make_unique<TabletDriver<Layout>>(evdev, opts, tuning, profile);
+  }
+  else if (opts.mode == Options::Mode::TOUCHPAD)
+  {
+    return std::make_unique<TouchpadDriver<Layout>>(evdev, opts, tuning, profile);
+  }
+  else if (opts.mode == Options::Mode::MULTITOUCH && opts.uhid)
+  {
+    return std::make_unique<UHIDMultitouchDriver<Layout>>(profile);
+  }
+  else if (opts.mode == Options::Mode::MULTITOUCH)
+  {
+    return std::make_unique<MultitouchDriver<Layout>>(evdev, profile);
+  }
+  else if (opts.mode == Options::Mode::PLUGIN)
+  {
+    return std::make_unique<PluginDriver<Layout>>(evdev, opts.plugins, profile);
+  }
+  else
+  {
+    return {};
+  }
+}
+
+#define INSTANTIATE(Layout) \
+  template std::unique_ptr<Driver> create_driver<Layout>(uinpp::MultiDevice& evdev, Options const& opts, \
+                                                         TuningStore const& tuning, DeviceProfile const& profile);
+UDRAW_FOR_EACH_LAYOUT(INSTANTIATE)
+#undef INSTANTIATE
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,76 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_UDRAW_REPORT_FORMAT_HPP
+#define HEADER_UDRAW_REPORT_FORMAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+
+#include "fwd.hpp"
+#include "shm/sample.hpp"
+#include "udraw_decoder.hpp"
+
+namespace udraw {
+
+/** The entry points for reports in one layout, BasicUDrawDecoder and
+    the drivers instantiated for it. A device is tied to its layout by
+    DeviceProfile::format. */
+struct ReportFormat
+{
+  UDrawDecoderBase::Error (*validate)(uint8_t const* data, size_t size) noexcept;
+
+  /** \a data must have passed validate() */
+  Sample (*to_sample)(uint8_t const* data, size_t size, int64_t timestamp);
+  void (*print)(std::ostream& os, uint8_t const* data, size_t size);
+
+  std::unique_ptr<Driver> (*create_driver)(uinpp::MultiDevice& evdev, Options const& opts,
+                                           TuningStore const& tuning, DeviceProfile const& profile);
+};
+
+/** The driver for Options::mode, nullptr in the modes that only print
+    the reports, instantiated for every layout in UDRAW_FOR_EACH_LAYOUT */
+template<typename Layout>
+std::unique_ptr<Driver> create_driver(uinpp::MultiDevice& evdev, Options const& opts,
+                                      TuningStore const& tuning, DeviceProfile const& profile);
+
+template<typename Layout>
+Sample decode_sample(uint8_t const* data, size_t size, int64_t timestamp)
+{
+  return to_sample(BasicUDrawDecoder<Layout>(data, size), timestamp);
+}
+
+template<typename Layout>
+void print_report(std::ostream& os, uint8_t const* data, size_t size)
+{
+  os << BasicUDrawDecoder<Layout>(data, size);
+}
+
+template<typename Layout>
+inline ReportFormat const report_format = {
+  &BasicUDrawDecoder<Layout>::validate,
+  &decode_sample<Layout>,
+  &print_report<Layout>,
+  &create_driver<Layout>,
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
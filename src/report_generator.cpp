@@ -0,0 +1,298 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "report_generator.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+namespace udraw {
+
+namespace {
+
+int const MAX_X = 1920;
+int const MAX_Y = 1080;
+int const MAX_PRESSURE = 142;
+
+/** HID style hat value for the d-pad, 0 is up, going clockwise, 15 is
+    centered */
+uint8_t hat_from_buttons(uint16_t buttons)
+{
+  bool const up = buttons & Sample::UP;
+  bool const down = buttons & Sample::DOWN;
+  bool const left = buttons & Sample::LEFT;
+  bool const right = buttons & Sample::RIGHT;
+
+  if (up && right) return 1;
+  if (down && right) return 3;
+  if (down && left) return 5;
+  if (up && left) return 7;
+  if (up) return 0;
+  if (right) return 2;
+  if (down) return 4;
+  if (left) return 6;
+  return 15;
+}
+
+} // namespace
+
+void encode_report(Sample const& sample, uint8_t* data)
+{
+  using L = Ps3Layout;
+
+  memset(data, 0, UDrawDecoder::REPORT_SIZE);
+
+  uint16_t const buttons = sample.buttons;
+  data[L::FACE_BUTTONS] = static_cast<uint8_t>(
+    ((buttons & Sample::SQUARE) ? L::SQUARE : 0) |
+    ((buttons & Sample::CROSS) ? L::CROSS : 0) |
+    ((buttons & Sample::CIRCLE) ? L::CIRCLE : 0) |
+    ((buttons & Sample::TRIANGLE) ? L::TRIANGLE : 0));
+  data[L::SYSTEM_BUTTONS] = static_cast<uint8_t>(
+    ((buttons & Sample::START) ? L::START : 0) |
+    ((buttons & Sample::SELECT) ? L::SELECT : 0) |
+    ((buttons & Sample::GUIDE) ? L::GUIDE : 0));
+  data[L::HAT] = hat_from_buttons(buttons);
+
+  memcpy(data + L::HEADER, &L::HEADER_VALUE, sizeof(L::HEADER_VALUE));
+
+  data[L::RIGHT] = (buttons & Sample::RIGHT) ? 0xff : 0x00;
+  data[L::LEFT] = (buttons & Sample::LEFT) ? 0xff : 0x00;
+  data[L::UP] = (buttons & Sample::UP) ? 0xff : 0x00;
+  data[L::DOWN] = (buttons & Sample::DOWN) ? 0xff : 0x00;
+
+  data[L::MODE] = static_cast<uint8_t>(((sample.mode & 0x03) << L::MODE_SHIFT) |
+                                       (sample.orientation & L::ORIENTATION_MASK));
+  data[L::PINCH_DISTANCE] = sample.pinch_distance;
+  data[L::PRESSURE] = static_cast<uint8_t>(std::clamp(sample.pressure + L::PRESSURE_BIAS, 0, 255));
+
+  // x = hi * 255 + lo, lo stays below 255
+  int const x = std::clamp<int>(sample.x, 0, 255 * 255 + 254);
+  int const y = std::clamp<int>(sample.y, 0, 255 * 255 + 254);
+  data[L::X_HI] = static_cast<uint8_t>(x / 255);
+  data[L::Y_HI] = static_cast<uint8_t>(y / 255);
+  data[L::X_LO] = static_cast<uint8_t>(x % 255);
+  data[L::Y_LO] = static_cast<uint8_t>(y % 255);
+
+  size_t const accel_offsets[3] = { L::ACCEL_X, L::ACCEL_Y, L::ACCEL_Z };
+  int const accel[3] = { sample.accel_x, sample.accel_y, sample.accel_z };
+  for (int i = 0; i < 3; ++i) {
+    int const raw = std::clamp(accel[i] + L::ACCEL_BIAS, 0, 0xffff);
+    data[accel_offsets[i]] = static_cast<uint8_t>(raw & 0xff);
+    data[accel_offsets[i] + 1] = static_cast<uint8_t>(raw >> 8);
+  }
+
+  data[L::TRAILER] = L::TRAILER_VALUE;
+}
+
+ReportGenerator::Pattern
+ReportGenerator::pattern_from_string(std::string const& text)
+{
+  if (text == "strokes") {
+    return Pattern::STROKES;
+  } else if (text == "toggle") {
+    return Pattern::TOGGLE;
+  } else if (text == "buttons") {
+    return Pattern::BUTTONS;
+  } else if (text == "walk") {
+    return Pattern::WALK;
+  } else if (text == "mixed") {
+    return Pattern::MIXED;
+  } else {
+    throw std::runtime_error(fmt::format("unknown pattern: {}", text));
+  }
+}
+
+ReportGenerator::ReportGenerator(Pattern pattern, double rate, uint64_t count, uint32_t seed) :
+  m_pattern(pattern),
+  m_interval(rate > 0.0 ? static_cast<int64_t>(1e9 / rate) : 0),
+  m_count(count),
+  m_generated(0),
+  m_rng(seed),
+  m_sample(),
+  m_stroke_length(0),
+  m_stroke_pos(0),
+  m_hover(0),
+  m_from_x(MAX_X / 2),
+  m_from_y(MAX_Y / 2),
+  m_to_x(MAX_X / 2),
+  m_to_y(MAX_Y / 2),
+  m_current(pattern),
+  m_remaining(0),
+  m_data()
+{
+  m_sample.x = MAX_X / 2;
+  m_sample.y = MAX_Y / 2;
+  m_sample.accel_z = 20;
+}
+
+ReportGenerator::~ReportGenerator()
+{
+}
+
+int
+ReportGenerator::uniform(int min, int max)
+{
+  return std::uniform_int_distribution<int>(min, max)(m_rng);
+}
+
+void
+ReportGenerator::jitter_accel()
+{
+  m_sample.accel_x = static_cast<int16_t>(uniform(-1, 1));
+  m_sample.accel_y = static_cast<int16_t>(uniform(-1, 1));
+  m_sample.accel_z = static_cast<int16_t>(20 + uniform(-1, 1));
+}
+
+bool
+ReportGenerator::next(CaptureRecord& record)
+{
+  if (m_count != 0 && m_generated >= m_count) {
+    return false;
+  }
+
+  if (m_pattern == Pattern::MIXED) {
+    if (m_remaining <= 0) {
+      m_current = static_cast<Pattern>(uniform(0, static_cast<int>(Pattern::WALK)));
+      m_remaining = uniform(200, 1000);
+      m_sample.buttons = 0;
+    }
+    m_remaining -= 1;
+  }
+
+  step(m_current);
+
+  m_sample.timestamp = static_cast<int64_t>(m_generated) * m_interval;
+  encode_report(m_sample, m_data);
+  m_generated += 1;
+
+  record.timestamp = m_sample.timestamp;
+  record.data = m_data;
+  record.size = sizeof(m_data);
+  return true;
+}
+
+void
+ReportGenerator::step(Pattern pattern)
+{
+  switch (pattern)
+  {
+    case Pattern::STROKES: step_strokes(); break;
+    case Pattern::TOGGLE: step_toggle(); break;
+    case Pattern::BUTTONS: step_buttons(); break;
+    case Pattern::WALK: step_walk(); break;
+    case Pattern::MIXED: break;
+  }
+}
+
+void
+ReportGenerator::step_strokes()
+{
+  jitter_accel();
+
+  if (m_hover > 0) {
+    // the pressure sensor flips between 0x71 and 0x72 when idle
+    m_hover -= 1;
+    m_sample.mode = Sample::NONE;
+    m_sample.pressure = static_cast<int16_t>(uniform(0, 1));
+    return;
+  }
+
+  if (m_stroke_pos >= m_stroke_length) {
+    m_from_x = m_to_x;
+    m_from_y = m_to_y;
+    m_to_x = uniform(0, MAX_X);
+    m_to_y = uniform(0, MAX_Y);
+    m_stroke_length = uniform(10, 40);
+    m_stroke_pos = 0;
+  }
+
+  double const t = static_cast<double>(m_stroke_pos) / static_cast<double>(m_stroke_length);
+  m_sample.mode = Sample::PEN;
+  m_sample.x = static_cast<int16_t>(m_from_x + static_cast<int>((m_to_x - m_from_x) * t));
+  m_sample.y = static_cast<int16_t>(m_from_y + static_cast<int>((m_to_y - m_from_y) * t));
+  m_sample.pressure = static_cast<int16_t>(10 + (MAX_PRESSURE - 10) * sin(M_PI * t));
+
+  m_stroke_pos += 1;
+  if (m_stroke_pos >= m_stroke_length) {
+    m_hover = uniform(2, 20);
+  }
+}
+
+void
+ReportGenerator::step_toggle()
+{
+  jitter_accel();
+
+  m_sample.mode = (m_sample.mode == Sample::TOUCH) ? Sample::MULTITOUCH : Sample::TOUCH;
+  m_sample.x = static_cast<int16_t>(std::clamp(m_sample.x + uniform(-4, 4), 0, MAX_X));
+  m_sample.y = static_cast<int16_t>(std::clamp(m_sample.y + uniform(-4, 4), 0, MAX_Y));
+  m_sample.pressure = 0;
+
+  if (m_sample.mode == Sample::MULTITOUCH) {
+    m_sample.orientation = static_cast<uint8_t>(uniform(0, 63));
+    m_sample.pinch_distance = static_cast<uint8_t>(uniform(0, 255));
+  } else {
+    m_sample.orientation = 0;
+    m_sample.pinch_distance = 0;
+  }
+}
+
+void
+ReportGenerator::step_buttons()
+{
+  jitter_accel();
+
+  m_sample.mode = Sample::NONE;
+  m_sample.pressure = 0;
+  m_sample.buttons = static_cast<uint16_t>(uniform(0, 0x7ff));
+}
+
+void
+ReportGenerator::step_walk()
+{
+  if (uniform(0, 99) == 0) {
+    m_sample.mode = static_cast<uint8_t>(uniform(Sample::NONE, Sample::MULTITOUCH));
+  }
+
+  m_sample.x = static_cast<int16_t>(std::clamp(m_sample.x + uniform(-12, 12), 0, MAX_X));
+  m_sample.y = static_cast<int16_t>(std::clamp(m_sample.y + uniform(-12, 12), 0, MAX_Y));
+
+  if (m_sample.mode == Sample::PEN) {
+    m_sample.pressure = static_cast<int16_t>(std::clamp(m_sample.pressure + uniform(-8, 8), 0, MAX_PRESSURE));
+  } else {
+    m_sample.pressure = static_cast<int16_t>(uniform(0, 1));
+  }
+
+  if (m_sample.mode == Sample::MULTITOUCH) {
+    m_sample.orientation = static_cast<uint8_t>((m_sample.orientation + uniform(-1, 1)) & 0x3f);
+    m_sample.pinch_distance = static_cast<uint8_t>(std::clamp(m_sample.pinch_distance + uniform(-4, 4), 0, 255));
+  }
+
+  m_sample.accel_x = static_cast<int16_t>(std::clamp(m_sample.accel_x + uniform(-1, 1), -32, 31));
+  m_sample.accel_y = static_cast<int16_t>(std::clamp(m_sample.accel_y + uniform(-1, 1), -32, 31));
+  m_sample.accel_z = static_cast<int16_t>(std::clamp(m_sample.accel_z + uniform(-1, 1), -32, 31));
+}
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,105 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_REPORT_GENERATOR_HPP
+#define HEADER_UDRAW_REPORT_GENERATOR_HPP
+
+#include <random>
+#include <string>
+
+#include "report_reader.hpp"
+#include "shm/sample.hpp"
+#include "udraw_decoder.hpp"
+
+namespace udraw {
+
+/** Build the raw report that UDrawDecoder decodes to \a sample, values
+    outside of the representable range are clamped */
+void encode_report(Sample const& sample, uint8_t* data);
+
+/** Synthesizes valid reports at a fixed rate, for load testing the
+    drivers with patterns the hardware doesn't produce on demand */
+class ReportGenerator : public ReportReader
+{
+public:
+  enum class Pattern {
+    /** fast pen strokes with a pressure ramp, hovering in between */
+    STROKES,
+    /** a finger rapidly switching between TOUCH and MULTITOUCH */
+    TOGGLE,
+    /** a different set of buttons pressed in every report */
+    BUTTONS,
+    /** random walk of position, pressure, accelerometer and mode */
+    WALK,
+    /** all of the above, switching every few hundred reports */
+    MIXED,
+  };
+
+  static Pattern pattern_from_string(std::string const& text);
+
+public:
+  /** \a rate in reports per second, 0 gives every report the same
+      timestamp so that a replay isn't paced; \a count of 0 is endless */
+  ReportGenerator(Pattern pattern, double rate, uint64_t count, uint32_t seed);
+  ~ReportGenerator() override;
+
+  bool next(CaptureRecord& record) override;
+
+private:
+  void step(Pattern pattern);
+  void step_strokes();
+  void step_toggle();
+  void step_buttons();
+  void step_walk();
+
+  int uniform(int min, int max);
+  void jitter_accel();
+
+private:
+  Pattern m_pattern;
+  int64_t m_interval;
+  uint64_t m_count;
+  uint64_t m_generated;
+  std::mt19937 m_rng;
+
+  Sample m_sample;
+
+  // stroke state
+  int m_stroke_length;
+  int m_stroke_pos;
+  int m_hover;
+  int m_from_x;
+  int m_from_y;
+  int m_to_x;
+  int m_to_y;
+
+  // mixed pattern
+  Pattern m_current;
+  int m_remaining;
+
+  uint8_t m_data[UDrawDecoder::REPORT_SIZE];
+
+private:
+  ReportGenerator(const ReportGenerator&) = delete;
+  ReportGenerator& operator=(const ReportGenerator&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
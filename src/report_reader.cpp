@@ -0,0 +1,42 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "report_reader.hpp"
+
+#include <fstream>
+
+#include "capture.hpp"
+#include "usbmon_reader.hpp"
+
+namespace udraw {
+
+std::unique_ptr<ReportReader> open_report_reader(std::string const& filename)
+{
+  char magic[8] = {};
+  std::ifstream in(filename, std::ios::binary);
+  in.read(magic, sizeof(magic));
+
+  if (in.gcount() == sizeof(magic) && CaptureReader::is_capture(magic)) {
+    return std::make_unique<CaptureReader>(filename);
+  } else {
+    return std::make_unique<UsbmonReader>(filename);
+  }
+}
+
+} // namespace udraw
+
+/* EOF */
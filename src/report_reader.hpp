@@ -0,0 +1,60 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_REPORT_READER_HPP
+#define HEADER_UDRAW_REPORT_READER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace udraw {
+
+struct CaptureRecord
+{
+  /** nanoseconds, only differences between records are meaningful */
+  int64_t timestamp;
+  uint8_t const* data;
+  size_t size;
+};
+
+/** A stream of timestamped raw reports read from a file */
+class ReportReader
+{
+public:
+  ReportReader() {}
+  virtual ~ReportReader() {}
+
+  /** Returns false at the end of the stream, \a record stays valid
+      until the next call */
+  virtual bool next(CaptureRecord& record) = 0;
+
+private:
+  ReportReader(const ReportReader&) = delete;
+  ReportReader& operator=(const ReportReader&) = delete;
+};
+
+/** Open a capture file or a usbmon text or pcap capture, the format is
+    detected from the file contents */
+std::unique_ptr<ReportReader> open_report_reader(std::string const& filename);
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -0,0 +1,154 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "sample_batch.hpp"
+
+#include <string.h>
+
+#include "report_reader.hpp"
+#include "shm/sample.hpp"
+#include "udraw_decoder.hpp"
+
+namespace udraw {
+
+void const*
+SampleBatch::column(Column col) const
+{
+  switch (col)
+  {
+    case TIMESTAMP: return timestamp;
+    case MODE: return mode;
+    case X: return x;
+    case Y: return y;
+    case PRESSURE: return pressure;
+    case ORIENTATION: return orientation;
+    case PINCH_DISTANCE: return pinch_distance;
+    case ACCEL_X: return accel_x;
+    case ACCEL_Y: return accel_y;
+    case ACCEL_Z: return accel_z;
+    case BUTTONS: return buttons;
+    case COLUMN_COUNT: break;
+  }
+  return nullptr;
+}
+
+size_t
+SampleBatch::element_size(Column col)
+{
+  switch (col)
+  {
+    case TIMESTAMP: return sizeof(int64_t);
+    case MODE:
+    case ORIENTATION:
+    case PINCH_DISTANCE: return sizeof(uint8_t);
+    case X:
+    case Y:
+    case PRESSURE:
+    case ACCEL_X:
+    case ACCEL_Y:
+    case ACCEL_Z:
+    case BUTTONS: return sizeof(int16_t);
+    case COLUMN_COUNT: break;
+  }
+  return 0;
+}
+
+void decode_report(uint8_t const* report, SampleBatch& batch, size_t i)
+{
+  UDrawDecoder const decoder(report, UDrawDecoder::REPORT_SIZE);
+  Sample const sample = to_sample(decoder, 0);
+
+  batch.mode[i] = sample.mode;
+  batch.x[i] = sample.x;
+  batch.y[i] = sample.y;
+  batch.pressure[i] = sample.pressure;
+  batch.orientation[i] = sample.orientation;
+  batch.pinch_distance[i] = sample.pinch_distance;
+  batch.accel_x[i] = sample.accel_x;
+  batch.accel_y[i] = sample.accel_y;
+  batch.accel_z[i] = sample.accel_z;
+  batch.buttons[i] = sample.buttons;
+}
+
+void decode_batch_scalar(uint8_t const* reports, size_t count, SampleBatch& batch)
+{
+  for (size_t i = 0; i < count; ++i) {
+    decode_report(reports + i * UDrawDecoder::REPORT_SIZE, batch, i);
+  }
+  batch.size = count;
+}
+
+std::vector<BatchDecoderImpl> batch_decoders()
+{
+  std::vector<BatchDecoderImpl> impls;
+  impls.push_back({ "scalar", &decode_batch_scalar });
+
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.1")) {
+    impls.push_back({ "sse4.1", &decode_batch_sse41 });
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    impls.push_back({ "avx2", &decode_batch_avx2 });
+  }
+#endif
+
+  return impls;
+}
+
+void decode_batch(uint8_t const* reports, size_t count, SampleBatch& batch)
+{
+  static DecodeBatchFunc const decode = batch_decoders().back().decode;
+  decode(reports, count, batch);
+}
+
+BatchReader::BatchReader(ReportReader& reader) :
+  m_reader(reader),
+  m_stats(),
+  m_reports(SampleBatch::CAPACITY * UDrawDecoder::REPORT_SIZE)
+{
+}
+
+bool
+BatchReader::next(SampleBatch& batch)
+{
+  // gather the valid reports into one contiguous block first, the
+  // decoder then runs over it without any branches on validity
+  size_t count = 0;
+  CaptureRecord record;
+  while (count < SampleBatch::CAPACITY && m_reader.next(record))
+  {
+    m_stats.reports += 1;
+
+    UDrawDecoder::Error const error = UDrawDecoder::validate(record.data, record.size);
+    if (error != UDrawDecoder::Error::NONE) {
+      m_stats.rejected[static_cast<size_t>(error)] += 1;
+      continue;
+    }
+
+    memcpy(m_reports.data() + count * UDrawDecoder::REPORT_SIZE, record.data, UDrawDecoder::REPORT_SIZE);
+    batch.timestamp[count] = record.timestamp;
+    count += 1;
+  }
+
+  decode_batch(m_reports.data(), count, batch);
+  return count != 0;
+}
+
+} // namespace udraw
+
+/* EOF */
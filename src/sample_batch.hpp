@@ -0,0 +1,126 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_SAMPLE_BATCH_HPP
+#define HEADER_UDRAW_SAMPLE_BATCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "stats.hpp"
+
+namespace udraw {
+
+class ReportReader;
+
+/** Decoded reports with one contiguous array per field, the layout
+    used for bulk export and analysis */
+struct SampleBatch
+{
+  static constexpr size_t CAPACITY = 4096;
+
+  enum Column {
+    TIMESTAMP,
+    MODE,
+    X,
+    Y,
+    PRESSURE,
+    ORIENTATION,
+    PINCH_DISTANCE,
+    ACCEL_X,
+    ACCEL_Y,
+    ACCEL_Z,
+    BUTTONS,
+    COLUMN_COUNT
+  };
+
+  size_t size = 0;
+
+  alignas(64) int64_t timestamp[CAPACITY];
+  /** UDrawDecoder::Mode */
+  alignas(64) uint8_t mode[CAPACITY];
+  alignas(64) int16_t x[CAPACITY];
+  alignas(64) int16_t y[CAPACITY];
+  alignas(64) int16_t pressure[CAPACITY];
+  alignas(64) uint8_t orientation[CAPACITY];
+  alignas(64) uint8_t pinch_distance[CAPACITY];
+  alignas(64) int16_t accel_x[CAPACITY];
+  alignas(64) int16_t accel_y[CAPACITY];
+  alignas(64) int16_t accel_z[CAPACITY];
+  /** bitmask of Sample::Button */
+  alignas(64) uint16_t buttons[CAPACITY];
+
+  void const* column(Column col) const;
+  static size_t element_size(Column col);
+};
+
+using DecodeBatchFunc = void (*)(uint8_t const* reports, size_t count, SampleBatch& batch);
+
+/** Decode \a count validated reports, stored back to back with a
+    stride of UDrawDecoder::REPORT_SIZE, into \a batch starting at
+    index 0, timestamps are left alone. Uses the fastest implementation
+    the CPU supports, all of them produce identical output. */
+void decode_batch(uint8_t const* reports, size_t count, SampleBatch& batch);
+
+/** Decode a single validated report into row \a i of \a batch */
+void decode_report(uint8_t const* report, SampleBatch& batch, size_t i);
+
+/** Reference implementation on top of UDrawDecoder */
+void decode_batch_scalar(uint8_t const* reports, size_t count, SampleBatch& batch);
+
+#if defined(__x86_64__) || defined(__i386__)
+void decode_batch_sse41(uint8_t const* reports, size_t count, SampleBatch& batch);
+void decode_batch_avx2(uint8_t const* reports, size_t count, SampleBatch& batch);
+#endif
+
+struct BatchDecoderImpl
+{
+  char const* name;
+  DecodeBatchFunc decode;
+};
+
+/** The implementations usable on this CPU, the fastest one last */
+std::vector<BatchDecoderImpl> batch_decoders();
+
+/** Reads reports from a ReportReader and decodes them a batch at a
+    time, invalid reports are counted and dropped */
+class BatchReader
+{
+public:
+  BatchReader(ReportReader& reader);
+
+  /** Returns false when no reports are left */
+  bool next(SampleBatch& batch);
+
+  Stats const& stats() const { return m_stats; }
+
+private:
+  ReportReader& m_reader;
+  Stats m_stats;
+  std::vector<uint8_t> m_reports;
+
+private:
+  BatchReader(const BatchReader&) = delete;
+  BatchReader& operator=(const BatchReader&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -0,0 +1,255 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "sample_batch.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+#include <string.h>
+
+#include "udraw_decoder.hpp"
+
+namespace udraw {
+
+/*
+  Each 32bit lane holds one report, loaded as four little-endian words
+  starting at bytes 0, 7, 11, 15, 19 and 23:
+
+    w0:  buttons[0] buttons[1] hat const
+    w7:  right left up down
+    w11: mode|orientation pinch_distance pressure cross
+    w15: x_hi y_hi x_lo y_lo
+    w19: accel_x_lo accel_x_hi accel_y_lo accel_y_hi
+    w23: accel_z_lo accel_z_hi 0 const
+
+  All fields are computed as 32bit values and truncated to the column
+  width at the end, which is what the static_casts in to_sample() do.
+*/
+
+namespace {
+
+size_t const STRIDE = UDrawDecoder::REPORT_SIZE;
+
+int32_t load32(uint8_t const* p)
+{
+  int32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+__attribute__((target("sse4.1")))
+inline __m128i load_x4(uint8_t const* p)
+{
+  return _mm_setr_epi32(load32(p), load32(p + STRIDE), load32(p + 2 * STRIDE), load32(p + 3 * STRIDE));
+}
+
+/** Narrow four 32bit lanes to 16bit, values are masked to 16bit first
+    so that the unsigned saturation never kicks in */
+__attribute__((target("sse4.1")))
+inline void store16_x4(void* dst, __m128i v)
+{
+  __m128i const packed = _mm_packus_epi32(_mm_and_si128(v, _mm_set1_epi32(0xffff)), _mm_setzero_si128());
+  _mm_storel_epi64(static_cast<__m128i*>(dst), packed);
+}
+
+/** Narrow four 32bit lanes holding values from 0 to 255 to 8bit */
+__attribute__((target("sse4.1")))
+inline void store8_x4(void* dst, __m128i v)
+{
+  __m128i const packed = _mm_packus_epi16(_mm_packus_epi32(v, v), _mm_setzero_si128());
+  int32_t const out = _mm_cvtsi128_si32(packed);
+  memcpy(dst, &out, sizeof(out));
+}
+
+/** Gathers are slow on most CPUs, eight scalar loads combined with an
+    insert are faster */
+__attribute__((target("avx2")))
+inline __m256i load_x8(uint8_t const* p)
+{
+  __m128i const lo = _mm_setr_epi32(load32(p), load32(p + STRIDE), load32(p + 2 * STRIDE), load32(p + 3 * STRIDE));
+  __m128i const hi = _mm_setr_epi32(load32(p + 4 * STRIDE), load32(p + 5 * STRIDE), load32(p + 6 * STRIDE), load32(p + 7 * STRIDE));
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+/** Narrow two columns at once, packus works within 128bit halves, the
+    permute puts a's eight values in the low half and b's in the high */
+__attribute__((target("avx2")))
+inline void store16_x8x2(void* dst_a, void* dst_b, __m256i a, __m256i b)
+{
+  __m256i const word_mask = _mm256_set1_epi32(0xffff);
+  __m256i const packed = _mm256_permute4x64_epi64(
+    _mm256_packus_epi32(_mm256_and_si256(a, word_mask), _mm256_and_si256(b, word_mask)),
+    _MM_SHUFFLE(3, 1, 2, 0));
+  _mm_storeu_si128(static_cast<__m128i*>(dst_a), _mm256_castsi256_si128(packed));
+  _mm_storeu_si128(static_cast<__m128i*>(dst_b), _mm256_extracti128_si256(packed, 1));
+}
+
+__attribute__((target("avx2")))
+inline void store16_x8(void* dst, __m256i v)
+{
+  __m256i const masked = _mm256_and_si256(v, _mm256_set1_epi32(0xffff));
+  __m256i const packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(masked, masked),
+                                                  _MM_SHUFFLE(3, 1, 2, 0));
+  _mm_storeu_si128(static_cast<__m128i*>(dst), _mm256_castsi256_si128(packed));
+}
+
+__attribute__((target("avx2")))
+inline void store8_x8(void* dst, __m256i v)
+{
+  __m128i const v16 = _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+  _mm_storel_epi64(static_cast<__m128i*>(dst), _mm_packus_epi16(v16, v16));
+}
+
+} // namespace
+
+__attribute__((target("sse4.1")))
+void decode_batch_sse41(uint8_t const* reports, size_t count, SampleBatch& batch)
+{
+  __m128i const zero = _mm_setzero_si128();
+  __m128i const byte_mask = _mm_set1_epi32(0xff);
+  __m128i const word_mask = _mm_set1_epi32(0xffff);
+  __m128i const accel_bias = _mm_set1_epi32(Ps3Layout::ACCEL_BIAS);
+  __m128i const pressure_bias = _mm_set1_epi32(Ps3Layout::PRESSURE_BIAS);
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    uint8_t const* const base = reports + i * STRIDE;
+    __m128i const w0 = load_x4(base + 0);
+    __m128i const w7 = load_x4(base + 7);
+    __m128i const w11 = load_x4(base + 11);
+    __m128i const w15 = load_x4(base + 15);
+    __m128i const w19 = load_x4(base + 19);
+    __m128i const w23 = load_x4(base + 23);
+
+    // face buttons are already in Sample::Button order, start and
+    // select move from bits 8,9 to 4,5 and guide from 12 to 6
+    __m128i buttons = _mm_or_si128(
+      _mm_or_si128(_mm_and_si128(w0, _mm_set1_epi32(0x0f)),
+                   _mm_and_si128(_mm_srli_epi32(w0, 4), _mm_set1_epi32(0x30))),
+      _mm_and_si128(_mm_srli_epi32(w0, 6), _mm_set1_epi32(0x40)));
+
+    // d-pad bytes are 0 or 255, any non-zero value counts as pressed
+    __m128i const dpad = _mm_andnot_si128(_mm_cmpeq_epi8(w7, zero), _mm_set1_epi8(1));
+    buttons = _mm_or_si128(buttons, _mm_slli_epi32(_mm_and_si128(dpad, _mm_set1_epi32(0x00000001)), 10)); // right
+    buttons = _mm_or_si128(buttons, _mm_slli_epi32(_mm_and_si128(dpad, _mm_set1_epi32(0x00000100)), 1));  // left
+    buttons = _mm_or_si128(buttons, _mm_srli_epi32(_mm_and_si128(dpad, _mm_set1_epi32(0x00010000)), 9));  // up
+    buttons = _mm_or_si128(buttons, _mm_srli_epi32(_mm_and_si128(dpad, _mm_set1_epi32(0x01000000)), 16)); // down
+
+    __m128i const mode = _mm_and_si128(_mm_srli_epi32(w11, 6), _mm_set1_epi32(0x03));
+    __m128i const orientation = _mm_and_si128(w11, _mm_set1_epi32(0x3f));
+    __m128i const pinch = _mm_and_si128(_mm_srli_epi32(w11, 8), byte_mask);
+    __m128i const pressure = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(w11, 16), byte_mask), pressure_bias);
+
+    // hi * 255 + lo == (hi << 8) - hi + lo
+    __m128i const x_hi = _mm_and_si128(w15, byte_mask);
+    __m128i const y_hi = _mm_and_si128(_mm_srli_epi32(w15, 8), byte_mask);
+    __m128i const x_lo = _mm_and_si128(_mm_srli_epi32(w15, 16), byte_mask);
+    __m128i const y_lo = _mm_srli_epi32(w15, 24);
+    __m128i const x = _mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(x_hi, 8), x_hi), x_lo);
+    __m128i const y = _mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(y_hi, 8), y_hi), y_lo);
+
+    __m128i const accel_x = _mm_sub_epi32(_mm_and_si128(w19, word_mask), accel_bias);
+    __m128i const accel_y = _mm_sub_epi32(_mm_srli_epi32(w19, 16), accel_bias);
+    __m128i const accel_z = _mm_sub_epi32(_mm_and_si128(w23, word_mask), accel_bias);
+
+    store8_x4(batch.mode + i, mode);
+    store8_x4(batch.orientation + i, orientation);
+    store8_x4(batch.pinch_distance + i, pinch);
+    store16_x4(batch.x + i, x);
+    store16_x4(batch.y + i, y);
+    store16_x4(batch.pressure + i, pressure);
+    store16_x4(batch.accel_x + i, accel_x);
+    store16_x4(batch.accel_y + i, accel_y);
+    store16_x4(batch.accel_z + i, accel_z);
+    store16_x4(batch.buttons + i, buttons);
+  }
+
+  for (; i < count; ++i) {
+    decode_report(reports + i * STRIDE, batch, i);
+  }
+  batch.size = count;
+}
+
+__attribute__((target("avx2")))
+void decode_batch_avx2(uint8_t const* reports, size_t count, SampleBatch& batch)
+{
+  __m256i const zero = _mm256_setzero_si256();
+  __m256i const byte_mask = _mm256_set1_epi32(0xff);
+  __m256i const word_mask = _mm256_set1_epi32(0xffff);
+  __m256i const accel_bias = _mm256_set1_epi32(Ps3Layout::ACCEL_BIAS);
+  __m256i const pressure_bias = _mm256_set1_epi32(Ps3Layout::PRESSURE_BIAS);
+
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8)
+  {
+    uint8_t const* const base = reports + i * STRIDE;
+    __m256i const w0 = load_x8(base + 0);
+    __m256i const w7 = load_x8(base + 7);
+    __m256i const w11 = load_x8(base + 11);
+    __m256i const w15 = load_x8(base + 15);
+    __m256i const w19 = load_x8(base + 19);
+    __m256i const w23 = load_x8(base + 23);
+
+    __m256i buttons = _mm256_or_si256(
+      _mm256_or_si256(_mm256_and_si256(w0, _mm256_set1_epi32(0x0f)),
+                      _mm256_and_si256(_mm256_srli_epi32(w0, 4), _mm256_set1_epi32(0x30))),
+      _mm256_and_si256(_mm256_srli_epi32(w0, 6), _mm256_set1_epi32(0x40)));
+
+    __m256i const dpad = _mm256_andnot_si256(_mm256_cmpeq_epi8(w7, zero), _mm256_set1_epi8(1));
+    buttons = _mm256_or_si256(buttons, _mm256_slli_epi32(_mm256_and_si256(dpad, _mm256_set1_epi32(0x00000001)), 10));
+    buttons = _mm256_or_si256(buttons, _mm256_slli_epi32(_mm256_and_si256(dpad, _mm256_set1_epi32(0x00000100)), 1));
+    buttons = _mm256_or_si256(buttons, _mm256_srli_epi32(_mm256_and_si256(dpad, _mm256_set1_epi32(0x00010000)), 9));
+    buttons = _mm256_or_si256(buttons, _mm256_srli_epi32(_mm256_and_si256(dpad, _mm256_set1_epi32(0x01000000)), 16));
+
+    __m256i const mode = _mm256_and_si256(_mm256_srli_epi32(w11, 6), _mm256_set1_epi32(0x03));
+    __m256i const orientation = _mm256_and_si256(w11, _mm256_set1_epi32(0x3f));
+    __m256i const pinch = _mm256_and_si256(_mm256_srli_epi32(w11, 8), byte_mask);
+    __m256i const pressure = _mm256_sub_epi32(_mm256_and_si256(_mm256_srli_epi32(w11, 16), byte_mask), pressure_bias);
+
+    __m256i const x_hi = _mm256_and_si256(w15, byte_mask);
+    __m256i const y_hi = _mm256_and_si256(_mm256_srli_epi32(w15, 8), byte_mask);
+    __m256i const x_lo = _mm256_and_si256(_mm256_srli_epi32(w15, 16), byte_mask);
+    __m256i const y_lo = _mm256_srli_epi32(w15, 24);
+    __m256i const x = _mm256_add_epi32(_mm256_sub_epi32(_mm256_slli_epi32(x_hi, 8), x_hi), x_lo);
+    __m256i const y = _mm256_add_epi32(_mm256_sub_epi32(_mm256_slli_epi32(y_hi, 8), y_hi), y_lo);
+
+    __m256i const accel_x = _mm256_sub_epi32(_mm256_and_si256(w19, word_mask), accel_bias);
+    __m256i const accel_y = _mm256_sub_epi32(_mm256_srli_epi32(w19, 16), accel_bias);
+    __m256i const accel_z = _mm256_sub_epi32(_mm256_and_si256(w23, word_mask), accel_bias);
+
+    store8_x8(batch.mode + i, mode);
+    store8_x8(batch.orientation + i, orientation);
+    store8_x8(batch.pinch_distance + i, pinch);
+    store16_x8x2(batch.x + i, batch.y + i, x, y);
+    store16_x8x2(batch.pressure + i, batch.buttons + i, pressure, buttons);
+    store16_x8x2(batch.accel_x + i, batch.accel_y + i, accel_x, accel_y);
+    store16_x8(batch.accel_z + i, accel_z);
+  }
+
+  for (; i < count; ++i) {
+    decode_report(reports + i * STRIDE, batch, i);
+  }
+  batch.size = count;
+}
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -0,0 +1,245 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "sample_export.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "report_reader.hpp"
+#include "sample_batch.hpp"
+#include "udraw_decoder.hpp"
+
+namespace udraw {
+
+namespace {
+
+char const column_magic[8] = { 'U', 'D', 'R', 'A', 'W', 'C', 'O', 'L' };
+uint32_t const column_version = 1;
+
+size_t const header_size = 64;
+size_t const directory_entry_size = 32;
+size_t const column_alignment = 64;
+
+struct ColumnInfo
+{
+  char const* name;
+  ColumnType type;
+  uint32_t element_size;
+};
+
+/** indexed by SampleBatch::Column */
+ColumnInfo const columns[SampleBatch::COLUMN_COUNT] = {
+  { "timestamp", ColumnType::INT64, 8 },
+  { "mode", ColumnType::UINT8, 1 },
+  { "x", ColumnType::INT16, 2 },
+  { "y", ColumnType::INT16, 2 },
+  { "pressure", ColumnType::INT16, 2 },
+  { "orientation", ColumnType::UINT8, 1 },
+  { "pinch_distance", ColumnType::UINT8, 1 },
+  { "accel_x", ColumnType::INT16, 2 },
+  { "accel_y", ColumnType::INT16, 2 },
+  { "accel_z", ColumnType::INT16, 2 },
+  { "buttons", ColumnType::UINT16, 2 },
+};
+
+uint64_t align_up(uint64_t value)
+{
+  return (value + column_alignment - 1) & ~uint64_t(column_alignment - 1);
+}
+
+void write_at(int fd, std::string const& filename, void const* data, size_t size, uint64_t offset)
+{
+  uint8_t const* ptr = static_cast<uint8_t const*>(data);
+  while (size != 0) {
+    ssize_t const ret = pwrite(fd, ptr, size, static_cast<off_t>(offset));
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(fmt::format("{}: write failed: {}", filename, strerror(errno)));
+    }
+    ptr += ret;
+    size -= static_cast<size_t>(ret);
+    offset += static_cast<uint64_t>(ret);
+  }
+}
+
+/** Number of reports in \a input that pass validation, i.e. the rows
+    BatchReader will produce. The readers map the input, so this is a
+    cheap pass that doesn't decode anything. */
+uint64_t count_rows(std::string const& input)
+{
+  std::unique_ptr<ReportReader> reader = open_report_reader(input);
+
+  uint64_t rows = 0;
+  CaptureRecord record;
+  while (reader->next(record)) {
+    if (UDrawDecoder::validate(record.data, record.size) == UDrawDecoder::Error::NONE) {
+      rows += 1;
+    }
+  }
+  return rows;
+}
+
+} // namespace
+
+Stats export_columns(std::string const& input, std::string const& output)
+{
+  uint64_t const rows = count_rows(input);
+
+  // the columns are written in place at their final offsets, so an
+  // interrupted export would leave a file that looks complete
+  std::string const tmp_output = output + ".tmp";
+  int const fd = open(tmp_output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error(fmt::format("{}: {}", tmp_output, strerror(errno)));
+  }
+
+  Stats stats;
+  try
+  {
+    uint8_t header[header_size + SampleBatch::COLUMN_COUNT * directory_entry_size] = {};
+    memcpy(header, column_magic, sizeof(column_magic));
+    uint32_t const column_count = SampleBatch::COLUMN_COUNT;
+    memcpy(header + 8, &column_version, sizeof(column_version));
+    memcpy(header + 12, &column_count, sizeof(column_count));
+    memcpy(header + 16, &rows, sizeof(rows));
+
+    uint64_t column_offsets[SampleBatch::COLUMN_COUNT];
+    uint64_t offset = align_up(sizeof(header));
+    for (size_t col = 0; col < SampleBatch::COLUMN_COUNT; ++col) {
+      ColumnInfo const& info = columns[col];
+      column_offsets[col] = offset;
+      offset = align_up(offset + rows * info.element_size);
+
+      uint8_t* const entry = header + header_size + col * directory_entry_size;
+      uint32_t const type = static_cast<uint32_t>(info.type);
+      strncpy(reinterpret_cast<char*>(entry), info.name, 16);
+      memcpy(entry + 16, &type, sizeof(type));
+      memcpy(entry + 20, &info.element_size, sizeof(info.element_size));
+      memcpy(entry + 24, &column_offsets[col], sizeof(column_offsets[col]));
+    }
+    uint64_t const file_size = offset;
+
+    // the padding between and after the columns
+    if (ftruncate(fd, static_cast<off_t>(file_size)) != 0) {
+      throw std::runtime_error(fmt::format("{}: {}", tmp_output, strerror(errno)));
+    }
+    write_at(fd, tmp_output, header, sizeof(header), 0);
+
+    std::unique_ptr<ReportReader> reader = open_report_reader(input);
+    BatchReader batch_reader(*reader);
+    auto batch = std::make_unique<SampleBatch>();
+
+    uint64_t row = 0;
+    while (batch_reader.next(*batch))
+    {
+      if (row + batch->size > rows) {
+        throw std::runtime_error(fmt::format("{}: changed while exporting", input));
+      }
+
+      for (size_t col = 0; col < SampleBatch::COLUMN_COUNT; ++col) {
+        uint32_t const element_size = columns[col].element_size;
+        write_at(fd, tmp_output, batch->column(static_cast<SampleBatch::Column>(col)),
+                 batch->size * element_size, column_offsets[col] + row * element_size);
+      }
+      row += batch->size;
+    }
+
+    if (row != rows) {
+      throw std::runtime_error(fmt::format("{}: changed while exporting", input));
+    }
+
+    stats = batch_reader.stats();
+  }
+  catch (...)
+  {
+    close(fd);
+    unlink(tmp_output.c_str());
+    throw;
+  }
+
+  if (close(fd) != 0) {
+    int const err = errno;
+    unlink(tmp_output.c_str());
+    throw std::runtime_error(fmt::format("{}: close failed: {}", tmp_output, strerror(err)));
+  }
+
+  if (rename(tmp_output.c_str(), output.c_str()) != 0) {
+    int const err = errno;
+    unlink(tmp_output.c_str());
+    throw std::runtime_error(fmt::format("{}: {}", output, strerror(err)));
+  }
+
+  return stats;
+}
+
+Stats export_csv(std::string const& input, std::string const& output)
+{
+  std::unique_ptr<FILE, int (*)(FILE*)> fp(fopen(output.c_str(), "we"), fclose);
+  if (!fp) {
+    throw std::runtime_error(fmt::format("{}: {}", output, strerror(errno)));
+  }
+
+  std::unique_ptr<ReportReader> reader = open_report_reader(input);
+  BatchReader batch_reader(*reader);
+  auto batch = std::make_unique<SampleBatch>();
+
+  fmt::memory_buffer buf;
+  auto it = std::back_inserter(buf);
+
+  for (size_t col = 0; col < SampleBatch::COLUMN_COUNT; ++col) {
+    fmt::format_to(it, "{}{}", col == 0 ? "" : ",", columns[col].name);
+  }
+  fmt::format_to(it, "\n");
+
+  while (batch_reader.next(*batch))
+  {
+    SampleBatch const& b = *batch;
+    for (size_t i = 0; i < b.size; ++i) {
+      fmt::format_to(it, "{},{},{},{},{},{},{},{},{},{},{}\n",
+                     b.timestamp[i], b.mode[i], b.x[i], b.y[i], b.pressure[i],
+                     b.orientation[i], b.pinch_distance[i],
+                     b.accel_x[i], b.accel_y[i], b.accel_z[i], b.buttons[i]);
+    }
+
+    if (fwrite(buf.data(), 1, buf.size(), fp.get()) != buf.size()) {
+      throw std::runtime_error(fmt::format("{}: write failed: {}", output, strerror(errno)));
+    }
+    buf.clear();
+  }
+
+  if (fclose(fp.release()) != 0) {
+    throw std::runtime_error(fmt::format("{}: close failed: {}", output, strerror(errno)));
+  }
+
+  return batch_reader.stats();
+}
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,65 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_SAMPLE_EXPORT_HPP
+#define HEADER_UDRAW_SAMPLE_EXPORT_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "stats.hpp"
+
+namespace udraw {
+
+/*
+  Columnar file layout, all values little-endian:
+
+  header, 64 bytes:
+    char     magic[8]       "UDRAWCOL"
+    uint32_t version        1
+    uint32_t column_count
+    uint64_t row_count
+    uint8_t  reserved[40]
+
+  column directory, column_count entries of 32 bytes:
+    char     name[16]       NUL padded, e.g. "x", "pressure"
+    uint32_t type           ColumnType
+    uint32_t element_size   in bytes
+    uint64_t offset         from the start of the file, 64 byte aligned
+
+  followed by the column data, row_count elements per column. The file
+  can be mmap()ed and each column used as a plain array.
+*/
+
+enum class ColumnType : uint32_t {
+  INT64 = 0,
+  UINT8 = 1,
+  INT16 = 2,
+  UINT16 = 3,
+};
+
+/** Decode all reports of \a input into the columnar file \a output */
+Stats export_columns(std::string const& input, std::string const& output);
+
+/** Decode all reports of \a input into a CSV file with a header line */
+Stats export_csv(std::string const& input, std::string const& output);
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -0,0 +1,189 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "sample_ring_writer.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <linux/magic.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#include <new>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+
+namespace udraw {
+
+SampleRingWriter::SampleRingWriter(std::string const& path, std::string const& group, uint32_t capacity) :
+  m_path(path),
+  m_fd(-1),
+  m_mem(MAP_FAILED),
+  m_size(sizeof(SampleRingHeader) + capacity * sizeof(SampleRingSlot)),
+  m_header(nullptr),
+  m_slots(nullptr),
+  m_write_count(0)
+{
+  std::string const tmp_path = fmt::format("{}.{}.tmp", m_path, getpid());
+
+  try {
+    create(tmp_path, group);
+  } catch (...) {
+    if (m_fd >= 0) {
+      close(m_fd);
+      unlink(tmp_path.c_str());
+    }
+    throw;
+  }
+
+  m_mem = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  if (m_mem == MAP_FAILED) {
+    int const err = errno;
+    close(m_fd);
+    unlink(tmp_path.c_str());
+    throw std::runtime_error(fmt::format("{}: mmap() failed: {}", tmp_path, strerror(err)));
+  }
+
+  m_header = new (m_mem) SampleRingHeader;
+  m_header->magic = SAMPLE_RING_MAGIC;
+  m_header->version = SAMPLE_RING_VERSION;
+  m_header->sample_size = sizeof(Sample);
+  m_header->capacity = capacity;
+  m_header->write_count.store(0, std::memory_order_relaxed);
+
+  m_slots = new (static_cast<uint8_t*>(m_mem) + sizeof(SampleRingHeader)) SampleRingSlot[capacity];
+  for (uint32_t i = 0; i < capacity; ++i) {
+    m_slots[i].sequence.store(0, std::memory_order_relaxed);
+  }
+
+  try {
+    install(tmp_path);
+  } catch (...) {
+    munmap(m_mem, m_size);
+    close(m_fd);
+    unlink(tmp_path.c_str());
+    throw;
+  }
+
+  log_info("publishing samples at {}", m_path);
+}
+
+SampleRingWriter::~SampleRingWriter()
+{
+  // leave the path alone when somebody else took it over meanwhile
+  struct stat path_st;
+  struct stat fd_st;
+  if (stat(m_path.c_str(), &path_st) == 0 && fstat(m_fd, &fd_st) == 0 &&
+      path_st.st_dev == fd_st.st_dev && path_st.st_ino == fd_st.st_ino) {
+    unlink(m_path.c_str());
+  }
+
+  munmap(m_mem, m_size);
+  close(m_fd);
+}
+
+void
+SampleRingWriter::create(std::string const& tmp_path, std::string const& group)
+{
+  unlink(tmp_path.c_str());
+  m_fd = open(tmp_path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW, 0600);
+  if (m_fd < 0) {
+    throw std::runtime_error(fmt::format("{}: {}", tmp_path, strerror(errno)));
+  }
+
+  // the mode is set explicitly, the umask doesn't get a say
+  mode_t mode = 0644;
+  if (!group.empty()) {
+    struct group const* gr = getgrnam(group.c_str());
+    if (!gr) {
+      throw std::runtime_error(fmt::format("unknown group: {}", group));
+    }
+    if (fchown(m_fd, static_cast<uid_t>(-1), gr->gr_gid) < 0) {
+      throw std::runtime_error(fmt::format("{}: fchown() failed: {}", tmp_path, strerror(errno)));
+    }
+    mode = 0640;
+  }
+  if (fchmod(m_fd, mode) < 0) {
+    throw std::runtime_error(fmt::format("{}: fchmod() failed: {}", tmp_path, strerror(errno)));
+  }
+
+  if (ftruncate(m_fd, static_cast<off_t>(m_size)) < 0) {
+    throw std::runtime_error(fmt::format("{}: ftruncate() failed: {}", tmp_path, strerror(errno)));
+  }
+
+  // on a disk backed filesystem every sample would end up written back
+  struct statfs fs;
+  if (fstatfs(m_fd, &fs) == 0 && fs.f_type != TMPFS_MAGIC) {
+    log_warn("{}: not on a tmpfs, consider /dev/shm or $XDG_RUNTIME_DIR", m_path);
+  }
+}
+
+void
+SampleRingWriter::install(std::string const& tmp_path)
+{
+  // only a ring left behind by an earlier run gets replaced, never a
+  // file that happens to be at that path
+  int const old_fd = open(m_path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW | O_NONBLOCK);
+  if (old_fd >= 0) {
+    struct stat st;
+    uint32_t magic = 0;
+    bool const is_ring = fstat(old_fd, &st) == 0 && S_ISREG(st.st_mode) &&
+      read(old_fd, &magic, sizeof(magic)) == sizeof(magic) && magic == SAMPLE_RING_MAGIC;
+    close(old_fd);
+    if (!is_ring) {
+      throw std::runtime_error(fmt::format("{}: exists and is not a sample ring", m_path));
+    }
+  } else if (errno != ENOENT) {
+    throw std::runtime_error(fmt::format("{}: exists and is not a sample ring", m_path));
+  }
+
+  if (rename(tmp_path.c_str(), m_path.c_str()) < 0) {
+    throw std::runtime_error(fmt::format("{}: rename() failed: {}", m_path, strerror(errno)));
+  }
+}
+
+void
+SampleRingWriter::publish(Sample const& sample)
+{
+  uint64_t const index = m_write_count;
+  SampleRingSlot& slot = m_slots[index % m_header->capacity];
+
+  uint64_t words[sizeof(Sample) / sizeof(uint64_t)];
+  memcpy(words, &sample, sizeof(sample));
+
+  slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); ++i) {
+    slot.words[i].store(words[i], std::memory_order_relaxed);
+  }
+
+  slot.sequence.store(2 * index + 2, std::memory_order_release);
+
+  m_write_count = index + 1;
+  m_header->write_count.store(m_write_count, std::memory_order_release);
+}
+
+} // namespace udraw
+
+/* EOF */
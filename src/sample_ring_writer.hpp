@@ -0,0 +1,67 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_SAMPLE_RING_WRITER_HPP
+#define HEADER_UDRAW_SAMPLE_RING_WRITER_HPP
+
+#include <cstddef>
+#include <string>
+
+#include "shm/sample_ring.hpp"
+
+namespace udraw {
+
+/** Producer side of the shared memory ring. The ring is a regular
+    file, best on a tmpfs such as /dev/shm or $XDG_RUNTIME_DIR, that is
+    readable by everyone, or only by \a group when one is given, so
+    that readers don't have to run as the driver's user. */
+class SampleRingWriter
+{
+public:
+  SampleRingWriter(std::string const& path, std::string const& group = {},
+                   uint32_t capacity = 4096);
+  ~SampleRingWriter();
+
+  void publish(Sample const& sample);
+
+private:
+  /** Create the file under a temporary name, readers only ever see it
+      fully initialized */
+  void create(std::string const& tmp_path, std::string const& group);
+
+  /** Move the file to m_path, replacing only a ring from an earlier run */
+  void install(std::string const& tmp_path);
+
+private:
+  std::string m_path;
+  int m_fd;
+  void* m_mem;
+  size_t m_size;
+  SampleRingHeader* m_header;
+  SampleRingSlot* m_slots;
+  uint64_t m_write_count;
+
+private:
+  SampleRingWriter(const SampleRingWriter&) = delete;
+  SampleRingWriter& operator=(const SampleRingWriter&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
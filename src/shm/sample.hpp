@@ -0,0 +1,77 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_SHM_SAMPLE_HPP
+#define HEADER_UDRAW_SHM_SAMPLE_HPP
+
+#include <cstdint>
+
+namespace udraw {
+
+/** A fully decoded report in a fixed layout that is shared with other
+    processes, fields must only ever be appended */
+struct Sample
+{
+  enum Button : uint16_t {
+    SQUARE   = 1 << 0,
+    CROSS    = 1 << 1,
+    CIRCLE   = 1 << 2,
+    TRIANGLE = 1 << 3,
+    START    = 1 << 4,
+    SELECT   = 1 << 5,
+    GUIDE    = 1 << 6,
+    UP       = 1 << 7,
+    DOWN     = 1 << 8,
+    LEFT     = 1 << 9,
+    RIGHT    = 1 << 10,
+  };
+
+  enum Mode : uint8_t {
+    NONE = 0,
+    PEN = 1,
+    TOUCH = 2,
+    MULTITOUCH = 3,
+    UNKNOWN = 4,
+  };
+
+  /** CLOCK_MONOTONIC in nanoseconds */
+  int64_t timestamp;
+
+  /** bitmask of Button */
+  uint16_t buttons;
+  uint8_t mode;
+  uint8_t orientation;
+  uint8_t pinch_distance;
+  uint8_t reserved;
+
+  int16_t x;
+  int16_t y;
+  int16_t pressure;
+  int16_t accel_x;
+  int16_t accel_y;
+  int16_t accel_z;
+
+  uint8_t padding[6];
+};
+
+static_assert(sizeof(Sample) == 32, "Sample layout must not change");
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
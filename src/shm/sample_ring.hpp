@@ -0,0 +1,109 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_SHM_SAMPLE_RING_HPP
+#define HEADER_UDRAW_SHM_SAMPLE_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "sample.hpp"
+
+namespace udraw {
+
+/*
+  Shared memory layout:
+
+    SampleRingHeader
+    SampleRingSlot[capacity]
+
+  The producer never waits for readers. Every slot is a seqlock: while
+  sample n is written the slot's sequence is 2*n+1, afterwards it is
+  2*n+2. A reader that wants sample n knows it is not written yet if
+  the sequence is smaller and that it got overwritten if it is larger.
+*/
+
+uint32_t const SAMPLE_RING_MAGIC = 0x57524455; // "UDRW"
+uint32_t const SAMPLE_RING_VERSION = 1;
+
+struct SampleRingHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t sample_size;
+  uint32_t capacity;
+
+  /** number of samples published so far */
+  alignas(64) std::atomic<uint64_t> write_count;
+};
+
+struct alignas(64) SampleRingSlot
+{
+  std::atomic<uint64_t> sequence;
+  std::atomic<uint64_t> words[sizeof(Sample) / sizeof(uint64_t)];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared memory requires lock free atomics");
+
+/** Reader side of the shared memory ring, reading never blocks the
+    producer and doesn't need any syscalls */
+class SampleRingReader
+{
+public:
+  /** \a path is the file published by the driver with --shm */
+  SampleRingReader(std::string const& path);
+  ~SampleRingReader();
+
+  /** Copy up to \a max_samples samples that have been published since
+      the last call into \a samples, returns the number copied. When the
+      reader falls more than a ring behind, the oldest samples are
+      skipped and counted in lost(). */
+  size_t poll(Sample* samples, size_t max_samples);
+
+  /** Skip everything published so far, poll() will only return newer samples */
+  void seek_to_end();
+
+  /** Copy the most recently published sample, returns false if there is none */
+  bool latest(Sample& sample) const;
+
+  uint64_t lost() const { return m_lost; }
+
+private:
+  bool read_sample(uint64_t index, Sample& sample, bool& overwritten) const;
+
+private:
+  int m_fd;
+  void* m_mem;
+  size_t m_size;
+  SampleRingHeader const* m_header;
+  SampleRingSlot const* m_slots;
+  uint64_t m_read_count;
+  uint64_t m_lost;
+
+private:
+  SampleRingReader(const SampleRingReader&) = delete;
+  SampleRingReader& operator=(const SampleRingReader&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -0,0 +1,165 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "sample_ring.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+namespace udraw {
+
+SampleRingReader::SampleRingReader(std::string const& path) :
+  m_fd(-1),
+  m_mem(MAP_FAILED),
+  m_size(0),
+  m_header(nullptr),
+  m_slots(nullptr),
+  m_read_count(0),
+  m_lost(0)
+{
+  m_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (m_fd < 0) {
+    if (errno == EACCES) {
+      throw std::runtime_error(path + ": " + strerror(errno) + ", the reader has to be in the driver's --shm-group");
+    }
+    throw std::runtime_error(path + ": " + strerror(errno));
+  }
+
+  struct stat st;
+  if (fstat(m_fd, &st) < 0 ||
+      !S_ISREG(st.st_mode) ||
+      static_cast<size_t>(st.st_size) < sizeof(SampleRingHeader))
+  {
+    close(m_fd);
+    throw std::runtime_error(path + ": not a sample ring");
+  }
+  m_size = static_cast<size_t>(st.st_size);
+
+  m_mem = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+  if (m_mem == MAP_FAILED) {
+    close(m_fd);
+    throw std::runtime_error(path + ": mmap() failed: " + strerror(errno));
+  }
+
+  m_header = static_cast<SampleRingHeader const*>(m_mem);
+  m_slots = reinterpret_cast<SampleRingSlot const*>(static_cast<uint8_t const*>(m_mem) + sizeof(SampleRingHeader));
+
+  if (m_header->magic != SAMPLE_RING_MAGIC ||
+      m_header->version != SAMPLE_RING_VERSION ||
+      m_header->sample_size != sizeof(Sample) ||
+      m_header->capacity == 0 ||
+      m_size < sizeof(SampleRingHeader) + m_header->capacity * sizeof(SampleRingSlot))
+  {
+    munmap(m_mem, m_size);
+    close(m_fd);
+    throw std::runtime_error(path + ": incompatible sample ring");
+  }
+
+  m_read_count = m_header->write_count.load(std::memory_order_acquire);
+}
+
+SampleRingReader::~SampleRingReader()
+{
+  munmap(m_mem, m_size);
+  close(m_fd);
+}
+
+bool
+SampleRingReader::read_sample(uint64_t index, Sample& sample, bool& overwritten) const
+{
+  SampleRingSlot const& slot = m_slots[index % m_header->capacity];
+  uint64_t const expected = 2 * index + 2;
+
+  while (true)
+  {
+    uint64_t const seq0 = slot.sequence.load(std::memory_order_acquire);
+    if (seq0 < expected) {
+      overwritten = false;
+      return false;
+    } else if (seq0 > expected) {
+      overwritten = true;
+      return false;
+    }
+
+    uint64_t words[sizeof(Sample) / sizeof(uint64_t)];
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); ++i) {
+      words[i] = slot.words[i].load(std::memory_order_relaxed);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t const seq1 = slot.sequence.load(std::memory_order_relaxed);
+    if (seq0 == seq1) {
+      memcpy(&sample, words, sizeof(sample));
+      return true;
+    }
+  }
+}
+
+size_t
+SampleRingReader::poll(Sample* samples, size_t max_samples)
+{
+  uint64_t const write_count = m_header->write_count.load(std::memory_order_acquire);
+
+  if (write_count - m_read_count > m_header->capacity) {
+    m_lost += write_count - m_read_count - m_header->capacity;
+    m_read_count = write_count - m_header->capacity;
+  }
+
+  size_t count = 0;
+  while (count < max_samples && m_read_count < write_count)
+  {
+    bool overwritten = false;
+    if (read_sample(m_read_count, samples[count], overwritten)) {
+      count += 1;
+    } else if (!overwritten) {
+      break;
+    } else {
+      m_lost += 1;
+    }
+    m_read_count += 1;
+  }
+
+  return count;
+}
+
+void
+SampleRingReader::seek_to_end()
+{
+  m_read_count = m_header->write_count.load(std::memory_order_acquire);
+}
+
+bool
+SampleRingReader::latest(Sample& sample) const
+{
+  uint64_t const write_count = m_header->write_count.load(std::memory_order_acquire);
+  if (write_count == 0) {
+    return false;
+  }
+
+  bool overwritten = false;
+  return read_sample(write_count - 1, sample, overwritten);
+}
+
+} // namespace udraw
+
+/* EOF */
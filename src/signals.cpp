@@ -0,0 +1,90 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "signals.hpp"
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+namespace udraw {
+
+std::atomic<bool> g_quit_requested(false);
+std::atomic<bool> g_dump_requested(false);
+int g_signal_fd = -1;
+
+namespace {
+
+/** write() to an eventfd is async-signal-safe */
+void wakeup()
+{
+  int const saved_errno = errno;
+  uint64_t const one = 1;
+  if (write(g_signal_fd, &one, sizeof(one)) < 0) {
+    // the counter can't overflow from signals, nothing to handle
+  }
+  errno = saved_errno;
+}
+
+void on_quit_signal(int)
+{
+  g_quit_requested.store(true, std::memory_order_relaxed);
+  wakeup();
+}
+
+void on_dump_signal(int)
+{
+  g_dump_requested.store(true, std::memory_order_relaxed);
+  wakeup();
+}
+
+} // namespace
+
+void install_signal_handlers()
+{
+  static_assert(std::atomic<bool>::is_always_lock_free,
+                "signal handlers require lock free atomics");
+
+  g_signal_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (g_signal_fd < 0) {
+    throw std::runtime_error(fmt::format("eventfd() failed: {}", strerror(errno)));
+  }
+
+  struct sigaction sa = {};
+  sigemptyset(&sa.sa_mask);
+
+  // a second Ctrl-C kills the process if shutting down hangs
+  sa.sa_handler = on_quit_signal;
+  sa.sa_flags = SA_RESETHAND;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+
+  sa.sa_handler = on_dump_signal;
+  sa.sa_flags = SA_RESTART;
+  sigaction(SIGUSR1, &sa, nullptr);
+}
+
+} // namespace udraw
+
+/* EOF */
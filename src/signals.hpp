@@ -0,0 +1,42 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_SIGNALS_HPP
+#define HEADER_UDRAW_SIGNALS_HPP
+
+#include <atomic>
+
+namespace udraw {
+
+/** set by SIGINT and SIGTERM */
+extern std::atomic<bool> g_quit_requested;
+
+/** set by SIGUSR1, cleared by whoever handles it */
+extern std::atomic<bool> g_dump_requested;
+
+/** eventfd that is signalled along with the flags above, so that a
+    thread blocking in poll() notices them without a timeout, -1 until
+    the handlers are installed */
+extern int g_signal_fd;
+
+void install_signal_handlers();
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
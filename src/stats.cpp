@@ -0,0 +1,39 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "stats.hpp"
+
+#include <ostream>
+
+namespace udraw {
+
+std::ostream& operator<<(std::ostream& os, Stats const& stats)
+{
+  os << "reports: " << stats.reports << ", idle: " << stats.idle;
+
+  for (size_t i = 1; i < stats.rejected.size(); ++i) {
+    if (stats.rejected[i] != 0) {
+      os << ", " << to_string(static_cast<UDrawDecoder::Error>(i)) << ": " << stats.rejected[i];
+    }
+  }
+
+  return os;
+}
+
+} // namespace udraw
+
+/* EOF */
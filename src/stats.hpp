@@ -0,0 +1,47 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_STATS_HPP
+#define HEADER_UDRAW_STATS_HPP
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+
+#include "udraw_decoder.hpp"
+
+namespace udraw {
+
+/** Counters collected on the input path, printed when the driver exits */
+struct Stats
+{
+  uint64_t reports = 0;
+
+  /** reports skipped for being identical to the previous one */
+  uint64_t idle = 0;
+
+  /** rejected reports, indexed by UDrawDecoder::Error */
+  std::array<uint64_t, UDrawDecoder::ERROR_COUNT> rejected = {};
+};
+
+std::ostream& operator<<(std::ostream& os, Stats const& stats);
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
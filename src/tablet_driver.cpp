@@ -16,43 +16,109 @@
 
 #include "tablet_driver.hpp"
 
+#include <logmich/log.hpp>
 #include <uinpp/multi_device.hpp>
 #include <uinpp/event_emitter.hpp>
 
+#include "async_log.hpp"
+#include "device_profile.hpp"
+#include "options.hpp"
+#include "touch_contacts.hpp"
+#include "tuning_store.hpp"
 #include "udraw_decoder.hpp"
+#include "trace.hpp"
 
 namespace udraw {
 
-TabletDriver::TabletDriver(uinpp::MultiDevice& evdev) :
+namespace {
+
+/** surface units per mm */
+int const tablet_resolution = 12;
+
+AreaMapping make_mapping(Options const& opts, int rotation)
+{
+  Rect const area = opts.tablet_area.empty() ?
+    Rect{0, 0, TOUCH_SURFACE_WIDTH, TOUCH_SURFACE_HEIGHT} :
+    opts.tablet_area;
+
+  // without any options the surface is passed through unchanged
+  Rect const screen = !opts.screen.empty() ? opts.screen :
+    !opts.tablet_output.empty() ? Rect{0, 0, opts.tablet_output.x + opts.tablet_output.width,
+                                       opts.tablet_output.y + opts.tablet_output.height} :
+    Rect{0, 0, TOUCH_SURFACE_WIDTH, TOUCH_SURFACE_HEIGHT};
+
+  Rect const output = opts.tablet_output.empty() ?
+    Rect{0, 0, screen.width, screen.height} :
+    opts.tablet_output;
+
+  return AreaMapping(area, output, screen.width, screen.height,
+                     rotation % 360, opts.keep_aspect);
+}
+
+} // namespace
+
+template<typename Layout>
+TabletDriver<Layout>::TabletDriver(uinpp::MultiDevice& evdev, Options const& opts, TuningStore const& tuning,
+                                   DeviceProfile const& profile) :
   m_evdev(evdev),
+  m_tuning(tuning),
+  m_profile(profile),
+  m_mutex(),
+  m_mapping(make_mapping(opts, opts.tablet_rotation)),
+  m_flipped_mapping(make_mapping(opts, opts.tablet_rotation + 180)),
+  m_auto_rotate(opts.auto_rotate),
+  m_rotated(false),
+  m_accel(),
   m_em_x(),
   m_em_y(),
   m_em_pressure(),
+  m_em_tilt_x(),
+  m_em_tilt_y(),
   m_em_touch(),
   m_em_tool_pen(),
   m_em_wheel(),
-  m_em_hwheel()
+  m_em_hwheel(),
+  m_pen_x(-1),
+  m_pen_y(-1),
+  m_pen_pressure(-1),
+  m_in_range(false),
+  m_touch(false),
+  m_resampler(opts.resample_rate > 0.0 ?
+              std::make_unique<PenResampler>(std::chrono::nanoseconds(static_cast<int64_t>(1e9 / opts.resample_rate))) :
+              nullptr),
+  m_resample_timer_active(false),
+  m_resample_timer(m_resampler ?
+                   std::make_unique<Timer>([this](uint64_t){ on_resample_timer(); }) :
+                   nullptr)
 {
 }
 
-TabletDriver::~TabletDriver()
+template<typename Layout>
+TabletDriver<Layout>::~TabletDriver()
 {
 }
 
+template<typename Layout>
 void
-TabletDriver::init()
+TabletDriver<Layout>::init()
 {
   uinpp::VirtualDevice* tablet = m_evdev.create_device(0, uinpp::DeviceType::GENERIC);
 
   //tablet->set_name("uDraw Tablet Driver (tablet)");
   tablet->set_name("THQ uDraw Game Tablet for PS3 Pen");
-  tablet->set_usbid(0x3, 0x20d6, 0xcb17, 0x110);
+  tablet->set_usbid(0x3, m_profile.vendor_id, m_profile.product_id, 0x110);
   tablet->set_phys("uDraw tablet");
   tablet->set_prop(INPUT_PROP_POINTER);
 
-  m_em_x = tablet->add_abs(ABS_X, 0, 1920, 1, 0, 12);
-  m_em_y = tablet->add_abs(ABS_Y, 0, 1080, 1, 0, 12);
+  m_em_x = tablet->add_abs(ABS_X, 0, m_mapping.screen_width(), 1, 0,
+                           m_mapping.resolution_x(tablet_resolution));
+  m_em_y = tablet->add_abs(ABS_Y, 0, m_mapping.screen_height(), 1, 0,
+                           m_mapping.resolution_y(tablet_resolution));
   m_em_pressure = tablet->add_abs(ABS_PRESSURE, 0, 143, 0, 0, 0);
+  // tilt of the whole tablet in degrees, the resolution is in units
+  // per radian
+  m_em_tilt_x = tablet->add_abs(ABS_TILT_X, -90, 90, 0, 0, 57);
+  m_em_tilt_y = tablet->add_abs(ABS_TILT_Y, -90, 90, 0, 0, 57);
 
   m_em_touch = tablet->add_key(BTN_TOUCH);
   m_em_tool_pen = tablet->add_key(BTN_TOOL_PEN);
@@ -61,7 +127,7 @@ TabletDriver::init()
     uinpp::VirtualDevice* mouse = m_evdev.create_device(0, uinpp::DeviceType::MOUSE);
 
     mouse->set_name("uDraw Tablet Driver (mouse)");
-    mouse->set_usbid(0x3, 0x20d6, 0xcb17, 0x110);
+    mouse->set_usbid(0x3, m_profile.vendor_id, m_profile.product_id, 0x110);
     mouse->set_phys("uDraw mouse");
     // tablet->set_prop(INPUT_PROP_POINTER);
 
@@ -72,35 +138,135 @@ TabletDriver::init()
   m_evdev.finish();
 }
 
+template<typename Layout>
 void
-TabletDriver::receive_data(uint8_t const* data, size_t size)
+TabletDriver<Layout>::receive_data(uint8_t const* data, size_t size)
 {
-  UDrawDecoder decoder(data, size);
+  BasicUDrawDecoder<Layout> decoder(data, size);
+  auto const now = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
 
-  if (decoder.mode() == UDrawDecoder::Mode::PEN)
+  bool const was_rotated = m_rotated;
+  if (m_accel.add(decoder.accel_x(), decoder.accel_y(), decoder.accel_z()))
   {
-    m_em_x->send(decoder.x());
-    m_em_y->send(decoder.y());
-    m_em_pressure->send(decoder.pressure());
-    m_em_tool_pen->send(1);
+    m_em_tilt_x->send(m_accel.tilt_x());
+    m_em_tilt_y->send(m_accel.tilt_y());
 
-    if (decoder.pressure() > 5)
+    if (m_auto_rotate && m_accel.flipped() != m_rotated) {
+      m_rotated = m_accel.flipped();
+      async_log_info("tablet turned around, {}rotating the mapping by 180 degrees", m_rotated ? "" : "no longer ");
+    }
+  }
+
+  if (decoder.mode() == UDrawDecoderBase::Mode::PEN)
+  {
+    int x;
+    int y;
+    (m_rotated ? m_flipped_mapping : m_mapping).map(decoder.x(), decoder.y(), x, y);
+    bool const touch = decoder.pressure() > m_tuning.get().pressure_threshold;
+
+    if (!m_resampler)
     {
-      m_em_touch->send(1);
+      send_pen(x, y, decoder.pressure());
+      m_em_tool_pen->send(1);
+      m_em_touch->send(touch);
     }
     else
     {
-      m_em_touch->send(0);
+      PenResampler::Sample const sample{now, x, y, decoder.pressure()};
+      if (!m_in_range || touch != m_touch || m_rotated != was_rotated)
+      {
+        // edges go out right away and nothing gets interpolated
+        // across them
+        m_resampler->reset(sample);
+        send_pen(x, y, decoder.pressure());
+        m_em_tool_pen->send(1);
+        m_em_touch->send(touch);
+      }
+      else
+      {
+        m_resampler->add(sample);
+      }
+
+      if (!m_resample_timer_active) {
+        m_resample_timer->start(m_resampler->period());
+        m_resample_timer_active = true;
+      }
     }
+
+    m_in_range = true;
+    m_touch = touch;
   }
   else
   {
+    if (m_resampler && m_in_range)
+    {
+      // finish the stroke where the pen was last seen
+      PenResampler::Sample const& last = m_resampler->newest();
+      send_pen(last.x, last.y, last.pressure);
+
+      m_resample_timer->stop();
+      m_resample_timer_active = false;
+    }
+
     m_em_tool_pen->send(0);
+    m_in_range = false;
+  }
+
+  {
+    UDRAW_TRACE_SCOPE("sync");
+    m_evdev.sync();
+  }
+}
+
+template<typename Layout>
+bool
+TabletDriver<Layout>::send_pen(int x, int y, int pressure)
+{
+  if (x == m_pen_x && y == m_pen_y && pressure == m_pen_pressure) {
+    return false;
+  }
+
+  m_em_x->send(x);
+  m_em_y->send(y);
+  m_em_pressure->send(pressure);
+
+  m_pen_x = x;
+  m_pen_y = y;
+  m_pen_pressure = pressure;
+  return true;
+}
+
+template<typename Layout>
+void
+TabletDriver<Layout>::on_resample_timer()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // the pen left while this expiration waited for the lock
+  if (!m_resample_timer_active) {
+    return;
+  }
+
+  auto const now = std::chrono::steady_clock::now();
+  PenResampler::Sample const sample = m_resampler->sample(now);
+  if (send_pen(sample.x, sample.y, sample.pressure)) {
+    UDRAW_TRACE_SCOPE("sync");
+    m_evdev.sync();
   }
 
-  m_evdev.sync();
+  if (m_resampler->idle(now)) {
+    // no wakeups while the pen rests, the next report restarts it
+    m_resample_timer->stop();
+    m_resample_timer_active = false;
+  }
 }
 
+#define INSTANTIATE(Layout) template class TabletDriver<Layout>;
+UDRAW_FOR_EACH_LAYOUT(INSTANTIATE)
+#undef INSTANTIATE
+
 } // namespace udraw
 
 /* EOF */
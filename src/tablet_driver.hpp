@@ -20,28 +20,70 @@
 #include "driver.hpp"
 #include "fwd.hpp"
 
+#include <memory>
+#include <mutex>
+
+#include "accel_filter.hpp"
+#include "area_mapping.hpp"
+#include "pen_resampler.hpp"
+#include "timer.hpp"
+
 namespace udraw {
 
+template<typename Layout>
 class TabletDriver : public Driver
 {
 public:
-  TabletDriver(uinpp::MultiDevice& evdev);
+  TabletDriver(uinpp::MultiDevice& evdev, Options const& opts, TuningStore const& tuning,
+               DeviceProfile const& profile);
   ~TabletDriver();
 
   void init() override;
   void receive_data(uint8_t const* data, size_t size) override;
 
+private:
+  /** Send the pen position and pressure when they changed since the
+      last call, returns true when something was sent */
+  bool send_pen(int x, int y, int pressure);
+
+  void on_resample_timer();
+
 private:
   uinpp::MultiDevice& m_evdev;
+  TuningStore const& m_tuning;
+  DeviceProfile const& m_profile;
+
+  /** protects the evdev and all state below against the resample timer */
+  std::mutex m_mutex;
+
+  AreaMapping m_mapping;
+  /** m_mapping turned by 180 degrees, for when the tablet is flipped */
+  AreaMapping m_flipped_mapping;
+  bool m_auto_rotate;
+  bool m_rotated;
+  AccelFilter m_accel;
 
   uinpp::EventEmitter* m_em_x;
   uinpp::EventEmitter* m_em_y;
   uinpp::EventEmitter* m_em_pressure;
+  uinpp::EventEmitter* m_em_tilt_x;
+  uinpp::EventEmitter* m_em_tilt_y;
   uinpp::EventEmitter* m_em_touch;
   uinpp::EventEmitter* m_em_tool_pen;
   uinpp::EventEmitter* m_em_wheel;
   uinpp::EventEmitter* m_em_hwheel;
 
+  int m_pen_x;
+  int m_pen_y;
+  int m_pen_pressure;
+  bool m_in_range;
+  bool m_touch;
+
+  /** only with Options::resample_rate */
+  std::unique_ptr<PenResampler> m_resampler;
+  bool m_resample_timer_active;
+  std::unique_ptr<Timer> m_resample_timer;
+
 public:
   TabletDriver(const TabletDriver&) = delete;
   TabletDriver& operator=(const TabletDriver&) = delete;
@@ -0,0 +1,139 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "timer.hpp"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+
+#include "async_log.hpp"
+
+namespace udraw {
+
+namespace {
+
+timespec to_timespec(std::chrono::nanoseconds ns)
+{
+  timespec ts;
+  ts.tv_sec = static_cast<time_t>(ns.count() / 1000000000);
+  ts.tv_nsec = static_cast<long>(ns.count() % 1000000000);
+  return ts;
+}
+
+} // namespace
+
+Timer::Timer(std::function<void (uint64_t expirations)> callback) :
+  m_callback(std::move(callback)),
+  m_timer_fd(-1),
+  m_quit_fd(-1),
+  m_interval(0),
+  m_thread()
+{
+  m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  if (m_timer_fd < 0) {
+    throw std::runtime_error(fmt::format("timerfd_create() failed: {}", strerror(errno)));
+  }
+
+  m_quit_fd = eventfd(0, EFD_CLOEXEC);
+  if (m_quit_fd < 0) {
+    close(m_timer_fd);
+    throw std::runtime_error(fmt::format("eventfd() failed: {}", strerror(errno)));
+  }
+
+  m_thread = std::thread([this]{ run(); });
+}
+
+Timer::~Timer()
+{
+  uint64_t const one = 1;
+  if (write(m_quit_fd, &one, sizeof(one)) != sizeof(one)) {
+    log_error("failed to signal timer thread: {}", strerror(errno));
+  }
+  m_thread.join();
+
+  close(m_quit_fd);
+  close(m_timer_fd);
+}
+
+void
+Timer::start(std::chrono::nanoseconds interval)
+{
+  m_interval = interval;
+
+  itimerspec spec;
+  spec.it_interval = to_timespec(interval);
+  spec.it_value = to_timespec(interval);
+  if (timerfd_settime(m_timer_fd, 0, &spec, nullptr) < 0) {
+    async_log_error("timerfd_settime() failed: {}", strerror(errno));
+  }
+}
+
+void
+Timer::stop()
+{
+  itimerspec spec = {};
+  if (timerfd_settime(m_timer_fd, 0, &spec, nullptr) < 0) {
+    async_log_error("timerfd_settime() failed: {}", strerror(errno));
+  }
+}
+
+void
+Timer::run()
+{
+  pollfd fds[2];
+  fds[0].fd = m_timer_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = m_quit_fd;
+  fds[1].events = POLLIN;
+
+  while (true)
+  {
+    int const ret = poll(fds, 2, -1);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      log_error("poll() failed: {}", strerror(errno));
+      return;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      return;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      uint64_t expirations = 0;
+      // EAGAIN happens when the timer got disarmed after poll() returned
+      if (read(m_timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+        m_callback(expirations);
+      }
+    }
+  }
+}
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,66 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_TIMER_HPP
+#define HEADER_UDRAW_TIMER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace udraw {
+
+/** A periodic timer backed by a timerfd, the callback is run from a
+    separate thread. While the timer is stopped the thread sleeps in
+    poll() and causes no wakeups. */
+class Timer
+{
+public:
+  /** The callback receives the number of expirations since the last
+      call, which is more than one when the thread fell behind */
+  Timer(std::function<void (uint64_t expirations)> callback);
+  ~Timer();
+
+  /** (Re)arm the timer, first expiration happens after \a interval */
+  void start(std::chrono::nanoseconds interval);
+
+  /** Disarm the timer, safe to call from the callback */
+  void stop();
+
+  std::chrono::nanoseconds interval() const { return m_interval; }
+
+private:
+  void run();
+
+private:
+  std::function<void (uint64_t expirations)> m_callback;
+  int m_timer_fd;
+  int m_quit_fd;
+  std::chrono::nanoseconds m_interval;
+  std::thread m_thread;
+
+private:
+  Timer(const Timer&) = delete;
+  Timer& operator=(const Timer&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -0,0 +1,85 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "touch_contacts.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "udraw_decoder.hpp"
+
+namespace udraw {
+
+namespace {
+
+/** cos/sin in 2.14 fixed point, indexed by BasicUDrawDecoder::orientation() */
+struct OrientationTable
+{
+  OrientationTable() :
+    cos(),
+    sin()
+  {
+    for (int i = 0; i < 64; ++i) {
+      double const angle = 2.0 * M_PI * i / 63.0;
+      cos[i] = static_cast<int>(std::lround(std::cos(angle) * (1 << 14)));
+      sin[i] = static_cast<int>(std::lround(std::sin(angle) * (1 << 14)));
+    }
+  }
+
+  int cos[64];
+  int sin[64];
+};
+
+OrientationTable const g_orientation_table;
+
+} // namespace
+
+template<typename Layout>
+int touch_contacts(BasicUDrawDecoder<Layout> const& decoder, TouchContact* contacts)
+{
+  switch (decoder.mode())
+  {
+    case UDrawDecoderBase::Mode::TOUCH:
+    case UDrawDecoderBase::Mode::PEN:
+      contacts[0] = TouchContact{decoder.x(), decoder.y()};
+      return 1;
+
+    case UDrawDecoderBase::Mode::MULTITOUCH: {
+      int const radius = decoder.pinch_distance() * TOUCH_SURFACE_WIDTH / (2 * decoder.max_pinch_distance());
+      int const dx = (radius * g_orientation_table.cos[decoder.orientation()]) >> 14;
+      int const dy = (radius * g_orientation_table.sin[decoder.orientation()]) >> 14;
+
+      contacts[0] = TouchContact{std::clamp(decoder.x() + dx, 0, TOUCH_SURFACE_WIDTH),
+                                 std::clamp(decoder.y() + dy, 0, TOUCH_SURFACE_HEIGHT)};
+      contacts[1] = TouchContact{std::clamp(decoder.x() - dx, 0, TOUCH_SURFACE_WIDTH),
+                                 std::clamp(decoder.y() - dy, 0, TOUCH_SURFACE_HEIGHT)};
+      return 2;
+    }
+
+    default:
+      return 0;
+  }
+}
+
+#define INSTANTIATE(Layout) \
+  template int touch_contacts(BasicUDrawDecoder<Layout> const& decoder, TouchContact* contacts);
+UDRAW_FOR_EACH_LAYOUT(INSTANTIATE)
+#undef INSTANTIATE
+
+} // namespace udraw
+
+/* EOF */
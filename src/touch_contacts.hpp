@@ -0,0 +1,45 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_TOUCH_CONTACTS_HPP
+#define HEADER_UDRAW_TOUCH_CONTACTS_HPP
+
+#include "udraw_decoder.hpp"
+
+namespace udraw {
+
+int const TOUCH_SURFACE_WIDTH = 1920;
+int const TOUCH_SURFACE_HEIGHT = 1080;
+
+struct TouchContact
+{
+  int x;
+  int y;
+};
+
+/** Fills \a contacts with the fingers or the pen on the surface and
+    returns how many there are, at most two. The device only reports
+    the center between two fingers, they are reconstructed from the
+    pinch distance and orientation. */
+template<typename Layout>
+int touch_contacts(BasicUDrawDecoder<Layout> const& decoder, TouchContact* contacts);
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -22,12 +22,30 @@
 #include <uinpp/multi_device.hpp>
 #include <uinpp/event_emitter.hpp>
 
+#include "async_log.hpp"
+#include "device_profile.hpp"
+#include "options.hpp"
+#include "tuning_store.hpp"
 #include "udraw_decoder.hpp"
+#include "trace.hpp"
 
 namespace udraw {
 
-TouchpadDriver::TouchpadDriver(uinpp::MultiDevice& evdev) :
+namespace {
+
+/** kinetic scrolling is emitted once per display frame */
+auto const kinetic_frame_interval = std::chrono::nanoseconds(1000000000 / 60);
+
+} // namespace
+
+template<typename Layout>
+TouchpadDriver<Layout>::TouchpadDriver(uinpp::MultiDevice& evdev, Options const& opts, TuningStore const& tuning,
+                                       DeviceProfile const& profile) :
   m_evdev(evdev),
+  m_opts(opts),
+  m_tuning(tuning),
+  m_profile(profile),
+  m_mutex(),
   m_touchclick(),
   m_up(),
   m_down(),
@@ -44,7 +62,11 @@ TouchpadDriver::TouchpadDriver(uinpp::MultiDevice& evdev) :
   m_rel_hwheel(),
   m_rel_x(),
   m_rel_y(),
-  m_previous_mode(UDrawDecoder::Mode::NONE),
+  m_zones(opts.zones_filename.empty() ? HotZoneMap::default_layout() : HotZoneMap::from_file(opts.zones_filename)),
+  m_zone_keys(),
+  m_zone(0),
+  m_pressed_zone(-1),
+  m_previous_mode(UDrawDecoderBase::Mode::NONE),
   m_discard_events(0),
   m_touchdown_pos_x(0),
   m_touchdown_pos_y(0),
@@ -52,22 +74,32 @@ TouchpadDriver::TouchpadDriver(uinpp::MultiDevice& evdev) :
   m_touch_pos_y(0),
   m_multitouch_pos_x(0),
   m_multitouch_pos_y(0),
-  m_scroll_wheel(false),
   m_wheel_distance(0),
-  m_touch_time()
+  m_touch_time(),
+  m_kinetic(),
+  m_kinetic_timer([this](uint64_t expirations){ on_kinetic_timer(expirations); }),
+  m_pending_rel_x(0),
+  m_pending_rel_y(0),
+  m_pending_wheel(0),
+  m_pending_hwheel(0),
+  m_previous_buttons(0),
+  m_flush_timer_active(false),
+  m_flush_timer([this](uint64_t){ on_flush_timer(); })
 {
 }
 
-TouchpadDriver::~TouchpadDriver()
+template<typename Layout>
+TouchpadDriver<Layout>::~TouchpadDriver()
 {
 }
 
+template<typename Layout>
 void
-TouchpadDriver::init()
+TouchpadDriver<Layout>::init()
 {
   uinpp::VirtualDevice* keyboard = m_evdev.create_device(0, uinpp::DeviceType::KEYBOARD);
   keyboard->set_name("uDraw Touchpad Driver (keyboard)");
-  keyboard->set_usbid(0x3, 0x20d6, 0xcb17, 0x110);
+  keyboard->set_usbid(0x3, m_profile.vendor_id, m_profile.product_id, 0x110);
 
   m_start = keyboard->add_key(KEY_FORWARD);
   m_select = keyboard->add_key(KEY_BACK);
@@ -75,9 +107,16 @@ TouchpadDriver::init()
   m_down = keyboard->add_key(KEY_SPACE);
   m_cross = keyboard->add_key(KEY_ENTER);
 
+  m_zone_keys.resize(m_zones.zones().size());
+  for (size_t i = 0; i < m_zones.zones().size(); ++i) {
+    for (int const key : m_zones.zone(static_cast<uint8_t>(i)).keys) {
+      m_zone_keys[i].push_back(keyboard->add_key(key));
+    }
+  }
+
   uinpp::VirtualDevice* mouse = m_evdev.create_device(0, uinpp::DeviceType::MOUSE);
   mouse->set_name("uDraw Touchpad Driver (mouse)");
-  mouse->set_usbid(0x3, 0x20d6, 0xcb17, 0x110);
+  mouse->set_usbid(0x3, m_profile.vendor_id, m_profile.product_id, 0x110);
 
   m_touchclick = mouse->add_key(BTN_LEFT);
 
@@ -98,12 +137,36 @@ TouchpadDriver::init()
   m_evdev.finish();
 }
 
+template<typename Layout>
 void
-TouchpadDriver::receive_data(uint8_t const* data, size_t size)
+TouchpadDriver<Layout>::receive_data(uint8_t const* data, size_t size)
 {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
   bool send_click = false;
+  auto const now = std::chrono::steady_clock::now();
+  Tuning const& tuning = m_tuning.get();
 
-  UDrawDecoder decoder(data, size);
+  BasicUDrawDecoder<Layout> decoder(data, size);
+
+  if (m_previous_mode == UDrawDecoderBase::Mode::NONE &&
+      decoder.mode() != UDrawDecoderBase::Mode::NONE)
+  {
+    // a new touch stops the scrolling at once
+    stop_kinetic_scroll();
+  }
+  else if (m_previous_mode == UDrawDecoderBase::Mode::MULTITOUCH &&
+           decoder.mode() == UDrawDecoderBase::Mode::NONE)
+  {
+    start_kinetic_scroll(now);
+  }
+  else if (m_previous_mode == UDrawDecoderBase::Mode::MULTITOUCH &&
+           decoder.mode() != UDrawDecoderBase::Mode::MULTITOUCH)
+  {
+    // one finger lifted and the other still resting, nothing may
+    // keep scrolling underneath it
+    stop_kinetic_scroll();
+  }
 
   m_start->send(decoder.start());
   m_select->send(decoder.select());
@@ -119,89 +182,135 @@ TouchpadDriver::receive_data(uint8_t const* data, size_t size)
   m_square->send(decoder.square());
   m_circle->send(decoder.circle());
 
-  if (decoder.mode() == UDrawDecoder::Mode::TOUCH)
+  uint32_t const buttons =
+    (decoder.start() << 0) | (decoder.select() << 1) | (decoder.guide() << 2) |
+    (decoder.up() << 3) | (decoder.down() << 4) | (decoder.left() << 5) | (decoder.right() << 6) |
+    (decoder.triangle() << 7) | (decoder.cross() << 8) | (decoder.square() << 9) | (decoder.circle() << 10);
+  bool const button_edge = (buttons != m_previous_buttons);
+  m_previous_buttons = buttons;
+  int const previous_pressed_zone = m_pressed_zone;
+
+  if (decoder.mode() == UDrawDecoderBase::Mode::TOUCH)
   {
     if (m_discard_events > 0) {
       m_discard_events -= 1;
     }
 
-    if (m_previous_mode == UDrawDecoder::Mode::MULTITOUCH) {
+    if (m_previous_mode == UDrawDecoderBase::Mode::MULTITOUCH) {
       // when switching between TOUCH and MULTITOUCH, the reported
       // position takes a bit to settle back into a steady state
       m_discard_events = 16;
-    } else if (m_previous_mode != UDrawDecoder::Mode::TOUCH || m_discard_events > 0) {
+    } else if (m_previous_mode != UDrawDecoderBase::Mode::TOUCH || m_discard_events > 0) {
       m_touchdown_pos_x = decoder.x();
       m_touchdown_pos_y = decoder.y();
 
-      m_touch_time = std::chrono::steady_clock::now();
+      m_touch_time = now;
 
       m_touch_pos_x = decoder.x();
       m_touch_pos_y = decoder.y();
 
-      if (m_touch_pos_x < 120 || m_touch_pos_x > 1800)
-      {
-        m_scroll_wheel = true;
-        m_wheel_distance = 0;
-      }
-      else
+      m_zone = m_zones.lookup(m_touch_pos_x, m_touch_pos_y);
+      switch (m_zones.zone(m_zone).type)
       {
-        m_scroll_wheel = false;
+        case HotZone::Type::SCROLL:
+        case HotZone::Type::HSCROLL:
+          m_wheel_distance = 0;
+          m_kinetic.reset();
+          break;
+
+        case HotZone::Type::BUTTON:
+          press_zone(m_zone);
+          break;
+
+        case HotZone::Type::POINTER:
+          break;
       }
     } else if (m_discard_events == 0) {
-      if (m_scroll_wheel)
+      switch (m_zones.zone(m_zone).type)
       {
-        m_wheel_distance += (decoder.y() - m_touch_pos_y);
+        case HotZone::Type::SCROLL: {
+          m_wheel_distance += (decoder.y() - m_touch_pos_y);
+
+          int rel = m_wheel_distance;
+          if (rel != 0)
+          {
+            send_motion(0, 0, -rel * tuning.wheel_scale, 0);
+            m_kinetic.add_sample(now, -rel * tuning.wheel_scale);
+
+            m_wheel_distance -= rel;
+            m_touch_pos_x = decoder.x();
+            m_touch_pos_y = decoder.y();
+          }
+          break;
+        }
 
-        int rel = m_wheel_distance;
-        if (rel != 0)
-        {
-          m_rel_wheel->send(-rel * 5);
+        case HotZone::Type::HSCROLL: {
+          int const rel = decoder.x() - m_touch_pos_x;
+          if (rel != 0)
+          {
+            send_motion(0, 0, 0, rel * tuning.wheel_scale);
 
-          m_wheel_distance -= rel;
-          m_touch_pos_x = decoder.x();
-          m_touch_pos_y = decoder.y();
+            m_touch_pos_x = decoder.x();
+            m_touch_pos_y = decoder.y();
+          }
+          break;
         }
-      }
-      else
-      {
-        m_rel_x->send(decoder.x() - m_touch_pos_x);
-        m_rel_y->send(decoder.y() - m_touch_pos_y);
 
-        m_touch_pos_x = decoder.x();
-        m_touch_pos_y = decoder.y();
+        case HotZone::Type::BUTTON:
+          // the keys stay down until the finger is lifted
+          break;
+
+        case HotZone::Type::POINTER:
+          stop_kinetic_scroll();
+
+          send_motion(decoder.x() - m_touch_pos_x,
+                      decoder.y() - m_touch_pos_y,
+                      0, 0);
+
+          m_touch_pos_x = decoder.x();
+          m_touch_pos_y = decoder.y();
+          break;
       }
     }
   }
-  else if (decoder.mode() == UDrawDecoder::Mode::MULTITOUCH)
+  else if (decoder.mode() == UDrawDecoderBase::Mode::MULTITOUCH)
   {
-    if (m_previous_mode != UDrawDecoder::Mode::MULTITOUCH) {
+    release_zone();
+
+    if (m_previous_mode != UDrawDecoderBase::Mode::MULTITOUCH) {
       m_multitouch_pos_x = decoder.x();
       m_multitouch_pos_y = decoder.y();
+      m_kinetic.reset();
     } else {
       int const offset = (m_multitouch_pos_y - decoder.y());
 
-      m_rel_wheel->send(offset * 5);
+      send_motion(0, 0, offset * tuning.wheel_scale, 0);
+      m_kinetic.add_sample(now, offset * tuning.wheel_scale);
 
       m_multitouch_pos_x = decoder.x();
       m_multitouch_pos_y = decoder.y();
     }
   }
-  else if (decoder.mode() == UDrawDecoder::Mode::NONE)
+  else if (decoder.mode() == UDrawDecoderBase::Mode::NONE)
   {
-    if (m_previous_mode == UDrawDecoder::Mode::TOUCH) {
-      std::chrono::steady_clock::time_point new_touch_time = std::chrono::steady_clock::now();
-      auto const click_duration_msec = std::chrono::duration_cast<std::chrono::milliseconds>(new_touch_time - m_touch_time).count();
-
-      log_debug("click duration: {:4} msec - offset: {:4} {:4}",
-                click_duration_msec,
-                std::abs(m_touchdown_pos_x - m_touch_pos_x),
-                std::abs(m_touchdown_pos_y - m_touch_pos_y));
-
-      int const click_duration_threshold_msec = 150;
-      if (click_duration_msec < click_duration_threshold_msec) {
-        int const threshold = 16;
-        if (std::abs(m_touch_pos_x - m_touchdown_pos_x) < threshold &&
-            std::abs(m_touch_pos_y - m_touchdown_pos_y) < threshold)
+    if (m_previous_mode == UDrawDecoderBase::Mode::TOUCH) {
+      HotZone::Type const zone_type = m_zones.zone(m_zone).type;
+      if (zone_type == HotZone::Type::SCROLL) {
+        start_kinetic_scroll(now);
+      }
+      release_zone();
+
+      auto const click_duration_msec = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_touch_time).count();
+
+      async_log_debug("click duration: {:4} msec - offset: {:4} {:4}",
+                      click_duration_msec,
+                      std::abs(m_touchdown_pos_x - m_touch_pos_x),
+                      std::abs(m_touchdown_pos_y - m_touch_pos_y));
+
+      if (zone_type != HotZone::Type::BUTTON &&
+          click_duration_msec < tuning.tap_time_msec) {
+        if (std::abs(m_touch_pos_x - m_touchdown_pos_x) < tuning.tap_distance &&
+            std::abs(m_touch_pos_y - m_touchdown_pos_y) < tuning.tap_distance)
         {
           send_click = true;
         }
@@ -209,20 +318,171 @@ TouchpadDriver::receive_data(uint8_t const* data, size_t size)
     }
   }
 
+  if (m_opts.output_rate == 0.0) {
+    UDRAW_TRACE_SCOPE("sync");
+    m_evdev.sync();
+  } else if (button_edge || send_click || m_pressed_zone != previous_pressed_zone) {
+    // button changes are never delayed, pending motion has to go out
+    // first so that the click lands where the pointer is
+    flush_motion();
+    UDRAW_TRACE_SCOPE("sync");
+    m_evdev.sync();
+  }
+
   if (send_click) {
-    log_debug("sending click");
+    async_log_debug("sending click");
     m_touchclick->send(1);
     m_evdev.sync();
 
     m_touchclick->send(0);
     m_evdev.sync();
-  } else {
-    m_evdev.sync();
   }
 
   m_previous_mode = decoder.mode();
 }
 
+template<typename Layout>
+void
+TouchpadDriver<Layout>::press_zone(uint8_t zone)
+{
+  if (m_pressed_zone == zone) {
+    return;
+  }
+  release_zone();
+
+  for (uinpp::EventEmitter* key : m_zone_keys[zone]) {
+    key->send(1);
+  }
+  m_pressed_zone = zone;
+}
+
+template<typename Layout>
+void
+TouchpadDriver<Layout>::release_zone()
+{
+  if (m_pressed_zone < 0) {
+    return;
+  }
+
+  // modifiers come first in a combination, release them last
+  std::vector<uinpp::EventEmitter*> const& keys = m_zone_keys[static_cast<size_t>(m_pressed_zone)];
+  for (auto it = keys.rbegin(); it != keys.rend(); ++it) {
+    (*it)->send(0);
+  }
+  m_pressed_zone = -1;
+}
+
+template<typename Layout>
+void
+TouchpadDriver<Layout>::send_motion(int rel_x, int rel_y, int wheel, int hwheel)
+{
+  if (m_opts.output_rate == 0.0) {
+    m_rel_x->send(rel_x);
+    m_rel_y->send(rel_y);
+    m_rel_wheel->send(wheel);
+    m_rel_hwheel->send(hwheel);
+    return;
+  }
+
+  m_pending_rel_x += rel_x;
+  m_pending_rel_y += rel_y;
+  m_pending_wheel += wheel;
+  m_pending_hwheel += hwheel;
+
+  if (!m_flush_timer_active) {
+    m_flush_timer.start(std::chrono::nanoseconds(static_cast<int64_t>(1e9 / m_opts.output_rate)));
+    m_flush_timer_active = true;
+  }
+}
+
+template<typename Layout>
+void
+TouchpadDriver<Layout>::flush_motion()
+{
+  if (m_pending_rel_x != 0) {
+    m_rel_x->send(m_pending_rel_x);
+    m_pending_rel_x = 0;
+  }
+
+  if (m_pending_rel_y != 0) {
+    m_rel_y->send(m_pending_rel_y);
+    m_pending_rel_y = 0;
+  }
+
+  if (m_pending_wheel != 0) {
+    m_rel_wheel->send(m_pending_wheel);
+    m_pending_wheel = 0;
+  }
+
+  if (m_pending_hwheel != 0) {
+    m_rel_hwheel->send(m_pending_hwheel);
+    m_pending_hwheel = 0;
+  }
+}
+
+template<typename Layout>
+void
+TouchpadDriver<Layout>::on_flush_timer()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_pending_rel_x == 0 && m_pending_rel_y == 0 &&
+      m_pending_wheel == 0 && m_pending_hwheel == 0) {
+    // nothing moved for a whole period, sleep until the next motion
+    m_flush_timer.stop();
+    m_flush_timer_active = false;
+    return;
+  }
+
+  flush_motion();
+  m_evdev.sync();
+}
+
+template<typename Layout>
+void
+TouchpadDriver<Layout>::start_kinetic_scroll(std::chrono::steady_clock::time_point now)
+{
+  if (!m_opts.kinetic_scrolling) {
+    return;
+  }
+
+  if (m_kinetic.release(now)) {
+    m_kinetic_timer.start(kinetic_frame_interval);
+  }
+}
+
+template<typename Layout>
+void
+TouchpadDriver<Layout>::stop_kinetic_scroll()
+{
+  if (m_kinetic.active()) {
+    m_kinetic_timer.stop();
+  }
+  m_kinetic.reset();
+}
+
+template<typename Layout>
+void
+TouchpadDriver<Layout>::on_kinetic_timer(uint64_t expirations)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  int const units = m_kinetic.step(m_kinetic_timer.interval() * expirations);
+  if (units != 0) {
+    m_rel_wheel->send(units);
+    m_evdev.sync();
+  }
+
+  if (!m_kinetic.active()) {
+    // no more wakeups once the scroll has decayed
+    m_kinetic_timer.stop();
+  }
+}
+
+#define INSTANTIATE(Layout) template class TouchpadDriver<Layout>;
+UDRAW_FOR_EACH_LAYOUT(INSTANTIATE)
+#undef INSTANTIATE
+
 } // namespace driver
 
 /* EOF */
@@ -20,23 +20,48 @@
 #include "driver.hpp"
 
 #include <chrono>
+#include <mutex>
+#include <vector>
 
 #include "fwd.hpp"
+#include "hot_zones.hpp"
+#include "kinetic_scroller.hpp"
+#include "timer.hpp"
 #include "udraw_decoder.hpp"
 
 namespace udraw {
 
+template<typename Layout>
 class TouchpadDriver : public Driver
 {
 public:
-  TouchpadDriver(uinpp::MultiDevice& evdev);
+  TouchpadDriver(uinpp::MultiDevice& evdev, Options const& opts, TuningStore const& tuning,
+                 DeviceProfile const& profile);
   ~TouchpadDriver() override;
 
   void init() override;
   void receive_data(uint8_t const* data, size_t size) override;
 
+private:
+  void start_kinetic_scroll(std::chrono::steady_clock::time_point now);
+  void stop_kinetic_scroll();
+  void on_kinetic_timer(uint64_t expirations);
+
+  void press_zone(uint8_t zone);
+  void release_zone();
+
+  void send_motion(int rel_x, int rel_y, int wheel, int hwheel);
+  void flush_motion();
+  void on_flush_timer();
+
 private:
   uinpp::MultiDevice& m_evdev;
+  Options const& m_opts;
+  TuningStore const& m_tuning;
+  DeviceProfile const& m_profile;
+
+  /** protects the evdev and all state below against the timer thread */
+  std::mutex m_mutex;
 
   uinpp::EventEmitter* m_touchclick;
 
@@ -60,7 +85,15 @@ private:
   uinpp::EventEmitter* m_rel_x;
   uinpp::EventEmitter* m_rel_y;
 
-  UDrawDecoder::Mode m_previous_mode;
+  HotZoneMap m_zones;
+  /** the keys of each BUTTON zone, indexed like HotZoneMap::zones() */
+  std::vector<std::vector<uinpp::EventEmitter*>> m_zone_keys;
+  /** zone under the finger since it touched down */
+  uint8_t m_zone;
+  /** BUTTON zone whose keys are held, -1 for none */
+  int m_pressed_zone;
+
+  UDrawDecoderBase::Mode m_previous_mode;
   int m_discard_events;
   int m_touchdown_pos_x;
   int m_touchdown_pos_y;
@@ -68,10 +101,21 @@ private:
   int m_touch_pos_y;
   int m_multitouch_pos_x;
   int m_multitouch_pos_y;
-  bool m_scroll_wheel;
   int m_wheel_distance;
   std::chrono::steady_clock::time_point m_touch_time;
 
+  KineticScroller m_kinetic;
+  Timer m_kinetic_timer;
+
+  /** motion accumulated while coalescing to Options::output_rate */
+  int m_pending_rel_x;
+  int m_pending_rel_y;
+  int m_pending_wheel;
+  int m_pending_hwheel;
+  uint32_t m_previous_buttons;
+  bool m_flush_timer_active;
+  Timer m_flush_timer;
+
 private:
   TouchpadDriver(const TouchpadDriver&) = delete;
   TouchpadDriver& operator=(const TouchpadDriver&) = delete;
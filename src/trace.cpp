@@ -0,0 +1,153 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "trace.hpp"
+
+#ifdef UDRAW_TRACING
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+
+namespace udraw {
+namespace trace {
+
+std::atomic<bool> g_enabled(false);
+
+namespace {
+
+/** how often the writer drains the thread buffers */
+auto const flush_interval = std::chrono::milliseconds(100);
+
+struct Writer
+{
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  std::thread thread;
+  FILE* fp = nullptr;
+  bool quit = false;
+  bool first_event = true;
+};
+
+Writer g_writer;
+
+void write_events()
+{
+  for (auto& buffer : g_writer.buffers) {
+    buffer->drain([&buffer](Event const& event) {
+      fprintf(g_writer.fp, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld.%03lld,\"pid\":%d,\"tid\":%d}",
+              g_writer.first_event ? "\n" : ",\n",
+              event.name, event.phase,
+              static_cast<long long>(event.timestamp / 1000),
+              static_cast<long long>(event.timestamp % 1000),
+              static_cast<int>(getpid()), buffer->tid());
+      g_writer.first_event = false;
+    });
+  }
+}
+
+void run_writer()
+{
+  std::unique_lock<std::mutex> lock(g_writer.mutex);
+  while (!g_writer.quit)
+  {
+    g_writer.cond.wait_for(lock, flush_interval);
+    write_events();
+  }
+}
+
+} // namespace
+
+ThreadBuffer& thread_buffer()
+{
+  thread_local ThreadBuffer* t_buffer = nullptr;
+
+  if (!t_buffer) {
+    int const tid = static_cast<int>(syscall(SYS_gettid));
+    std::lock_guard<std::mutex> lock(g_writer.mutex);
+    g_writer.buffers.emplace_back(std::make_unique<ThreadBuffer>(tid));
+    t_buffer = g_writer.buffers.back().get();
+  }
+
+  return *t_buffer;
+}
+
+void start(std::string const& filename)
+{
+  g_writer.fp = fopen(filename.c_str(), "we");
+  if (!g_writer.fp) {
+    throw std::runtime_error(fmt::format("{}: {}", filename, strerror(errno)));
+  }
+
+  fputs("[", g_writer.fp);
+  g_writer.thread = std::thread(run_writer);
+  g_enabled.store(true, std::memory_order_relaxed);
+
+  log_info("writing trace to {}", filename);
+}
+
+void stop()
+{
+  if (!g_writer.fp) {
+    return;
+  }
+
+  g_enabled.store(false, std::memory_order_relaxed);
+
+  {
+    std::lock_guard<std::mutex> lock(g_writer.mutex);
+    g_writer.quit = true;
+  }
+  g_writer.cond.notify_one();
+  g_writer.thread.join();
+
+  // events that were recorded while the writer shut down
+  write_events();
+
+  uint64_t dropped = 0;
+  for (auto const& buffer : g_writer.buffers) {
+    dropped += buffer->dropped();
+  }
+  if (dropped != 0) {
+    log_warn("trace buffers overflowed, {} events dropped", dropped);
+  }
+
+  fputs("\n]\n", g_writer.fp);
+  fclose(g_writer.fp);
+  g_writer.fp = nullptr;
+}
+
+} // namespace trace
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -0,0 +1,156 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_TRACE_HPP
+#define HEADER_UDRAW_TRACE_HPP
+
+/*
+  Pipeline tracing in the Chrome trace event format, viewable in
+  chrome://tracing or ui.perfetto.dev. Only available when built with
+  -DUDRAW_TRACING=ON, otherwise UDRAW_TRACE_SCOPE() compiles to nothing.
+*/
+
+#ifdef UDRAW_TRACING
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <time.h>
+
+namespace udraw {
+namespace trace {
+
+struct Event
+{
+  char const* name;
+  int64_t timestamp;
+  char phase;
+};
+
+/** Single producer, single consumer ring, written by its thread and
+    drained by the background writer */
+class ThreadBuffer
+{
+public:
+  static constexpr size_t CAPACITY = 1 << 16;
+
+public:
+  ThreadBuffer(int tid) :
+    m_tid(tid),
+    m_head(0),
+    m_tail(0),
+    m_dropped(0),
+    m_events()
+  {}
+
+  void push(Event const& event)
+  {
+    uint64_t const head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) == CAPACITY) {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    m_events[head & (CAPACITY - 1)] = event;
+    m_head.store(head + 1, std::memory_order_release);
+  }
+
+  template<typename F>
+  void drain(F&& func)
+  {
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    uint64_t const head = m_head.load(std::memory_order_acquire);
+    for (; tail != head; ++tail) {
+      func(m_events[tail & (CAPACITY - 1)]);
+    }
+    m_tail.store(tail, std::memory_order_release);
+  }
+
+  int tid() const { return m_tid; }
+  uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+  int const m_tid;
+  alignas(64) std::atomic<uint64_t> m_head;
+  alignas(64) std::atomic<uint64_t> m_tail;
+  std::atomic<uint64_t> m_dropped;
+  Event m_events[CAPACITY];
+};
+
+extern std::atomic<bool> g_enabled;
+
+/** The calling thread's buffer, registered on first use */
+ThreadBuffer& thread_buffer();
+
+inline void record(char const* name, char phase)
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  thread_buffer().push(Event{name, int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec, phase});
+}
+
+class Scope
+{
+public:
+  /** \a name must be a string literal, only the pointer is recorded */
+  Scope(char const* name) :
+    m_name(g_enabled.load(std::memory_order_relaxed) ? name : nullptr)
+  {
+    if (m_name) {
+      record(m_name, 'B');
+    }
+  }
+
+  ~Scope()
+  {
+    if (m_name) {
+      record(m_name, 'E');
+    }
+  }
+
+private:
+  char const* m_name;
+
+private:
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+};
+
+/** Start the background writer, events are recorded from now on */
+void start(std::string const& filename);
+
+/** Write out the remaining events and close the file */
+void stop();
+
+} // namespace trace
+} // namespace udraw
+
+#define UDRAW_TRACE_CONCAT_IMPL(a, b) a##b
+#define UDRAW_TRACE_CONCAT(a, b) UDRAW_TRACE_CONCAT_IMPL(a, b)
+#define UDRAW_TRACE_SCOPE(name) \
+  ::udraw::trace::Scope UDRAW_TRACE_CONCAT(udraw_trace_scope_, __LINE__)(name)
+
+#else
+
+#define UDRAW_TRACE_SCOPE(name) do {} while (false)
+
+#endif
+
+#endif
+
+/* EOF */
@@ -0,0 +1,91 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "tuning.hpp"
+
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+namespace udraw {
+
+Tuning
+Tuning::from_file(std::string const& filename)
+{
+  std::ifstream in(filename);
+  if (!in) {
+    throw std::runtime_error(fmt::format("{}: {}", filename, strerror(errno)));
+  }
+
+  Tuning tuning;
+  std::string line;
+  for (int line_number = 1; std::getline(in, line); ++line_number)
+  {
+    line = line.substr(0, line.find('#'));
+    std::replace(line.begin(), line.end(), '=', ' ');
+
+    std::istringstream words(line);
+    std::string key;
+    if (!(words >> key)) {
+      continue;
+    }
+
+    try {
+      int Tuning::* field = nullptr;
+      if (key == "tap-time") {
+        field = &Tuning::tap_time_msec;
+      } else if (key == "tap-distance") {
+        field = &Tuning::tap_distance;
+      } else if (key == "wheel-scale") {
+        field = &Tuning::wheel_scale;
+      } else if (key == "pressure-threshold") {
+        field = &Tuning::pressure_threshold;
+      } else {
+        throw std::runtime_error(fmt::format("unknown key '{}'", key));
+      }
+
+      int value;
+      if (!(words >> value)) {
+        throw std::runtime_error(fmt::format("expected '{} = INTEGER'", key));
+      }
+
+      if (value < 0) {
+        throw std::runtime_error(fmt::format("{} must not be negative", key));
+      }
+
+      tuning.*field = value;
+
+      std::string rest;
+      if (words >> rest) {
+        throw std::runtime_error(fmt::format("trailing garbage '{}'", rest));
+      }
+    } catch (std::exception const& err) {
+      throw std::runtime_error(fmt::format("{}:{}: {}", filename, line_number, err.what()));
+    }
+  }
+
+  return tuning;
+}
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,47 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_UDRAW_TUNING_HPP
+#define HEADER_UDRAW_TUNING_HPP
+
+#include <string>
+
+namespace udraw {
+
+/** Thresholds of the drivers that can be changed while running by
+    editing the --config file. Once handed to a TuningStore an
+    instance is never modified again. */
+struct Tuning
+{
+  /** touchpad: longest touch that still counts as a tap */
+  int tap_time_msec = 150;
+  /** touchpad: surface units a tap may move */
+  int tap_distance = 16;
+  /** touchpad: wheel units per surface unit of scroll motion */
+  int wheel_scale = 5;
+  /** tablet: pressure above which the pen tip is down */
+  int pressure_threshold = 5;
+
+  /** Read "key = value" lines, '#' starts a comment and missing keys
+      keep their default */
+  static Tuning from_file(std::string const& filename);
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
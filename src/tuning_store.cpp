@@ -0,0 +1,67 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "tuning_store.hpp"
+
+#include <algorithm>
+
+#include <logmich/log.hpp>
+
+namespace udraw {
+
+TuningStore::TuningStore(Tuning const& tuning) :
+  m_current(new Tuning(tuning)),
+  m_epoch(0),
+  m_reader_epoch(0),
+  m_retired()
+{
+}
+
+TuningStore::~TuningStore()
+{
+  delete m_current.load();
+}
+
+void
+TuningStore::publish(std::unique_ptr<Tuning const> tuning)
+{
+  std::unique_ptr<Tuning const> old(m_current.exchange(tuning.release(), std::memory_order_acq_rel));
+  // a reader that sees the new epoch in quiescent() only gets the new
+  // pointer from get() afterwards
+  uint64_t const epoch = m_epoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+  m_retired.emplace_back(epoch, std::move(old));
+
+  reclaim();
+}
+
+void
+TuningStore::reclaim()
+{
+  uint64_t const reader_epoch = m_reader_epoch.load(std::memory_order_acquire);
+  m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(),
+                                 [reader_epoch](auto const& retired) {
+                                   return retired.first <= reader_epoch;
+                                 }),
+                  m_retired.end());
+
+  if (!m_retired.empty()) {
+    log_debug("{} retired tunings wait for the input thread", m_retired.size());
+  }
+}
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,78 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HEADER_UDRAW_TUNING_STORE_HPP
+#define HEADER_UDRAW_TUNING_STORE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tuning.hpp"
+
+namespace udraw {
+
+/** Hands the current Tuning to the input thread without locking.
+
+    A reload swaps in a new instance with a single atomic store, so a
+    report sees either the old or the new tuning but never a mix. The
+    replaced instance is kept until the reader announced a quiescent
+    state after the swap, it can't hold a reference to it anymore
+    from then on. There is exactly one reader, the thread that feeds
+    the reports to the driver. */
+class TuningStore
+{
+public:
+  TuningStore(Tuning const& tuning);
+  ~TuningStore();
+
+  /** Reader: the current tuning, valid until the next quiescent() */
+  Tuning const& get() const { return *m_current.load(std::memory_order_acquire); }
+
+  /** Reader: no reference returned by get() is in use anymore */
+  void quiescent() {
+    m_reader_epoch.store(m_epoch.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+  /** Writer: make \a tuning the current one and free the replaced
+      ones the reader is done with. Not thread-safe, there must be
+      only one writer. */
+  void publish(std::unique_ptr<Tuning const> tuning);
+
+private:
+  void reclaim();
+
+private:
+  std::atomic<Tuning const*> m_current;
+  /** incremented after each swap */
+  std::atomic<uint64_t> m_epoch;
+  /** m_epoch as seen by the reader at its last quiescent() */
+  std::atomic<uint64_t> m_reader_epoch;
+  /** replaced instances with the epoch that retired them */
+  std::vector<std::pair<uint64_t, std::unique_ptr<Tuning const>>> m_retired;
+
+private:
+  TuningStore(const TuningStore&) = delete;
+  TuningStore& operator=(const TuningStore&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -16,13 +16,20 @@
 
 #include "udraw_decoder.hpp"
 
+#include <iterator>
 #include <ostream>
 
+#include <fmt/format.h>
+
 namespace udraw {
 
-std::ostream& operator<<(std::ostream& os, UDrawDecoder const& decoder)
+template<typename Layout>
+std::ostream& operator<<(std::ostream& os, BasicUDrawDecoder<Layout> const& decoder)
 {
-  os << fmt::format(
+  // fmt::memory_buffer keeps the line on the stack, no allocation
+  fmt::memory_buffer buf;
+  fmt::format_to(
+    std::back_inserter(buf),
     "m:{} x:{:4} y:{:4} - p:{:3}% o:{:3}° d:{:3d}% - "
     "↑:{:d} →:{:d} ↓:{:d} ←:{:d} - "
     "△:{:d} ○:{:d} ×:{:d} □:{:d} - start:{:d} select:{:d} guide:{:d} "
@@ -43,9 +50,60 @@ std::ostream& operator<<(std::ostream& os, UDrawDecoder const& decoder)
 
     decoder.accel_x(), decoder.accel_y(), decoder.accel_z()
     );
+  os.write(buf.data(), static_cast<std::streamsize>(buf.size()));
   return os;
 }
 
+char const* to_string(UDrawDecoderBase::Error error)
+{
+  switch (error)
+  {
+    case UDrawDecoderBase::Error::NONE: return "none";
+    case UDrawDecoderBase::Error::TOO_SHORT: return "too short";
+    case UDrawDecoderBase::Error::BAD_HEADER: return "bad header";
+    case UDrawDecoderBase::Error::BAD_TRAILER: return "bad trailer";
+  }
+  return "unknown";
+}
+
+template<typename Layout>
+Sample to_sample(BasicUDrawDecoder<Layout> const& decoder, int64_t timestamp)
+{
+  Sample sample = {};
+
+  sample.timestamp = timestamp;
+  sample.buttons = static_cast<uint16_t>(
+    (decoder.square() ? Sample::SQUARE : 0) |
+    (decoder.cross() ? Sample::CROSS : 0) |
+    (decoder.circle() ? Sample::CIRCLE : 0) |
+    (decoder.triangle() ? Sample::TRIANGLE : 0) |
+    (decoder.start() ? Sample::START : 0) |
+    (decoder.select() ? Sample::SELECT : 0) |
+    (decoder.guide() ? Sample::GUIDE : 0) |
+    (decoder.up() ? Sample::UP : 0) |
+    (decoder.down() ? Sample::DOWN : 0) |
+    (decoder.left() ? Sample::LEFT : 0) |
+    (decoder.right() ? Sample::RIGHT : 0));
+  sample.mode = static_cast<uint8_t>(decoder.mode());
+  sample.orientation = static_cast<uint8_t>(decoder.orientation());
+  sample.pinch_distance = static_cast<uint8_t>(decoder.pinch_distance());
+
+  sample.x = static_cast<int16_t>(decoder.x());
+  sample.y = static_cast<int16_t>(decoder.y());
+  sample.pressure = static_cast<int16_t>(decoder.pressure());
+  sample.accel_x = static_cast<int16_t>(decoder.accel_x());
+  sample.accel_y = static_cast<int16_t>(decoder.accel_y());
+  sample.accel_z = static_cast<int16_t>(decoder.accel_z());
+
+  return sample;
+}
+
+#define INSTANTIATE(Layout) \
+  template std::ostream& operator<<(std::ostream& os, BasicUDrawDecoder<Layout> const& decoder); \
+  template Sample to_sample(BasicUDrawDecoder<Layout> const& decoder, int64_t timestamp);
+UDRAW_FOR_EACH_LAYOUT(INSTANTIATE)
+#undef INSTANTIATE
+
 } // namespace udraw
 
 /* EOF */
@@ -18,10 +18,12 @@
 #define HEADER_UDRAW_DECODER_HPP
 
 #include <iosfwd>
+#include <cstddef>
 #include <cstdint>
-#include <stdexcept>
+#include <cstring>
+#include <optional>
 
-#include <fmt/format.h>
+#include "shm/sample.hpp"
 
 namespace udraw {
 
@@ -119,7 +121,68 @@ struct Message
 };
 */
 
-class UDrawDecoder
+/** Byte offsets and masks of the 27 byte report of the PS3 tablet */
+struct Ps3Layout
+{
+  static constexpr size_t REPORT_SIZE = 27;
+
+  /** data[3..6] are always 0x80 */
+  static constexpr size_t HEADER = 3;
+  static constexpr uint32_t HEADER_VALUE = 0x80808080u;
+  static constexpr size_t TRAILER = 26;
+  static constexpr uint8_t TRAILER_VALUE = 0x02;
+
+  static constexpr size_t FACE_BUTTONS = 0;
+  static constexpr uint8_t SQUARE = 0x01;
+  static constexpr uint8_t CROSS = 0x02;
+  static constexpr uint8_t CIRCLE = 0x04;
+  static constexpr uint8_t TRIANGLE = 0x08;
+
+  static constexpr size_t SYSTEM_BUTTONS = 1;
+  static constexpr uint8_t START = 0x01;
+  static constexpr uint8_t SELECT = 0x02;
+  static constexpr uint8_t GUIDE = 0x10;
+
+  /** the d-pad once more as a hat switch, 0x0f when centered, unused
+      by the decoder which reads RIGHT..DOWN */
+  static constexpr size_t HAT = 2;
+
+  /** one byte each, 0 or 255 */
+  static constexpr size_t RIGHT = 7;
+  static constexpr size_t LEFT = 8;
+  static constexpr size_t UP = 9;
+  static constexpr size_t DOWN = 10;
+
+  /** mode in the top two bits, orientation below */
+  static constexpr size_t MODE = 11;
+  static constexpr int MODE_SHIFT = 6;
+  static constexpr uint8_t ORIENTATION_MASK = 0b00111111;
+
+  static constexpr size_t PINCH_DISTANCE = 12;
+  static constexpr size_t PRESSURE = 13;
+  static constexpr int PRESSURE_BIAS = 0x71;
+  static constexpr int MAX_PRESSURE = 142;
+
+  /** position is hi * 255 + lo */
+  static constexpr size_t X_HI = 15;
+  static constexpr size_t Y_HI = 16;
+  static constexpr size_t X_LO = 17;
+  static constexpr size_t Y_LO = 18;
+
+  /** little endian 16 bit, biased by 512 */
+  static constexpr size_t ACCEL_X = 19;
+  static constexpr size_t ACCEL_Y = 21;
+  static constexpr size_t ACCEL_Z = 23;
+  static constexpr int ACCEL_BIAS = 512;
+};
+
+/** Expands X(Layout) for every report layout, the layout dependent
+    templates in the .cpp files are explicitly instantiated with it */
+#define UDRAW_FOR_EACH_LAYOUT(X) \
+  X(Ps3Layout)
+
+/** The parts of the decoder that are the same for every layout */
+class UDrawDecoderBase
 {
 public:
   enum class Mode {
@@ -130,19 +193,66 @@ public:
     UNKNOWN,
   };
 
+  enum class Error {
+    NONE,
+    TOO_SHORT,
+    BAD_HEADER,
+    BAD_TRAILER,
+  };
+  static constexpr int ERROR_COUNT = 4;
+};
+
+/** Decoder for a report in \a Layout, the offsets are resolved at
+    compile time so a decoder costs the same as hand written code for
+    that layout */
+template<typename Layout>
+class BasicUDrawDecoder : public UDrawDecoderBase
+{
 public:
-  UDrawDecoder(uint8_t const* data, size_t len) :
-    m_data(data),
-    m_len(len)
+  static constexpr size_t REPORT_SIZE = Layout::REPORT_SIZE;
+  static constexpr int MAX_PRESSURE = Layout::MAX_PRESSURE;
+
+  /** Check the length and the bytes that are constant in every report,
+      the header is checked with a single 32bit compare */
+  static Error validate(uint8_t const* data, size_t len) noexcept
   {
-    if (m_len < 19) {
-      throw std::runtime_error(fmt::format("package size to small: {}", m_len));
+    if (len < REPORT_SIZE) {
+      return Error::TOO_SHORT;
     }
+
+    uint32_t header;
+    std::memcpy(&header, data + Layout::HEADER, sizeof(header));
+
+    if ((header ^ Layout::HEADER_VALUE) | (data[Layout::TRAILER] ^ Layout::TRAILER_VALUE)) {
+      return (header != Layout::HEADER_VALUE) ? Error::BAD_HEADER : Error::BAD_TRAILER;
+    }
+
+    return Error::NONE;
+  }
+
+  /** Non-throwing entry point for untrusted data, returns the decoder
+      or std::nullopt with \a error set to the reason */
+  static std::optional<BasicUDrawDecoder> parse(uint8_t const* data, size_t len, Error& error) noexcept
+  {
+    error = validate(data, len);
+    if (error != Error::NONE) {
+      return std::nullopt;
+    }
+    return BasicUDrawDecoder(data, len);
+  }
+
+public:
+  /** \a data must have passed validate(), this is checked by the caller
+      to keep the decoder free of exceptions, the length was checked
+      there too */
+  BasicUDrawDecoder(uint8_t const* data, size_t /*len*/) noexcept :
+    m_data(data)
+  {
   }
 
   Mode mode() const
   {
-    int m = (m_data[11] & 0b11000000) >> 6;
+    int m = (m_data[Layout::MODE] & 0b11000000) >> Layout::MODE_SHIFT;
 
     if (m == 3) {
       return Mode::MULTITOUCH;
@@ -159,48 +269,60 @@ public:
 
   // pen: 3px resolution
   // finger: 1px resolution
-  int x() const { return m_data[15] * 255 + m_data[17]; }
-  int y() const { return m_data[16] * 255 + m_data[18]; }
+  int x() const { return m_data[Layout::X_HI] * 255 + m_data[Layout::X_LO]; }
+  int y() const { return m_data[Layout::Y_HI] * 255 + m_data[Layout::Y_LO]; }
 
   /** Pressure is registered all the time, even if fingers are used or
       when the pen isn't on the table, maximum value is 255,
       flips 0x71/0x72 without touch */
-  int pressure() const { return m_data[13] - 0x71; }
-  int max_pressure() const { return 142; }
+  int pressure() const { return m_data[Layout::PRESSURE] - Layout::PRESSURE_BIAS; }
+  int max_pressure() const { return MAX_PRESSURE; }
 
   /** first two bits seem to be for the two fingers, precision is poor
    more data hiding in 12 */
-  int orientation() const { return m_data[11] & 0b00111111; }
+  int orientation() const { return m_data[Layout::MODE] & Layout::ORIENTATION_MASK; }
   int max_orientation() const { return 63; }
 
-  int pinch_distance() const { return m_data[12]; }
+  int pinch_distance() const { return m_data[Layout::PINCH_DISTANCE]; }
   int max_pinch_distance() const { return 255; }
 
   /* values from -32 to 31 */
-  int accel_x() const { return ((m_data[20] << 8) | m_data[19]) - 512; };
-  int accel_y() const { return ((m_data[22] << 8) | m_data[21]) - 512; };
-  int accel_z() const { return ((m_data[24] << 8) | m_data[23]) - 512; };
+  int accel_x() const { return accel(Layout::ACCEL_X); }
+  int accel_y() const { return accel(Layout::ACCEL_Y); }
+  int accel_z() const { return accel(Layout::ACCEL_Z); }
+
+  bool up() const { return m_data[Layout::UP]; }
+  bool down() const { return m_data[Layout::DOWN]; }
+  bool left() const { return m_data[Layout::LEFT]; }
+  bool right() const { return m_data[Layout::RIGHT]; }
 
-  bool up() const { return m_data[9]; }
-  bool down() const { return m_data[10]; }
-  bool left() const { return m_data[8]; }
-  bool right() const { return m_data[7]; }
+  bool square() const { return m_data[Layout::FACE_BUTTONS] & Layout::SQUARE; }
+  bool cross() const { return m_data[Layout::FACE_BUTTONS] & Layout::CROSS; }
+  bool triangle() const { return m_data[Layout::FACE_BUTTONS] & Layout::TRIANGLE; }
+  bool circle() const { return m_data[Layout::FACE_BUTTONS] & Layout::CIRCLE; }
 
-  bool square() const { return m_data[0] & 1; }
-  bool cross() const { return m_data[0] & 2; }
-  bool triangle() const { return m_data[0] & 8; }
-  bool circle() const { return m_data[0] & 4; }
+  bool start() const { return m_data[Layout::SYSTEM_BUTTONS] & Layout::START; }
+  bool select() const { return m_data[Layout::SYSTEM_BUTTONS] & Layout::SELECT; }
+  bool guide() const { return m_data[Layout::SYSTEM_BUTTONS] & Layout::GUIDE; }
 
-  bool start() const { return m_data[1] & 1; }
-  bool select() const { return m_data[1] & 2; }
-  bool guide() const { return m_data[1] & 0x10; }
+private:
+  int accel(size_t offset) const { return ((m_data[offset + 1] << 8) | m_data[offset]) - Layout::ACCEL_BIAS; }
 
 private:
   uint8_t const* m_data;
-  size_t m_len;
 };
 
-std::ostream& operator<<(std::ostream& os, UDrawDecoder const& decoder);
+/** All supported devices report in the PS3 layout */
+using UDrawDecoder = BasicUDrawDecoder<Ps3Layout>;
+
+template<typename Layout>
+std::ostream& operator<<(std::ostream& os, BasicUDrawDecoder<Layout> const& decoder);
+
+char const* to_string(UDrawDecoderBase::Error error);
+
+/** Convert the report to the fixed layout used for shared memory */
+template<typename Layout>
+Sample to_sample(BasicUDrawDecoder<Layout> const& decoder, int64_t timestamp);
 
 } // namespace udraw
 
@@ -16,104 +16,304 @@
 
 #include "udraw_driver.hpp"
 
+#include <errno.h>
 #include <linux/uinput.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <sstream>
+#include <thread>
 
 #include <fmt/format.h>
 #include <logmich/log.hpp>
 #include <uinpp/multi_device.hpp>
 
+#include "async_log.hpp"
+#include "device_profile.hpp"
+#include "driver.hpp"
+#include "file_watcher.hpp"
+#include "flight_recorder.hpp"
+#include "flight_recorder_writer.hpp"
 #include "options.hpp"
+#include "perf_counters.hpp"
+#include "report_format.hpp"
+#include "report_reader.hpp"
+#include "sample_ring_writer.hpp"
+#include "signals.hpp"
+#include "trace.hpp"
+#include "tuning_store.hpp"
 #include "udraw_decoder.hpp"
 #include "usb_device.hpp"
 
-#include "gamepad_driver.hpp"
-#include "keyboard_driver.hpp"
-#include "tablet_driver.hpp"
-#include "touchpad_driver.hpp"
-
 namespace udraw {
 
 namespace {
 
+/** upper bound for the report rate, used to size the flight recorder,
+    dumps are trimmed to the configured seconds by timestamp */
+int const max_report_rate = 1000;
+
+int64_t now_nsec()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 void print_raw_data(std::ostream& out, uint8_t const* data, size_t len)
 {
-  out << "[" << len
-            << "] ";
+  // large enough to keep a whole report on the stack, no allocation
+  fmt::basic_memory_buffer<char, 1024> buf;
+  fmt::format_to(std::back_inserter(buf), "[{}] ", len);
 
   for(size_t i = 0; i < len; ++i)
   {
-    //out << fmt::format("[{:d}]{:02x}", i, int(data[i]));
-    out << fmt::format("[{:d}]{:08b}", i, int(data[i]));
+    //fmt::format_to(std::back_inserter(buf), "[{:d}]{:02x}", i, int(data[i]));
+    fmt::format_to(std::back_inserter(buf), "[{:d}]{:08b}", i, int(data[i]));
     if (i != len-1)
-      out << " ";
+      buf.push_back(' ');
   }
 
+  out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
 }
 
 } // namespace
 
-UDrawDriver::UDrawDriver(USBDevice& usbdev, uinpp::MultiDevice& evdev, Options const& opts) :
-  m_usbdev(usbdev),
+UDrawDriver::UDrawDriver(uinpp::MultiDevice& evdev, Options const& opts, DeviceProfile const& profile) :
   m_evdev(evdev),
   m_opts(opts),
-  m_driver()
+  m_profile(profile),
+  m_tuning(std::make_unique<TuningStore>(opts.config_filename.empty() ? Tuning() : Tuning::from_file(opts.config_filename))),
+  m_config_watcher(),
+  m_driver(),
+  m_sample_ring(),
+  m_stats(),
+  m_start_timestamp(now_nsec()),
+  m_perf_counters(),
+  m_last_report(),
+  m_last_report_size(0),
+  m_flight_recorder(),
+  m_flight_recorder_writer(),
+  m_dump_count(0),
+  m_last_dump_timestamp(0)
 {
-  if (m_opts.mode == Options::Mode::KEYBOARD)
-  {
-    m_driver = std::make_unique<KeyboardDriver>(evdev);
-  }
-  else if (m_opts.mode == Options::Mode::GAMEPAD)
+  if (!m_opts.config_filename.empty())
   {
-    m_driver = std::make_unique<GamepadDriver>(evdev);
+    m_config_watcher = std::make_unique<FileWatcher>(m_opts.config_filename, [this]{ reload_config(); });
   }
-  else if (m_opts.mode == Options::Mode::TABLET)
+
+  m_driver = m_profile.format->create_driver(evdev, m_opts, *m_tuning, m_profile);
+
+  if (!m_opts.shm_path.empty())
   {
-    m_driver = std::make_unique<TabletDriver>(evdev);
+    m_sample_ring = std::make_unique<SampleRingWriter>(m_opts.shm_path, m_opts.shm_group);
   }
-  else if (m_opts.mode == Options::Mode::TOUCHPAD)
+
+  if (m_opts.flight_recorder_seconds > 0)
   {
-    m_driver = std::make_unique<TouchpadDriver>(evdev);
+    size_t const capacity = static_cast<size_t>(m_opts.flight_recorder_seconds * max_report_rate);
+    int64_t const window = int64_t(m_opts.flight_recorder_seconds) * 1000000000;
+    m_flight_recorder = std::make_unique<FlightRecorder>(capacity, window);
+    m_flight_recorder_writer = std::make_unique<FlightRecorderWriter>(capacity, window, m_opts.flight_recorder_dir);
   }
 }
 
 UDrawDriver::~UDrawDriver()
 {
+  std::ostringstream out;
+  out << m_stats;
+  log_info("{}", out.str());
+  log_activity(now_nsec());
+  log_perf_counters();
 }
 
 void
-UDrawDriver::run()
+UDrawDriver::run(USBDevice& usbdev)
 {
-  m_usbdev.print_info(std::cout);
-  m_usbdev.detach_kernel_driver(0);
-  m_usbdev.claim_interface(0);
+  usbdev.print_info(std::cout);
+  usbdev.detach_kernel_driver(m_profile.interface);
+  usbdev.claim_interface(m_profile.interface);
 
   if (m_driver) {
     m_driver->init();
   }
 
-  m_usbdev.listen(3, [this](uint8_t* data, int size){
-    on_data(data, size);
-  });
+  prepare_input_thread();
+
+  usbdev.listen(m_profile.endpoint, [](void* userdata, uint8_t const* data, size_t size){
+    static_cast<UDrawDriver*>(userdata)->on_data(now_nsec(), data, size);
+  }, [](void* userdata){
+    // the device sends nothing while asleep, SIGUSR1 still gets served
+    static_cast<UDrawDriver*>(userdata)->poll_dump_request(now_nsec());
+  }, this, g_quit_requested, g_signal_fd);
+
+  // listen() returns on USB errors and on quit
+  dump_flight_recorder(now_nsec(), "exit", true);
+}
+
+void
+UDrawDriver::replay(std::string const& filename)
+{
+  std::unique_ptr<ReportReader> reader = open_report_reader(filename);
+  replay(*reader);
 }
 
 void
-UDrawDriver::on_data(uint8_t const* data, size_t size)
+UDrawDriver::replay(ReportReader& reader)
 {
   if (m_driver) {
-    m_driver->receive_data(data, size);
+    m_driver->init();
   }
 
-  if (m_opts.mode == Options::Mode::TEST)
+  prepare_input_thread();
+
+  CaptureRecord record;
+
+  auto const start = std::chrono::steady_clock::now();
+  int64_t first_timestamp = -1;
+  uint64_t count = 0;
+
+  while (!g_quit_requested.load(std::memory_order_relaxed) && reader.next(record))
   {
-    UDrawDecoder decoder(data, size);
-    std::cout << decoder << std::endl;
+    if (first_timestamp < 0) {
+      first_timestamp = record.timestamp;
+    }
+
+    std::this_thread::sleep_until(start + std::chrono::nanoseconds(record.timestamp - first_timestamp));
+    on_data(now_nsec(), record.data, record.size);
+    count += 1;
+  }
+
+  std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+  log_info("replayed {} reports in {:.3f}s, {:.0f} reports/s",
+           count, elapsed.count(), static_cast<double>(count) / std::max(elapsed.count(), 1e-9));
+}
+
+void
+UDrawDriver::reload_config()
+{
+  // parse on the watcher thread, the input thread only sees the
+  // finished tuning
+  try {
+    m_tuning->publish(std::make_unique<Tuning const>(Tuning::from_file(m_opts.config_filename)));
+    log_info("{}: configuration reloaded", m_opts.config_filename);
+  } catch (std::exception const& err) {
+    log_error("keeping the previous configuration: {}", err.what());
+  }
+}
+
+void
+UDrawDriver::prepare_input_thread()
+{
+  // the counters measure the thread that opens them
+  if (m_opts.perf_counters && !m_perf_counters) {
+    m_perf_counters = std::make_unique<PerfCounters>();
   }
-  else if (m_opts.mode == Options::Mode::RAW)
+
+  // register the thread's buffers now, not on its first message
+  if (async_log::g_enabled.load(std::memory_order_relaxed)) {
+    async_log::thread_buffer();
+  }
+
+#ifdef UDRAW_TRACING
+  if (trace::g_enabled.load(std::memory_order_relaxed)) {
+    trace::thread_buffer();
+  }
+#endif
+}
+
+void
+UDrawDriver::on_data(int64_t timestamp, uint8_t const* data, size_t size)
+{
+  // the driver holds no reference to the tuning between reports
+  m_tuning->quiescent();
+
+  m_stats.reports += 1;
+
+  poll_dump_request(timestamp);
+
+  if (m_opts.mode == Options::Mode::RAW)
   {
+    // show everything, including reports that fail validation
     print_raw_data(std::cout, data, size);
     std::cout << std::endl;
   }
+  else if (m_opts.idle_skip)
+  {
+    // The device keeps sending its current state while nothing
+    // changes. Nothing downstream depends on seeing the same state
+    // twice, the drivers' timers run on their own clock.
+    if (size == m_last_report_size && std::memcmp(data, m_last_report.data(), size) == 0) {
+      m_stats.idle += 1;
+      return;
+    }
+
+    if (size <= m_last_report.size()) {
+      std::memcpy(m_last_report.data(), data, size);
+      m_last_report_size = size;
+    } else {
+      m_last_report_size = 0;
+    }
+  }
+
+  if (m_flight_recorder) {
+    m_flight_recorder->record(timestamp, data, size);
+  }
+
+  UDrawDecoderBase::Error error;
+  {
+    UDRAW_TRACE_SCOPE("decode");
+    error = m_profile.format->validate(data, size);
+  }
+
+  if (error != UDrawDecoderBase::Error::NONE) {
+    uint64_t& count = m_stats.rejected[static_cast<size_t>(error)];
+    if (count == 0) {
+      // the leading bytes packed into one argument, formatting them is
+      // left to the log writer
+      uint64_t head = 0;
+      for (size_t i = 0; i < std::min<size_t>(size, sizeof(head)); ++i) {
+        head |= uint64_t(data[i]) << (56 - 8 * i);
+      }
+      async_log_warn("rejecting report ({}): {} bytes, starting {:016x}", to_string(error), size, head);
+    }
+    count += 1;
+    dump_flight_recorder(timestamp, "decode error", false);
+    return;
+  }
+
+  if (m_sample_ring) {
+    m_sample_ring->publish(m_profile.format->to_sample(data, size, timestamp));
+  }
+
+  if (m_driver) {
+    UDRAW_TRACE_SCOPE("emit");
+
+    if (m_perf_counters) {
+      m_perf_counters->begin();
+    }
+
+    try {
+      m_driver->receive_data(data, size);
+    } catch (std::exception const& err) {
+      async_log_error("driver error: {}", err.what());
+      dump_flight_recorder(timestamp, "driver error", false);
+    }
+
+    if (m_perf_counters) {
+      m_perf_counters->end();
+    }
+  }
+
+  if (m_opts.mode == Options::Mode::TEST)
+  {
+    m_profile.format->print(std::cout, data, size);
+    std::cout << std::endl;
+  }
 
 #if 0
   if (false)
@@ -158,6 +358,85 @@ UDrawDriver::on_data(uint8_t const* data, size_t size)
 #endif
 }
 
+void
+UDrawDriver::poll_dump_request(int64_t timestamp)
+{
+  if (g_dump_requested.load(std::memory_order_relaxed)) {
+    g_dump_requested.store(false, std::memory_order_relaxed);
+    on_dump_request(timestamp);
+  }
+}
+
+void
+UDrawDriver::on_dump_request(int64_t timestamp)
+{
+  log_activity(timestamp);
+  log_perf_counters();
+  dump_flight_recorder(timestamp, "signal", true);
+}
+
+void
+UDrawDriver::log_perf_counters() const
+{
+  if (!m_perf_counters) {
+    return;
+  }
+
+  std::ostringstream out;
+  m_perf_counters->print(out);
+  log_info("{}", out.str());
+}
+
+void
+UDrawDriver::log_activity(int64_t timestamp) const
+{
+  double const elapsed = static_cast<double>(std::max<int64_t>(timestamp - m_start_timestamp, 1)) / 1e9;
+
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    async_log_error("getrusage failed: {}", strerror(errno));
+    return;
+  }
+
+  auto const to_seconds = [](timeval const& tv) {
+    return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) / 1e6;
+  };
+  double const cpu = to_seconds(usage.ru_utime) + to_seconds(usage.ru_stime);
+
+  // voluntary context switches are the times a thread blocked and got
+  // woken up again, for the USB thread as well as the driver timers
+  async_log_info("activity over {:.1f}s: {:.1f} reports/s, {:.1f}% idle, {:.1f} wakeups/s, {:.2f}s CPU/hour",
+                 elapsed,
+                 static_cast<double>(m_stats.reports) / elapsed,
+                 m_stats.reports == 0 ? 0.0 : 100.0 * static_cast<double>(m_stats.idle) / static_cast<double>(m_stats.reports),
+                 static_cast<double>(usage.ru_nvcsw) / elapsed,
+                 cpu / elapsed * 3600.0);
+}
+
+void
+UDrawDriver::dump_flight_recorder(int64_t timestamp, char const* reason, bool force)
+{
+  if (!m_flight_recorder || m_flight_recorder->size() == 0) {
+    return;
+  }
+
+  // don't keep dumping the same reports on a stream of errors
+  int64_t const min_interval = int64_t(m_opts.flight_recorder_seconds) * 1000000000;
+  if (!force && m_dump_count > 0 && timestamp - m_last_dump_timestamp < min_interval) {
+    return;
+  }
+
+  if (!m_flight_recorder_writer->submit(*m_flight_recorder, reason, m_dump_count)) {
+    if (force) {
+      async_log_warn("flight recorder ({}): previous dump still being written, skipped", reason);
+    }
+    return;
+  }
+
+  m_dump_count += 1;
+  m_last_dump_timestamp = timestamp;
+}
+
 } // namespace udraw
 
 /* EOF */
@@ -17,31 +17,88 @@
 #ifndef HEADER_UDRAW_DRIVER_HPP
 #define HEADER_UDRAW_DRIVER_HPP
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <string>
 
 #include "fwd.hpp"
+#include "stats.hpp"
 
 namespace udraw {
 
 class UDrawDriver
 {
 public:
-  UDrawDriver(USBDevice& usbdev, uinpp::MultiDevice& evdev, Options const& opts);
+  /** \a profile is the device the reports come from, the virtual
+      devices get its IDs */
+  UDrawDriver(uinpp::MultiDevice& evdev, Options const& opts, DeviceProfile const& profile);
   ~UDrawDriver();
 
-  void run();
+  /** Process reports from the device until an error or a quit signal */
+  void run(USBDevice& usbdev);
+
+  /** Process the reports from a capture or usbmon file, paced by
+      their original timestamps */
+  void replay(std::string const& filename);
+  void replay(ReportReader& reader);
 
 private:
-  void on_data(uint8_t const* data, size_t size);
+  /** Runs on the FileWatcher thread when the --config file changed */
+  void reload_config();
+
+  /** Set up everything on_data() needs on the calling thread, so that
+      handling a report never allocates */
+  void prepare_input_thread();
+
+  void on_data(int64_t timestamp, uint8_t const* data, size_t size);
+
+  /** Handle a pending SIGUSR1, called for every report and when the
+      device is quiet */
+  void poll_dump_request(int64_t timestamp);
+
+  /** SIGUSR1: log the activity and perf counters and dump the flight
+      recorder */
+  void on_dump_request(int64_t timestamp);
+
+  void log_perf_counters() const;
+
+  /** Log the report rate, the share of idle reports, process wakeups
+      per second and CPU time per hour since startup */
+  void log_activity(int64_t timestamp) const;
+
+  /** Hand the flight recorder to the writer thread. Error triggered
+      dumps are skipped unless \a force is set or the last dump is
+      older than the recorded time span, any dump is skipped while the
+      previous one is still being written. */
+  void dump_flight_recorder(int64_t timestamp, char const* reason, bool force);
 
 private:
-  USBDevice& m_usbdev;
   uinpp::MultiDevice& m_evdev;
   Options const& m_opts;
+  DeviceProfile const& m_profile;
+
+  /** declared before m_driver, which keeps a reference to it */
+  std::unique_ptr<TuningStore> m_tuning;
+  std::unique_ptr<FileWatcher> m_config_watcher;
 
   std::unique_ptr<Driver> m_driver;
+  std::unique_ptr<SampleRingWriter> m_sample_ring;
+  Stats m_stats;
+  int64_t m_start_timestamp;
+
+  /** opened by prepare_input_thread() */
+  std::unique_ptr<PerfCounters> m_perf_counters;
+
+  /** the last report, identical reports are skipped in idle mode */
+  std::array<uint8_t, 64> m_last_report;
+  size_t m_last_report_size;
+
+  std::unique_ptr<FlightRecorder> m_flight_recorder;
+  std::unique_ptr<FlightRecorderWriter> m_flight_recorder_writer;
+  int m_dump_count;
+  int64_t m_last_dump_timestamp;
 
 private:
   UDrawDriver(const UDrawDriver&) = delete;
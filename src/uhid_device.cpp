@@ -0,0 +1,208 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "uhid_device.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <linux/uhid.h>
+#include <poll.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+
+namespace udraw {
+
+namespace {
+
+void write_event(int fd, uhid_event const& ev, size_t size)
+{
+  ssize_t ret;
+  do {
+    ret = write(fd, &ev, size);
+  } while (ret < 0 && errno == EINTR);
+
+  if (ret < 0) {
+    throw std::runtime_error(fmt::format("/dev/uhid: write failed: {}", strerror(errno)));
+  }
+}
+
+} // namespace
+
+UHIDDevice::UHIDDevice(std::string const& name, uint16_t vendor_id, uint16_t product_id,
+                       std::vector<uint8_t> const& report_descriptor) :
+  m_name(name),
+  m_fd(open("/dev/uhid", O_RDWR | O_CLOEXEC | O_NONBLOCK)),
+  m_quit_fd(-1),
+  m_thread()
+{
+  if (m_fd < 0) {
+    throw std::runtime_error(fmt::format("/dev/uhid: {}", strerror(errno)));
+  }
+
+  uhid_event ev = {};
+  ev.type = UHID_CREATE2;
+  strncpy(reinterpret_cast<char*>(ev.u.create2.name), name.c_str(), sizeof(ev.u.create2.name) - 1);
+  strncpy(reinterpret_cast<char*>(ev.u.create2.phys), "uDraw uhid", sizeof(ev.u.create2.phys) - 1);
+  ev.u.create2.rd_size = static_cast<uint16_t>(std::min(report_descriptor.size(), sizeof(ev.u.create2.rd_data)));
+  ev.u.create2.bus = BUS_USB;
+  ev.u.create2.vendor = vendor_id;
+  ev.u.create2.product = product_id;
+  ev.u.create2.version = 0x110;
+  memcpy(ev.u.create2.rd_data, report_descriptor.data(), ev.u.create2.rd_size);
+
+  m_quit_fd = eventfd(0, EFD_CLOEXEC);
+  if (m_quit_fd < 0) {
+    int const err = errno;
+    close(m_fd);
+    throw std::runtime_error(fmt::format("eventfd() failed: {}", strerror(err)));
+  }
+
+  try {
+    write_event(m_fd, ev, sizeof(ev));
+  } catch (...) {
+    close(m_quit_fd);
+    close(m_fd);
+    throw;
+  }
+
+  m_thread = std::thread([this]{ run(); });
+}
+
+UHIDDevice::~UHIDDevice()
+{
+  uint64_t const one = 1;
+  if (write(m_quit_fd, &one, sizeof(one)) != sizeof(one)) {
+    log_error("{}: failed to signal uhid thread: {}", m_name, strerror(errno));
+  }
+  m_thread.join();
+  close(m_quit_fd);
+
+  uhid_event ev = {};
+  ev.type = UHID_DESTROY;
+  if (write(m_fd, &ev, sizeof(ev.type)) < 0) {
+    log_error("{}: destroy failed: {}", m_name, strerror(errno));
+  }
+  close(m_fd);
+}
+
+void
+UHIDDevice::send_input(uint8_t const* data, size_t size)
+{
+  uhid_event ev;
+  ev.type = UHID_INPUT2;
+  ev.u.input2.size = static_cast<uint16_t>(std::min<size_t>(size, UHID_DATA_MAX));
+  memcpy(ev.u.input2.data, data, ev.u.input2.size);
+
+  // the kernel zero fills short writes, no need to copy the whole event
+  write_event(m_fd, ev, offsetof(uhid_event, u.input2.data) + ev.u.input2.size);
+}
+
+void
+UHIDDevice::run()
+{
+  pollfd fds[2];
+  fds[0].fd = m_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = m_quit_fd;
+  fds[1].events = POLLIN;
+
+  while (true)
+  {
+    int const ret = poll(fds, 2, -1);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      log_error("{}: poll() failed: {}", m_name, strerror(errno));
+      return;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      return;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      try {
+        dispatch();
+      } catch (std::exception const& err) {
+        log_error("{}: {}", m_name, err.what());
+        return;
+      }
+    }
+  }
+}
+
+void
+UHIDDevice::dispatch()
+{
+  // the descriptors don't have feature reports, requests for them are
+  // answered with an error instead of letting them time out
+  uhid_event ev;
+  while (read(m_fd, &ev, sizeof(ev)) > 0)
+  {
+    switch (ev.type)
+    {
+      case UHID_START:
+        log_debug("{}: started", m_name);
+        break;
+
+      case UHID_OPEN:
+        log_debug("{}: opened", m_name);
+        break;
+
+      case UHID_CLOSE:
+        log_debug("{}: closed", m_name);
+        break;
+
+      case UHID_GET_REPORT: {
+        uint32_t const id = ev.u.get_report.id;
+        ev = {};
+        ev.type = UHID_GET_REPORT_REPLY;
+        ev.u.get_report_reply.id = id;
+        ev.u.get_report_reply.err = EIO;
+        write_event(m_fd, ev, offsetof(uhid_event, u.get_report_reply.data));
+        break;
+      }
+
+      case UHID_SET_REPORT: {
+        uint32_t const id = ev.u.set_report.id;
+        ev = {};
+        ev.type = UHID_SET_REPORT_REPLY;
+        ev.u.set_report_reply.id = id;
+        ev.u.set_report_reply.err = EIO;
+        write_event(m_fd, ev, sizeof(ev.type) + sizeof(ev.u.set_report_reply));
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+}
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,66 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_UHID_DEVICE_HPP
+#define HEADER_UDRAW_UHID_DEVICE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace udraw {
+
+/** A virtual HID device created through /dev/uhid, the kernel parses
+    the report descriptor and handles the input reports with its
+    regular HID drivers (hid-generic, hid-multitouch). Requests from the
+    kernel are answered from a separate thread, so they don't have to
+    wait for the next input report. */
+class UHIDDevice
+{
+public:
+  UHIDDevice(std::string const& name, uint16_t vendor_id, uint16_t product_id,
+             std::vector<uint8_t> const& report_descriptor);
+  ~UHIDDevice();
+
+  /** Send an input report, including the report id if the descriptor
+      uses them, this is a single write() */
+  void send_input(uint8_t const* data, size_t size);
+
+private:
+  void run();
+
+  /** Answer pending requests from the kernel without blocking */
+  void dispatch();
+
+private:
+  std::string m_name;
+  int m_fd;
+  int m_quit_fd;
+  std::thread m_thread;
+
+private:
+  UHIDDevice(const UHIDDevice&) = delete;
+  UHIDDevice& operator=(const UHIDDevice&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -0,0 +1,202 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "uhid_multitouch_driver.hpp"
+
+#include <utility>
+#include <vector>
+
+#include "device_profile.hpp"
+#include "trace.hpp"
+#include "udraw_decoder.hpp"
+#include "uhid_device.hpp"
+
+namespace udraw {
+
+namespace {
+
+uint8_t const REPORT_ID = 2;
+size_t const FINGER_SIZE = 6;
+
+std::vector<uint8_t> make_report_descriptor()
+{
+  std::vector<uint8_t> const head = {
+    0x05, 0x0d,        // Usage Page (Digitizers)
+    0x09, 0x05,        // Usage (Touch Pad)
+    0xa1, 0x01,        // Collection (Application)
+    0x85, REPORT_ID,   //   Report ID
+  };
+
+  // tip switch, contact identifier, x and y, same resolution as MultitouchDriver
+  std::vector<uint8_t> const finger = {
+    0x09, 0x22,        //   Usage (Finger)
+    0xa1, 0x02,        //   Collection (Logical)
+    0x09, 0x42,        //     Usage (Tip Switch)
+    0x15, 0x00,        //     Logical Minimum (0)
+    0x25, 0x01,        //     Logical Maximum (1)
+    0x75, 0x01,        //     Report Size (1)
+    0x95, 0x01,        //     Report Count (1)
+    0x81, 0x02,        //     Input (Data,Var,Abs)
+    0x95, 0x07,        //     Report Count (7)
+    0x81, 0x03,        //     Input (Const,Var,Abs)
+    0x09, 0x51,        //     Usage (Contact Identifier)
+    0x25, 0x01,        //     Logical Maximum (1)
+    0x75, 0x08,        //     Report Size (8)
+    0x95, 0x01,        //     Report Count (1)
+    0x81, 0x02,        //     Input (Data,Var,Abs)
+    0x05, 0x01,        //     Usage Page (Generic Desktop)
+    0x09, 0x30,        //     Usage (X)
+    0x26, 0x80, 0x07,  //     Logical Maximum (1920)
+    0x35, 0x00,        //     Physical Minimum (0)
+    0x46, 0xa0, 0x00,  //     Physical Maximum (160)
+    0x65, 0x11,        //     Unit (Centimeter)
+    0x55, 0x0f,        //     Unit Exponent (-1)
+    0x75, 0x10,        //     Report Size (16)
+    0x81, 0x02,        //     Input (Data,Var,Abs)
+    0x09, 0x31,        //     Usage (Y)
+    0x26, 0x38, 0x04,  //     Logical Maximum (1080)
+    0x46, 0x5a, 0x00,  //     Physical Maximum (90)
+    0x81, 0x02,        //     Input (Data,Var,Abs)
+    0x45, 0x00,        //     Physical Maximum (0)
+    0x65, 0x00,        //     Unit (None)
+    0x55, 0x00,        //     Unit Exponent (0)
+    0x05, 0x0d,        //     Usage Page (Digitizers)
+    0xc0,              //   End Collection
+  };
+
+  std::vector<uint8_t> const tail = {
+    0x09, 0x54,        //   Usage (Contact Count)
+    0x25, 0x02,        //   Logical Maximum (2)
+    0x75, 0x08,        //   Report Size (8)
+    0x95, 0x01,        //   Report Count (1)
+    0x81, 0x02,        //   Input (Data,Var,Abs)
+    0x05, 0x09,        //   Usage Page (Button)
+    0x19, 0x01,        //   Usage Minimum (1)
+    0x29, 0x03,        //   Usage Maximum (3)
+    0x25, 0x01,        //   Logical Maximum (1)
+    0x75, 0x01,        //   Report Size (1)
+    0x95, 0x03,        //   Report Count (3)
+    0x81, 0x02,        //   Input (Data,Var,Abs)
+    0x95, 0x05,        //   Report Count (5)
+    0x81, 0x03,        //   Input (Const,Var,Abs)
+    0xc0,              // End Collection
+  };
+
+  std::vector<uint8_t> descriptor = head;
+  descriptor.insert(descriptor.end(), finger.begin(), finger.end());
+  descriptor.insert(descriptor.end(), finger.begin(), finger.end());
+  descriptor.insert(descriptor.end(), tail.begin(), tail.end());
+  return descriptor;
+}
+
+int distance2(int x0, int y0, int x1, int y1)
+{
+  return (x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0);
+}
+
+} // namespace
+
+template<typename Layout>
+UHIDMultitouchDriver<Layout>::UHIDMultitouchDriver(DeviceProfile const& profile) :
+  m_profile(profile),
+  m_device(),
+  m_contacts()
+{
+}
+
+template<typename Layout>
+UHIDMultitouchDriver<Layout>::~UHIDMultitouchDriver()
+{
+}
+
+template<typename Layout>
+void
+UHIDMultitouchDriver<Layout>::init()
+{
+  m_device = std::make_unique<UHIDDevice>("uDraw Touchpad Driver (uhid)",
+                                          m_profile.vendor_id, m_profile.product_id,
+                                          make_report_descriptor());
+}
+
+template<typename Layout>
+void
+UHIDMultitouchDriver<Layout>::receive_data(uint8_t const* data, size_t size)
+{
+  BasicUDrawDecoder<Layout> decoder(data, size);
+
+  TouchContact contacts[2];
+  int const num_contacts = touch_contacts(decoder, contacts);
+
+  // keep the identifier of a contact stable while it moves, so that a
+  // finger doesn't jump when the other one is lifted or added
+  int ids[2] = { 0, 1 };
+  if (num_contacts == 1) {
+    if (m_contacts[1].active &&
+        (!m_contacts[0].active ||
+         distance2(contacts[0].x, contacts[0].y, m_contacts[1].x, m_contacts[1].y) <
+         distance2(contacts[0].x, contacts[0].y, m_contacts[0].x, m_contacts[0].y)))
+    {
+      ids[0] = 1;
+    }
+  } else if (num_contacts == 2 && m_contacts[0].active && m_contacts[1].active) {
+    int const cost_keep =
+      distance2(contacts[0].x, contacts[0].y, m_contacts[0].x, m_contacts[0].y) +
+      distance2(contacts[1].x, contacts[1].y, m_contacts[1].x, m_contacts[1].y);
+    int const cost_swap =
+      distance2(contacts[1].x, contacts[1].y, m_contacts[0].x, m_contacts[0].y) +
+      distance2(contacts[0].x, contacts[0].y, m_contacts[1].x, m_contacts[1].y);
+    if (cost_swap < cost_keep) {
+      std::swap(ids[0], ids[1]);
+    }
+  }
+
+  for (Contact& contact : m_contacts) {
+    contact.active = false;
+  }
+
+  // the contact count tells hid-multitouch how many of the fingers are
+  // valid, the active ones come first
+  uint8_t report[3 + 2 * FINGER_SIZE] = {};
+  report[0] = REPORT_ID;
+  for (int i = 0; i < num_contacts; ++i) {
+    m_contacts[ids[i]] = Contact{true, contacts[i].x, contacts[i].y};
+
+    uint8_t* const finger = report + 1 + i * FINGER_SIZE;
+    finger[0] = 0x01;
+    finger[1] = static_cast<uint8_t>(ids[i]);
+    finger[2] = static_cast<uint8_t>(contacts[i].x & 0xff);
+    finger[3] = static_cast<uint8_t>(contacts[i].x >> 8);
+    finger[4] = static_cast<uint8_t>(contacts[i].y & 0xff);
+    finger[5] = static_cast<uint8_t>(contacts[i].y >> 8);
+  }
+  report[1 + 2 * FINGER_SIZE] = static_cast<uint8_t>(num_contacts);
+  report[2 + 2 * FINGER_SIZE] = static_cast<uint8_t>(
+    ((decoder.square() || decoder.right()) ? 0x01 : 0) |
+    ((decoder.circle() || decoder.left()) ? 0x02 : 0) |
+    ((decoder.triangle() || decoder.up()) ? 0x04 : 0));
+
+  UDRAW_TRACE_SCOPE("sync");
+  m_device->send_input(report, sizeof(report));
+}
+
+#define INSTANTIATE(Layout) template class UHIDMultitouchDriver<Layout>;
+UDRAW_FOR_EACH_LAYOUT(INSTANTIATE)
+#undef INSTANTIATE
+
+} // namespace udraw
+
+/* EOF */
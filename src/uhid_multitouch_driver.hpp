@@ -0,0 +1,68 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_UHID_MULTITOUCH_DRIVER_HPP
+#define HEADER_UDRAW_UHID_MULTITOUCH_DRIVER_HPP
+
+#include <array>
+#include <memory>
+
+#include "driver.hpp"
+#include "touch_contacts.hpp"
+
+namespace udraw {
+
+struct DeviceProfile;
+class UHIDDevice;
+
+/** Presents the surface as a HID touchpad with two contacts through
+    /dev/uhid, handled by the kernel's hid-multitouch */
+template<typename Layout>
+class UHIDMultitouchDriver : public Driver
+{
+public:
+  UHIDMultitouchDriver(DeviceProfile const& profile);
+  ~UHIDMultitouchDriver() override;
+
+  void init() override;
+  void receive_data(uint8_t const* data, size_t size) override;
+
+private:
+  struct Contact
+  {
+    bool active;
+    int x;
+    int y;
+  };
+
+private:
+  DeviceProfile const& m_profile;
+  std::unique_ptr<UHIDDevice> m_device;
+
+  /** indexed by contact identifier */
+  std::array<Contact, 2> m_contacts;
+
+public:
+  UHIDMultitouchDriver(const UHIDMultitouchDriver&) = delete;
+  UHIDMultitouchDriver& operator=(const UHIDMultitouchDriver&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
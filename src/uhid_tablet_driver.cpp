@@ -0,0 +1,174 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "uhid_tablet_driver.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "device_profile.hpp"
+#include "trace.hpp"
+#include "touch_contacts.hpp"
+#include "tuning_store.hpp"
+#include "udraw_decoder.hpp"
+#include "uhid_device.hpp"
+
+namespace udraw {
+
+namespace {
+
+uint8_t const REPORT_ID = 1;
+
+/** Append a short item, the value is signed and gets the smallest
+    size that holds it */
+void add_item(std::vector<uint8_t>& desc, uint8_t tag, int value)
+{
+  if (value >= -128 && value <= 127) {
+    desc.insert(desc.end(), { static_cast<uint8_t>(tag | 1), static_cast<uint8_t>(value) });
+  } else if (value >= -32768 && value <= 32767) {
+    desc.insert(desc.end(), { static_cast<uint8_t>(tag | 2),
+                              static_cast<uint8_t>(value & 0xff), static_cast<uint8_t>((value >> 8) & 0xff) });
+  } else {
+    desc.insert(desc.end(), { static_cast<uint8_t>(tag | 3),
+                              static_cast<uint8_t>(value & 0xff), static_cast<uint8_t>((value >> 8) & 0xff),
+                              static_cast<uint8_t>((value >> 16) & 0xff), static_cast<uint8_t>((value >> 24) & 0xff) });
+  }
+}
+
+uint8_t const LOGICAL_MAXIMUM = 0x24;
+uint8_t const PHYSICAL_MAXIMUM = 0x44;
+
+/** units per millimeter, the same resolution as TabletDriver */
+int const RESOLUTION = 12;
+
+/** pen with tip switch, in range, x, y and pressure, the ranges are
+    those of the decoded values */
+template<typename Layout>
+std::vector<uint8_t> make_report_descriptor()
+{
+  std::vector<uint8_t> desc = {
+    0x05, 0x0d,        // Usage Page (Digitizers)
+    0x09, 0x02,        // Usage (Pen)
+    0xa1, 0x01,        // Collection (Application)
+    0x85, REPORT_ID,   //   Report ID
+    0x09, 0x20,        //   Usage (Stylus)
+    0xa1, 0x00,        //   Collection (Physical)
+    0x09, 0x42,        //     Usage (Tip Switch)
+    0x09, 0x32,        //     Usage (In Range)
+    0x15, 0x00,        //     Logical Minimum (0)
+    0x25, 0x01,        //     Logical Maximum (1)
+    0x75, 0x01,        //     Report Size (1)
+    0x95, 0x02,        //     Report Count (2)
+    0x81, 0x02,        //     Input (Data,Var,Abs)
+    0x95, 0x06,        //     Report Count (6)
+    0x81, 0x03,        //     Input (Const,Var,Abs)
+    0x05, 0x01,        //     Usage Page (Generic Desktop)
+    0x09, 0x30,        //     Usage (X)
+  };
+  add_item(desc, LOGICAL_MAXIMUM, TOUCH_SURFACE_WIDTH);
+  desc.insert(desc.end(), {
+    0x35, 0x00,        //     Physical Minimum (0)
+  });
+  add_item(desc, PHYSICAL_MAXIMUM, TOUCH_SURFACE_WIDTH / RESOLUTION);
+  desc.insert(desc.end(), {
+    0x65, 0x11,        //     Unit (Centimeter)
+    0x55, 0x0f,        //     Unit Exponent (-1)
+    0x75, 0x10,        //     Report Size (16)
+    0x95, 0x01,        //     Report Count (1)
+    0x81, 0x02,        //     Input (Data,Var,Abs)
+    0x09, 0x31,        //     Usage (Y)
+  });
+  add_item(desc, LOGICAL_MAXIMUM, TOUCH_SURFACE_HEIGHT);
+  add_item(desc, PHYSICAL_MAXIMUM, TOUCH_SURFACE_HEIGHT / RESOLUTION);
+  desc.insert(desc.end(), {
+    0x81, 0x02,        //     Input (Data,Var,Abs)
+    0x05, 0x0d,        //     Usage Page (Digitizers)
+    0x09, 0x30,        //     Usage (Tip Pressure)
+  });
+  add_item(desc, LOGICAL_MAXIMUM, BasicUDrawDecoder<Layout>::MAX_PRESSURE);
+  desc.insert(desc.end(), {
+    0x45, 0x00,        //     Physical Maximum (0)
+    0x65, 0x00,        //     Unit (None)
+    0x55, 0x00,        //     Unit Exponent (0)
+    0x81, 0x02,        //     Input (Data,Var,Abs)
+    0xc0,              //   End Collection
+    0xc0,              // End Collection
+  });
+  return desc;
+}
+
+} // namespace
+
+template<typename Layout>
+UHIDTabletDriver<Layout>::UHIDTabletDriver(TuningStore const& tuning, DeviceProfile const& profile) :
+  m_tuning(tuning),
+  m_profile(profile),
+  m_device(),
+  m_x(0),
+  m_y(0)
+{
+}
+
+template<typename Layout>
+UHIDTabletDriver<Layout>::~UHIDTabletDriver()
+{
+}
+
+template<typename Layout>
+void
+UHIDTabletDriver<Layout>::init()
+{
+  m_device = std::make_unique<UHIDDevice>("THQ uDraw Game Tablet for PS3 Pen",
+                                          m_profile.vendor_id, m_profile.product_id,
+                                          make_report_descriptor<Layout>());
+}
+
+template<typename Layout>
+void
+UHIDTabletDriver<Layout>::receive_data(uint8_t const* data, size_t size)
+{
+  BasicUDrawDecoder<Layout> decoder(data, size);
+
+  bool const in_range = decoder.mode() == UDrawDecoderBase::Mode::PEN;
+  int pressure = 0;
+  if (in_range) {
+    // keep the last position when the pen leaves, so it doesn't jump
+    m_x = std::clamp(decoder.x(), 0, TOUCH_SURFACE_WIDTH);
+    m_y = std::clamp(decoder.y(), 0, TOUCH_SURFACE_HEIGHT);
+    pressure = std::clamp(decoder.pressure(), 0, decoder.max_pressure());
+  }
+  bool const tip = in_range && pressure > m_tuning.get().pressure_threshold;
+
+  uint8_t const report[] = {
+    REPORT_ID,
+    static_cast<uint8_t>((tip ? 0x01 : 0) | (in_range ? 0x02 : 0)),
+    static_cast<uint8_t>(m_x & 0xff), static_cast<uint8_t>(m_x >> 8),
+    static_cast<uint8_t>(m_y & 0xff), static_cast<uint8_t>(m_y >> 8),
+    static_cast<uint8_t>(pressure & 0xff), static_cast<uint8_t>(pressure >> 8),
+  };
+
+  UDRAW_TRACE_SCOPE("sync");
+  m_device->send_input(report, sizeof(report));
+}
+
+#define INSTANTIATE(Layout) template class UHIDTabletDriver<Layout>;
+UDRAW_FOR_EACH_LAYOUT(INSTANTIATE)
+#undef INSTANTIATE
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,59 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_UHID_TABLET_DRIVER_HPP
+#define HEADER_UDRAW_UHID_TABLET_DRIVER_HPP
+
+#include <memory>
+
+#include "driver.hpp"
+
+namespace udraw {
+
+struct DeviceProfile;
+class TuningStore;
+class UHIDDevice;
+
+/** Presents the pen as a HID digitizer through /dev/uhid, the kernel's
+    hid-input turns it into a tablet for libinput */
+template<typename Layout>
+class UHIDTabletDriver : public Driver
+{
+public:
+  UHIDTabletDriver(TuningStore const& tuning, DeviceProfile const& profile);
+  ~UHIDTabletDriver() override;
+
+  void init() override;
+  void receive_data(uint8_t const* data, size_t size) override;
+
+private:
+  TuningStore const& m_tuning;
+  DeviceProfile const& m_profile;
+  std::unique_ptr<UHIDDevice> m_device;
+  int m_x;
+  int m_y;
+
+public:
+  UHIDTabletDriver(const UHIDTabletDriver&) = delete;
+  UHIDTabletDriver& operator=(const UHIDTabletDriver&) = delete;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
@@ -16,14 +16,33 @@
 
 #include "usb_device.hpp"
 
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
 #include <ostream>
 #include <sstream>
+#include <stdexcept>
+#include <vector>
 
 #include <fmt/format.h>
 #include <logmich/log.hpp>
 
+#include "async_log.hpp"
+#include "trace.hpp"
+
 namespace udraw {
 
+namespace {
+
+void LIBUSB_CALL on_transfer_done(libusb_transfer* transfer)
+{
+  *static_cast<int*>(transfer->user_data) = 1;
+}
+
+} // namespace
+
 USBDevice::USBDevice(libusb_context* ctx, uint16_t vendor_id, uint16_t product_id) :
   m_ctx(ctx),
   m_handle(nullptr)
@@ -89,16 +108,18 @@ USBDevice::set_configuration(int configuration)
 }
 
 size_t
-USBDevice::read(int endpoint, uint8_t* data, int len)
+USBDevice::read(int endpoint, uint8_t* data, int len, unsigned int timeout_ms)
 {
   int transfered;
   int const err = libusb_interrupt_transfer(m_handle,
                                             static_cast<unsigned char>(endpoint) | LIBUSB_ENDPOINT_IN,
                                             data, len,
                                             &transfered,
-                                            0);
+                                            timeout_ms);
 
-  if (err != LIBUSB_SUCCESS) {
+  if (err == LIBUSB_ERROR_TIMEOUT) {
+    return 0;
+  } else if (err != LIBUSB_SUCCESS) {
     throw std::runtime_error(fmt::format("USBDevice::read(): {}", libusb_strerror(err)));
   }
 
@@ -193,24 +214,120 @@ USBDevice::print_info(std::ostream& out)
 }
 
 void
-USBDevice::listen(int endpoint, std::function<void (uint8_t* data, size_t)> callback)
+USBDevice::listen(int endpoint, DataCallback callback, WakeupCallback wakeup_callback,
+                  void* userdata, std::atomic<bool> const& quit, int wakeup_fd)
 {
+  // libusb's file descriptors are polled together with \a wakeup_fd,
+  // so signals are noticed while the device sleeps without waking up
+  // periodically
+  std::vector<pollfd> fds;
+  {
+    libusb_pollfd const** usb_fds = libusb_get_pollfds(m_ctx);
+    if (!usb_fds) {
+      throw std::runtime_error("libusb_get_pollfds() failed");
+    }
+    for (libusb_pollfd const** it = usb_fds; *it; ++it) {
+      fds.push_back(pollfd{ (*it)->fd, (*it)->events, 0 });
+    }
+    libusb_free_pollfds(usb_fds);
+  }
+  fds.push_back(pollfd{ wakeup_fd, POLLIN, 0 });
+  pollfd& wakeup = fds.back();
+
+  libusb_transfer* const transfer = libusb_alloc_transfer(0);
+  if (!transfer) {
+    throw std::runtime_error("libusb_alloc_transfer() failed");
+  }
+
+  uint8_t data[1024];
+  int completed = 0;
+  libusb_fill_interrupt_transfer(transfer, m_handle,
+                                 static_cast<unsigned char>(endpoint) | LIBUSB_ENDPOINT_IN,
+                                 data, sizeof(data),
+                                 on_transfer_done,
+                                 &completed, 0);
+
+  bool submitted = false;
   try
   {
-    bool this_quit = false;
     log_debug("Reading from endpoint {}", endpoint);
-    while(!this_quit)
-    {
-      uint8_t data[1024];
-      size_t transfered = read(endpoint, data, sizeof(data));
-      callback(data, transfered);
+
+    int ret = libusb_submit_transfer(transfer);
+    if (ret != LIBUSB_SUCCESS) {
+      throw std::runtime_error(fmt::format("USBDevice::listen(): {}", libusb_strerror(ret)));
     }
+    submitted = true;
 
+    while(!quit.load(std::memory_order_relaxed))
+    {
+      if (completed) {
+        submitted = false;
+        if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+          throw std::runtime_error(fmt::format("USBDevice::listen(): transfer failed with status {}",
+                                               static_cast<int>(transfer->status)));
+        }
+
+        // a bad report must not end the read loop, only USB errors do
+        try {
+          UDRAW_TRACE_SCOPE("usb_report");
+          callback(userdata, data, static_cast<size_t>(transfer->actual_length));
+        } catch(std::exception const& err) {
+          async_log_error("failed to process report: {}", err.what());
+        }
+
+        completed = 0;
+        ret = libusb_submit_transfer(transfer);
+        if (ret != LIBUSB_SUCCESS) {
+          throw std::runtime_error(fmt::format("USBDevice::listen(): {}", libusb_strerror(ret)));
+        }
+        submitted = true;
+        continue;
+      }
+
+      // only needed on platforms without timerfd, on Linux libusb
+      // handles its timeouts through one of the polled fds
+      int timeout = -1;
+      timeval tv;
+      if (!libusb_pollfds_handle_timeouts(m_ctx) && libusb_get_next_timeout(m_ctx, &tv) == 1) {
+        timeout = static_cast<int>(tv.tv_sec * 1000 + tv.tv_usec / 1000);
+      }
+
+      if (poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::runtime_error(fmt::format("poll() failed: {}", strerror(errno)));
+      }
+
+      if (wakeup.revents & POLLIN) {
+        uint64_t value;
+        if (::read(wakeup_fd, &value, sizeof(value)) > 0) {
+          wakeup_callback(userdata);
+        }
+      }
+
+      timeval zero = {};
+      ret = libusb_handle_events_timeout_completed(m_ctx, &zero, &completed);
+      if (ret != LIBUSB_SUCCESS && ret != LIBUSB_ERROR_INTERRUPTED) {
+        throw std::runtime_error(fmt::format("USBDevice::listen(): {}", libusb_strerror(ret)));
+      }
+    }
   }
   catch(std::exception& err)
   {
     log_error("Error: {}", err.what());
   }
+
+  // the transfer must be done before its buffer goes away
+  if (submitted) {
+    libusb_cancel_transfer(transfer);
+    while (!completed) {
+      if (libusb_handle_events_completed(m_ctx, &completed) != LIBUSB_SUCCESS) {
+        break;
+      }
+    }
+  }
+  libusb_free_transfer(transfer);
 }
 
 } // namespace udraw
@@ -17,7 +17,9 @@
 #ifndef HEADER_USB_DEVICE_HPP
 #define HEADER_USB_DEVICE_HPP
 
-#include <functional>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
 
 #include <libusb.h>
@@ -26,6 +28,12 @@ namespace udraw {
 
 class USBDevice
 {
+public:
+  /** Plain function pointer instead of std::function, so that
+      dispatching a report can never allocate */
+  using DataCallback = void (*)(void* userdata, uint8_t const* data, size_t size);
+  using WakeupCallback = void (*)(void* userdata);
+
 public:
   USBDevice(libusb_context* ctx, uint16_t vendor_id, uint16_t product_id);
   ~USBDevice();
@@ -35,7 +43,8 @@ public:
   void claim_interface(int iface);
   void release_interface(int iface);
   void set_configuration(int configuration);
-  size_t read(int endpoint, uint8_t* data, int len);
+  /** Returns 0 when \a timeout_ms expired without data, 0 waits forever */
+  size_t read(int endpoint, uint8_t* data, int len, unsigned int timeout_ms = 0);
   size_t write(int endpoint, uint8_t* data, int len);
 
   /* uint8_t  requesttype
@@ -48,7 +57,13 @@ public:
                   int value, int index,
                   uint8_t* data, int size);
   void print_info(std::ostream& out);
-  void listen(int endpoint, std::function<void (uint8_t* data, size_t)> callback);
+
+  /** Read from \a endpoint until a USB error occurs or \a quit is
+      set. Blocks without a timeout, \a wakeup_callback runs whenever
+      the eventfd \a wakeup_fd got signalled, which is also the only
+      time \a quit is looked at while no reports arrive. */
+  void listen(int endpoint, DataCallback callback, WakeupCallback wakeup_callback,
+              void* userdata, std::atomic<bool> const& quit, int wakeup_fd);
 
 private:
   libusb_context* m_ctx;
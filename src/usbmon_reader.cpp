@@ -0,0 +1,467 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "usbmon_reader.hpp"
+
+#include <string.h>
+
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+
+#include "device_profile.hpp"
+#include "report_format.hpp"
+#include "udraw_decoder.hpp"
+
+namespace udraw {
+
+namespace {
+
+uint8_t const XFER_INTERRUPT = 1;
+uint8_t const XFER_CONTROL = 2;
+
+uint32_t const LINKTYPE_USB_LINUX = 189;
+uint32_t const LINKTYPE_USB_LINUX_MMAPPED = 220;
+
+uint32_t const PCAP_MAGIC_USEC = 0xa1b2c3d4;
+uint32_t const PCAP_MAGIC_NSEC = 0xa1b23c4d;
+uint32_t const PCAPNG_SHB = 0x0a0d0d0a;
+uint32_t const PCAPNG_BYTE_ORDER_MAGIC = 0x1a2b3c4d;
+uint32_t const PCAPNG_IDB = 1;
+uint32_t const PCAPNG_EPB = 6;
+
+uint32_t bswap32(uint32_t v) { return __builtin_bswap32(v); }
+
+uint32_t load32(uint8_t const* p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+int hexdigit(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+/** usbmon text timestamps are (tv_sec % 4096) * 1000000 + tv_usec */
+int64_t const text_timestamp_period = int64_t(4096) * 1000000;
+
+/** Convert a pcapng timestamp in if_tsresol units to nanoseconds */
+int64_t tsresol_to_nsec(uint64_t units, uint8_t tsresol)
+{
+  if (tsresol & 0x80) {
+    __extension__ typedef unsigned __int128 uint128;
+    return static_cast<int64_t>((static_cast<uint128>(units) * 1000000000) >> (tsresol & 0x7f));
+  }
+
+  int64_t value = static_cast<int64_t>(units);
+  for (int i = tsresol; i < 9; ++i) { value *= 10; }
+  for (int i = 9; i < tsresol; ++i) { value /= 10; }
+  return value;
+}
+
+} // namespace
+
+UsbmonReader::UsbmonReader(std::string const& filename) :
+  m_file(filename),
+  m_format(Format::TEXT),
+  m_pos(0),
+  m_swap(false),
+  m_nsec(false),
+  m_linktype(0),
+  m_interfaces(),
+  m_selected(false),
+  m_selected_by_descriptor(false),
+  m_bus(0),
+  m_device(0),
+  m_profile(&default_device_profile()),
+  m_text_data(),
+  m_text_last_usec(-1),
+  m_text_wrap_usec(0)
+{
+  if (m_file.size() >= 24) {
+    uint32_t const magic = load32(m_file.data());
+    if (magic == PCAP_MAGIC_USEC || magic == PCAP_MAGIC_NSEC ||
+        bswap32(magic) == PCAP_MAGIC_USEC || bswap32(magic) == PCAP_MAGIC_NSEC)
+    {
+      m_format = Format::PCAP;
+      m_swap = (bswap32(magic) == PCAP_MAGIC_USEC || bswap32(magic) == PCAP_MAGIC_NSEC);
+      m_nsec = (magic == PCAP_MAGIC_NSEC || bswap32(magic) == PCAP_MAGIC_NSEC);
+      m_linktype = rd32(m_file.data() + 20) & 0xffff;
+      m_pos = 24;
+
+      if (m_linktype != LINKTYPE_USB_LINUX && m_linktype != LINKTYPE_USB_LINUX_MMAPPED) {
+        throw std::runtime_error(fmt::format("{}: not a usbmon capture, link type {}",
+                                             filename, m_linktype));
+      }
+    }
+    else if (magic == PCAPNG_SHB)
+    {
+      m_format = Format::PCAPNG;
+    }
+  }
+}
+
+UsbmonReader::~UsbmonReader()
+{
+}
+
+uint16_t
+UsbmonReader::rd16(uint8_t const* p) const
+{
+  uint16_t v;
+  memcpy(&v, p, sizeof(v));
+  return m_swap ? __builtin_bswap16(v) : v;
+}
+
+uint32_t
+UsbmonReader::rd32(uint8_t const* p) const
+{
+  uint32_t const v = load32(p);
+  return m_swap ? bswap32(v) : v;
+}
+
+bool
+UsbmonReader::next(CaptureRecord& record)
+{
+  Transfer transfer;
+  while (next_transfer(transfer))
+  {
+    if (accept(transfer)) {
+      record.timestamp = transfer.timestamp;
+      record.data = transfer.data;
+      record.size = transfer.size;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+UsbmonReader::next_transfer(Transfer& transfer)
+{
+  switch (m_format)
+  {
+    case Format::PCAP: return next_pcap(transfer);
+    case Format::PCAPNG: return next_pcapng(transfer);
+    case Format::TEXT: return next_text(transfer);
+  }
+  return false;
+}
+
+bool
+UsbmonReader::accept(Transfer const& transfer)
+{
+  if (transfer.event != 'C' || !transfer.in) {
+    return false;
+  }
+
+  // GET_DESCRIPTOR(DEVICE) completion, tells us which device is the tablet
+  if (transfer.xfer_type == XFER_CONTROL && transfer.endpoint == 0 &&
+      transfer.size >= 12 && transfer.data[0] == 18 && transfer.data[1] == 0x01)
+  {
+    uint16_t const vendor_id = static_cast<uint16_t>(transfer.data[8] | (transfer.data[9] << 8));
+    uint16_t const product_id = static_cast<uint16_t>(transfer.data[10] | (transfer.data[11] << 8));
+    DeviceProfile const* const profile = find_device_profile(vendor_id, product_id);
+    if (profile &&
+        !(m_selected_by_descriptor && m_bus == transfer.bus && m_device == transfer.device))
+    {
+      log_info("{}: {} is device {}:{:03d}", m_file.filename(), profile->name, transfer.bus, transfer.device);
+      m_selected = true;
+      m_selected_by_descriptor = true;
+      m_bus = transfer.bus;
+      m_device = transfer.device;
+      m_profile = profile;
+    }
+    return false;
+  }
+
+  if (transfer.xfer_type != XFER_INTERRUPT ||
+      transfer.endpoint != m_profile->endpoint ||
+      transfer.status != 0 ||
+      transfer.size == 0)
+  {
+    return false;
+  }
+
+  if (!m_selected)
+  {
+    if (m_profile->format->validate(transfer.data, transfer.size) != UDrawDecoderBase::Error::NONE) {
+      return false;
+    }
+
+    log_info("{}: no device descriptor found, assuming device {}:{:03d} is the uDraw tablet",
+             m_file.filename(), transfer.bus, transfer.device);
+    m_selected = true;
+    m_bus = transfer.bus;
+    m_device = transfer.device;
+  }
+
+  return transfer.bus == m_bus && transfer.device == m_device;
+}
+
+bool
+UsbmonReader::parse_packet(uint32_t linktype, int64_t timestamp,
+                           uint8_t const* data, size_t size, Transfer& transfer) const
+{
+  size_t const header_size = (linktype == LINKTYPE_USB_LINUX_MMAPPED) ? 64 : 48;
+  if ((linktype != LINKTYPE_USB_LINUX && linktype != LINKTYPE_USB_LINUX_MMAPPED) ||
+      size < header_size)
+  {
+    return false;
+  }
+
+  transfer.event = static_cast<char>(data[8]);
+  transfer.xfer_type = data[9];
+  transfer.in = (data[10] & 0x80) != 0;
+  transfer.endpoint = data[10] & 0x7f;
+  transfer.device = data[11];
+  transfer.bus = rd16(data + 12);
+  transfer.status = static_cast<int32_t>(rd32(data + 28));
+  transfer.timestamp = timestamp;
+  transfer.data = data + header_size;
+  transfer.size = std::min<size_t>(rd32(data + 36), size - header_size);
+
+  return true;
+}
+
+bool
+UsbmonReader::next_pcap(Transfer& transfer)
+{
+  uint8_t const* const data = m_file.data();
+  size_t const file_size = m_file.size();
+
+  while (file_size - m_pos >= 16)
+  {
+    uint8_t const* const rec = data + m_pos;
+    uint32_t const ts_sec = rd32(rec);
+    uint32_t const ts_frac = rd32(rec + 4);
+    uint32_t const incl_len = rd32(rec + 8);
+
+    if (file_size - m_pos - 16 < incl_len) {
+      log_warn("{}: truncated packet at offset {}", m_file.filename(), m_pos);
+      m_pos = file_size;
+      return false;
+    }
+
+    m_pos += 16 + incl_len;
+
+    int64_t const timestamp = int64_t(ts_sec) * 1000000000 + (m_nsec ? ts_frac : int64_t(ts_frac) * 1000);
+    if (parse_packet(m_linktype, timestamp, rec + 16, incl_len, transfer)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool
+UsbmonReader::next_pcapng(Transfer& transfer)
+{
+  uint8_t const* const data = m_file.data();
+  size_t const file_size = m_file.size();
+
+  while (file_size - m_pos >= 12)
+  {
+    uint8_t const* const block = data + m_pos;
+
+    if (load32(block) == PCAPNG_SHB) {
+      // the section header decides the byte order of everything after it
+      uint32_t const bom = load32(block + 8);
+      if (bom == PCAPNG_BYTE_ORDER_MAGIC) {
+        m_swap = false;
+      } else if (bswap32(bom) == PCAPNG_BYTE_ORDER_MAGIC) {
+        m_swap = true;
+      } else {
+        throw std::runtime_error(fmt::format("{}: corrupt pcapng section header", m_file.filename()));
+      }
+      m_interfaces.clear();
+    }
+
+    uint32_t const type = rd32(block);
+    uint32_t const length = rd32(block + 4);
+    if (length < 12 || length > file_size - m_pos) {
+      log_warn("{}: truncated block at offset {}", m_file.filename(), m_pos);
+      m_pos = file_size;
+      return false;
+    }
+    m_pos += length;
+
+    uint8_t const* const body = block + 8;
+    size_t const body_size = length - 12;
+
+    if (type == PCAPNG_IDB && body_size >= 8)
+    {
+      Interface iface{rd16(body), 6};
+
+      // walk the options for if_tsresol
+      size_t opt = 8;
+      while (body_size - opt >= 4) {
+        uint16_t const code = rd16(body + opt);
+        uint16_t const len = rd16(body + opt + 2);
+        if (code == 0 || body_size - opt - 4 < len) {
+          break;
+        }
+        if (code == 9 && len >= 1) {
+          iface.tsresol = body[opt + 4];
+        }
+        opt += 4 + ((len + 3u) & ~3u);
+      }
+
+      m_interfaces.push_back(iface);
+    }
+    else if (type == PCAPNG_EPB && body_size >= 20)
+    {
+      uint32_t const iface_id = rd32(body);
+      uint64_t const units = (uint64_t(rd32(body + 4)) << 32) | rd32(body + 8);
+      uint32_t const caplen = rd32(body + 12);
+
+      if (iface_id >= m_interfaces.size() || body_size - 20 < caplen) {
+        continue;
+      }
+
+      Interface const& iface = m_interfaces[iface_id];
+      if (parse_packet(iface.linktype, tsresol_to_nsec(units, iface.tsresol),
+                       body + 20, caplen, transfer)) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+bool
+UsbmonReader::next_text(Transfer& transfer)
+{
+  char const* const begin = reinterpret_cast<char const*>(m_file.data());
+  size_t const file_size = m_file.size();
+
+  while (m_pos < file_size)
+  {
+    char const* line = begin + m_pos;
+    char const* const line_end = static_cast<char const*>(memchr(line, '\n', file_size - m_pos));
+    char const* const end = line_end ? line_end : begin + file_size;
+    m_pos = static_cast<size_t>(end - begin) + 1;
+
+    // split into whitespace separated words
+    char const* words[48];
+    size_t lengths[48];
+    size_t num_words = 0;
+    for (char const* p = line; p < end && num_words < 48;) {
+      while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) { ++p; }
+      if (p == end) { break; }
+      words[num_words] = p;
+      while (p < end && *p != ' ' && *p != '\t' && *p != '\r') { ++p; }
+      lengths[num_words] = static_cast<size_t>(p - words[num_words]);
+      num_words += 1;
+    }
+
+    // tag timestamp event address status length '=' data...
+    if (num_words < 6 || lengths[2] != 1 || lengths[3] < 6) {
+      continue;
+    }
+
+    transfer.event = words[2][0];
+
+    // address: "Ii:BUS:DEV:EP" (1u format) or "Ii:DEV:EP" (0t format)
+    char const* addr = words[3];
+    size_t const addr_len = lengths[3];
+    switch (addr[0]) {
+      case 'Z': transfer.xfer_type = 0; break;
+      case 'I': transfer.xfer_type = XFER_INTERRUPT; break;
+      case 'C': transfer.xfer_type = XFER_CONTROL; break;
+      case 'B': transfer.xfer_type = 3; break;
+      default: continue;
+    }
+    transfer.in = (addr[1] == 'i');
+
+    unsigned fields[3] = {};
+    size_t num_fields = 0;
+    for (size_t i = 2; i < addr_len && num_fields <= 3; ++i) {
+      if (addr[i] == ':') {
+        num_fields += 1;
+      } else if (num_fields >= 1 && num_fields <= 3 && addr[i] >= '0' && addr[i] <= '9') {
+        fields[num_fields - 1] = fields[num_fields - 1] * 10 + static_cast<unsigned>(addr[i] - '0');
+      }
+    }
+    if (num_fields == 3) {
+      transfer.bus = static_cast<uint16_t>(fields[0]);
+      transfer.device = static_cast<uint8_t>(fields[1]);
+      transfer.endpoint = static_cast<uint8_t>(fields[2]);
+    } else if (num_fields == 2) {
+      transfer.bus = 0;
+      transfer.device = static_cast<uint8_t>(fields[0]);
+      transfer.endpoint = static_cast<uint8_t>(fields[1]);
+    } else {
+      continue;
+    }
+
+    int64_t timestamp_usec = 0;
+    for (size_t i = 0; i < lengths[1]; ++i) {
+      timestamp_usec = timestamp_usec * 10 + (words[1][i] - '0');
+    }
+    // the kernel prints the seconds modulo 4096, a big step backwards
+    // is the wrap around, small ones are left alone
+    if (m_text_last_usec >= 0 && timestamp_usec < m_text_last_usec - text_timestamp_period / 2) {
+      m_text_wrap_usec += text_timestamp_period;
+    }
+    m_text_last_usec = timestamp_usec;
+    transfer.timestamp = (m_text_wrap_usec + timestamp_usec) * 1000;
+
+    // status, optionally followed by ":interval" or ":start_frame..."
+    transfer.status = static_cast<int32_t>(strtol(words[4], nullptr, 10));
+
+    // find the data tag, everything after '=' is hex data in groups
+    size_t data_word = 0;
+    for (size_t i = 5; i < num_words; ++i) {
+      if (lengths[i] == 1 && words[i][0] == '=') {
+        data_word = i + 1;
+        break;
+      }
+    }
+
+    size_t size = 0;
+    if (data_word != 0) {
+      for (size_t i = data_word; i < num_words; ++i) {
+        for (size_t j = 0; j + 1 < lengths[i] && size < sizeof(m_text_data); j += 2) {
+          int const hi = hexdigit(words[i][j]);
+          int const lo = hexdigit(words[i][j + 1]);
+          if (hi < 0 || lo < 0) {
+            break;
+          }
+          m_text_data[size++] = static_cast<uint8_t>((hi << 4) | lo);
+        }
+      }
+    }
+
+    transfer.data = m_text_data;
+    transfer.size = size;
+    return true;
+  }
+
+  return false;
+}
+
+} // namespace udraw
+
+/* EOF */
@@ -0,0 +1,113 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HEADER_UDRAW_USBMON_READER_HPP
+#define HEADER_UDRAW_USBMON_READER_HPP
+
+#include <vector>
+
+#include "fwd.hpp"
+#include "mapped_file.hpp"
+#include "report_reader.hpp"
+
+namespace udraw {
+
+/** Extracts uDraw reports from Linux usbmon captures, either the text
+    interface (/sys/kernel/debug/usb/usbmon/Nu) or pcap/pcapng files as
+    written by tcpdump or Wireshark on usbmonN.
+
+    Only completed interrupt-IN transfers from the tablet's endpoint
+    are returned. The tablet is found through its device descriptor,
+    any device in the profile table, if the capture includes the
+    enumeration, otherwise the first device sending valid PS3 tablet
+    reports on endpoint 3 is used. */
+class UsbmonReader : public ReportReader
+{
+public:
+  UsbmonReader(std::string const& filename);
+  ~UsbmonReader() override;
+
+  bool next(CaptureRecord& record) override;
+
+private:
+  enum class Format { TEXT, PCAP, PCAPNG };
+
+  struct Transfer
+  {
+    char event;         // 'S'ubmit, 'C'omplete or 'E'rror
+    uint8_t xfer_type;  // 0: iso, 1: interrupt, 2: control, 3: bulk
+    bool in;
+    uint8_t endpoint;
+    uint16_t bus;
+    uint8_t device;
+    int32_t status;
+    int64_t timestamp;
+    uint8_t const* data;
+    size_t size;
+  };
+
+  struct Interface
+  {
+    uint32_t linktype;
+    /** timestamp resolution as pcapng if_tsresol */
+    uint8_t tsresol;
+  };
+
+  bool next_transfer(Transfer& transfer);
+  bool next_text(Transfer& transfer);
+  bool next_pcap(Transfer& transfer);
+  bool next_pcapng(Transfer& transfer);
+  bool parse_packet(uint32_t linktype, int64_t timestamp,
+                    uint8_t const* data, size_t size, Transfer& transfer) const;
+  bool accept(Transfer const& transfer);
+
+  uint16_t rd16(uint8_t const* p) const;
+  uint32_t rd32(uint8_t const* p) const;
+
+private:
+  MappedFile m_file;
+  Format m_format;
+  size_t m_pos;
+  bool m_swap;
+
+  // pcap
+  bool m_nsec;
+  uint32_t m_linktype;
+
+  // pcapng
+  std::vector<Interface> m_interfaces;
+
+  bool m_selected;
+  bool m_selected_by_descriptor;
+  uint16_t m_bus;
+  uint8_t m_device;
+  /** of the selected device, the PS3 tablet until one is selected by
+      its descriptor */
+  DeviceProfile const* m_profile;
+
+  // text
+  uint8_t m_text_data[256];
+  /** the text timestamps wrap around every 4096 seconds */
+  int64_t m_text_last_usec;
+  int64_t m_text_wrap_usec;
+};
+
+} // namespace udraw
+
+#endif
+
+/* EOF */
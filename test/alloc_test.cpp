@@ -0,0 +1,264 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/*
+  Replays generated reports, with a broken one mixed in every now and
+  then, through UDrawDriver in the mode given on the command line and
+  fails when the input thread allocates anything between receiving a
+  report and asking for the next one. Setup before the first report is
+  not counted. Exits with 77, which ctest reports as skipped, when the
+  mode can't be set up, e.g. without access to /dev/uinput or /dev/uhid.
+*/
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <fmt/format.h>
+#include <uinpp/multi_device.hpp>
+
+#include "async_log.hpp"
+#include "device_profile.hpp"
+#include "options.hpp"
+#include "report_generator.hpp"
+#include "udraw_decoder.hpp"
+#include "udraw_driver.hpp"
+
+namespace {
+
+thread_local bool t_counting = false;
+thread_local uint64_t t_allocations = 0;
+thread_local size_t t_first_size = 0;
+
+void* allocate(size_t size, size_t alignment)
+{
+  if (t_counting) {
+    if (t_allocations == 0) {
+      t_first_size = size;
+    }
+    t_allocations += 1;
+  }
+
+  void* ptr = nullptr;
+  if (posix_memalign(&ptr, std::max(alignment, sizeof(void*)), size ? size : 1) != 0) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+} // namespace
+
+void* operator new(size_t size) { return allocate(size, alignof(std::max_align_t)); }
+void* operator new[](size_t size) { return allocate(size, alignof(std::max_align_t)); }
+void* operator new(size_t size, std::align_val_t align) { return allocate(size, static_cast<size_t>(align)); }
+void* operator new[](size_t size, std::align_val_t align) { return allocate(size, static_cast<size_t>(align)); }
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { free(ptr); }
+
+namespace udraw {
+
+namespace {
+
+uint64_t const report_count = 20000;
+
+/** Counts allocations from handing out a report until the driver asks
+    for the next one, which covers all of UDrawDriver::on_data() */
+class CheckedReader : public ReportReader
+{
+public:
+  CheckedReader() :
+    m_generator(ReportGenerator::Pattern::MIXED, 0.0, report_count, 1),
+    m_reports(0),
+    m_data()
+  {}
+
+  bool next(CaptureRecord& record) override
+  {
+    t_counting = false;
+
+    if (!m_generator.next(record)) {
+      return false;
+    }
+    m_reports += 1;
+
+    // take the reject path and the flight recorder dump with it
+    if (m_reports % 97 == 0) {
+      record.size = Ps3Layout::HEADER;
+    } else if (m_reports % 89 == 0) {
+      memcpy(m_data, record.data, sizeof(m_data));
+      m_data[Ps3Layout::HEADER] ^= 0xff;
+      record.data = m_data;
+    } else if (m_reports % 83 == 0) {
+      memcpy(m_data, record.data, sizeof(m_data));
+      m_data[Ps3Layout::TRAILER] ^= 0xff;
+      record.data = m_data;
+    }
+
+    t_counting = true;
+    return true;
+  }
+
+  uint64_t reports() const { return m_reports; }
+
+private:
+  ReportGenerator m_generator;
+  uint64_t m_reports;
+  uint8_t m_data[UDrawDecoder::REPORT_SIZE];
+};
+
+Options options_from_mode(std::string const& mode, char const* plugin)
+{
+  Options opts;
+
+  if (mode == "test") {
+    opts.mode = Options::Mode::TEST;
+  } else if (mode == "raw") {
+    opts.mode = Options::Mode::RAW;
+  } else if (mode == "gamepad") {
+    opts.mode = Options::Mode::GAMEPAD;
+  } else if (mode == "keyboard") {
+    opts.mode = Options::Mode::KEYBOARD;
+  } else if (mode == "touchpad") {
+    opts.mode = Options::Mode::TOUCHPAD;
+  } else if (mode == "multitouch") {
+    opts.mode = Options::Mode::MULTITOUCH;
+  } else if (mode == "multitouch-uhid") {
+    opts.mode = Options::Mode::MULTITOUCH;
+    opts.uhid = true;
+  } else if (mode == "tablet") {
+    opts.mode = Options::Mode::TABLET;
+  } else if (mode == "tablet-resample") {
+    opts.mode = Options::Mode::TABLET;
+    opts.resample_rate = 240.0;
+  } else if (mode == "tablet-uhid") {
+    opts.mode = Options::Mode::TABLET;
+    opts.uhid = true;
+  } else if (mode == "plugin") {
+    if (!plugin) {
+      throw std::runtime_error("plugin mode needs the path of a plugin");
+    }
+    opts.mode = Options::Mode::PLUGIN;
+    opts.plugins.emplace_back(plugin);
+  } else {
+    throw std::runtime_error(fmt::format("unknown mode: {}", mode));
+  }
+
+  opts.perf_counters = true;
+  return opts;
+}
+
+void remove_directory(std::string const& path)
+{
+  if (DIR* dir = opendir(path.c_str())) {
+    while (dirent* entry = readdir(dir)) {
+      if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+        unlink((path + "/" + entry->d_name).c_str());
+      }
+    }
+    closedir(dir);
+  }
+  rmdir(path.c_str());
+}
+
+int run(std::string const& mode, char const* plugin)
+{
+  Options opts = options_from_mode(mode, plugin);
+
+  char dump_dir[] = "/tmp/udraw-alloc-test-XXXXXX";
+  if (!mkdtemp(dump_dir)) {
+    throw std::runtime_error(fmt::format("mkdtemp: {}", strerror(errno)));
+  }
+  opts.flight_recorder_dir = dump_dir;
+
+  // --test and --raw print every report
+  int const null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+  if (null_fd >= 0) {
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+  }
+
+  async_log::start();
+
+  CheckedReader reader;
+  std::string skip_reason;
+  try {
+    uinpp::MultiDevice evdev;
+    UDrawDriver driver(evdev, opts, default_device_profile());
+    driver.replay(reader);
+  } catch (std::exception const& err) {
+    t_counting = false;
+    if (reader.reports() != 0) {
+      async_log::stop();
+      remove_directory(dump_dir);
+      throw;
+    }
+    skip_reason = err.what();
+  }
+
+  async_log::stop();
+  remove_directory(dump_dir);
+
+  if (!skip_reason.empty()) {
+    fmt::print(stderr, "{}: skipped, {}\n", mode, skip_reason);
+    return 77;
+  }
+
+  if (t_allocations != 0) {
+    fmt::print(stderr, "{}: {} allocations in {} reports, the first of {} bytes\n",
+               mode, t_allocations, reader.reports(), t_first_size);
+    return EXIT_FAILURE;
+  }
+
+  fmt::print(stderr, "{}: no allocations in {} reports\n", mode, reader.reports());
+  return EXIT_SUCCESS;
+}
+
+} // namespace
+
+} // namespace udraw
+
+int main(int argc, char** argv) try
+{
+  if (argc < 2) {
+    fmt::print(stderr, "Usage: {} MODE [PLUGIN]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  return udraw::run(argv[1], argc > 2 ? argv[2] : nullptr);
+} catch (std::exception const& err) {
+  fmt::print(stderr, "exception: {}\n", err.what());
+  return EXIT_FAILURE;
+}
+
+/* EOF */
@@ -0,0 +1,122 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/*
+  Feeds a pen moving at constant speed, reported every 10 ms plus up to
+  20 ms of jitter, through PenResampler at several timer rates and
+  phases. Fails when a sample is more than one period old or doesn't
+  show the pen where it was at the sample's time.
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "pen_resampler.hpp"
+
+namespace udraw {
+
+namespace {
+
+using clock = PenResampler::clock;
+
+/** position along the stroke, 2 units per ms in x and -1 in y */
+int pen_x(int64_t t) { return 100 + static_cast<int>(t / 500000); }
+int pen_y(int64_t t) { return 5000 - static_cast<int>(t / 1000000); }
+
+/** report times in nanoseconds, reproducible, on whole milliseconds so
+    that the reported positions are exact */
+std::vector<int64_t> report_times(uint32_t seed)
+{
+  std::vector<int64_t> times;
+  int64_t t = 0;
+  while (t < 2000000000) {
+    times.push_back(t);
+    seed = seed * 1664525u + 1013904223u;
+    t += (10 + static_cast<int64_t>(seed >> 8) % 21) * 1000000;
+  }
+  return times;
+}
+
+int run(double rate, int64_t phase, uint32_t seed)
+{
+  auto const period = std::chrono::nanoseconds(static_cast<int64_t>(1e9 / rate));
+  std::vector<int64_t> const reports = report_times(seed);
+  clock::time_point const start{};
+
+  PenResampler resampler(period);
+  resampler.reset(PenResampler::Sample{start, pen_x(0), pen_y(0), 50});
+
+  int failures = 0;
+  size_t next_report = 1;
+  for (int64_t tick = phase; tick < reports.back(); tick += period.count())
+  {
+    while (next_report < reports.size() && reports[next_report] <= tick) {
+      int64_t const t = reports[next_report];
+      resampler.add(PenResampler::Sample{start + std::chrono::nanoseconds(t), pen_x(t), pen_y(t), 50});
+      next_report += 1;
+    }
+
+    // extrapolating needs two reports
+    if (next_report < 2) {
+      continue;
+    }
+
+    clock::time_point const now = start + std::chrono::nanoseconds(tick);
+    PenResampler::Sample const sample = resampler.sample(now);
+    int64_t const t = std::chrono::duration_cast<std::chrono::nanoseconds>(sample.time - start).count();
+
+    if (now - sample.time > period) {
+      fmt::print(stderr, "{} Hz: sample at {} ns is {} ns old, more than one period\n",
+                 rate, tick, tick - t);
+      failures += 1;
+    } else if (std::abs(sample.x - pen_x(t)) > 1 || std::abs(sample.y - pen_y(t)) > 1) {
+      fmt::print(stderr, "{} Hz: sample at {} ns is at {},{} instead of {},{}\n",
+                 rate, tick, sample.x, sample.y, pen_x(t), pen_y(t));
+      failures += 1;
+    }
+  }
+
+  return failures;
+}
+
+} // namespace
+
+} // namespace udraw
+
+int main()
+{
+  int failures = 0;
+  for (double const rate : { 60.0, 240.0, 1000.0 }) {
+    for (int64_t const phase : { 0, 1300000, 2700000 }) {
+      failures += udraw::run(rate, phase, static_cast<uint32_t>(phase + 1));
+    }
+  }
+
+  if (failures != 0) {
+    fmt::print(stderr, "{} samples out of bounds\n", failures);
+    return EXIT_FAILURE;
+  }
+
+  fmt::print(stderr, "all samples within one period\n");
+  return EXIT_SUCCESS;
+}
+
+/* EOF */
@@ -0,0 +1,460 @@
+//  Linux driver for the uDraw graphic tablet
+//  Copyright (C) 2022 Ingo Ruhnke <grumbel@gmail.com>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <string.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+
+#include "capture.hpp"
+#include "capture_analyzer.hpp"
+#include "report_generator.hpp"
+#include "report_reader.hpp"
+#include "sample_batch.hpp"
+#include "shm/sample_ring.hpp"
+#include "sample_export.hpp"
+#include "udraw_decoder.hpp"
+
+namespace udraw {
+namespace {
+
+void print_help(const char* argv0)
+{
+  std::cout << "Usage: " << argv0 << " COMMAND [ARG]...\n"
+            << "Offline tools for uDraw captures\n"
+            << "\n"
+            << "Commands:\n"
+            << "  convert INPUT OUTPUT  convert a usbmon text, pcap or pcapng capture to a capture file\n"
+            << "  analyze FILE...       print report timing and sensor noise statistics\n"
+            << "  export INPUT OUTPUT   decode reports into a columnar file, or CSV if OUTPUT ends in .csv\n"
+            << "  bench [FILE]          compare the batch decoders on FILE or on random reports\n"
+            << "  latency SHM EVDEV [N] measure the time from a report arriving to its evdev\n"
+            << "                        event, needs udraw-driver --shm SHM\n"
+            << "  generate [OPTION]... OUTPUT\n"
+            << "                        write synthetic reports to a capture file\n"
+            << "\n"
+            << "Generate Options:\n"
+            << "  --pattern PATTERN  strokes, toggle, buttons, walk or mixed (default: mixed)\n"
+            << "  --rate HZ          reports per second (default: 100)\n"
+            << "  --count N          number of reports (default: 10000)\n"
+            << "  --seed N           random seed (default: 1)\n"
+            << "\n"
+            << "Options:\n"
+            << "  -h, --help     display this help\n"
+            << "  -v, --verbose  be more verbose\n"
+            << std::endl;
+}
+
+int convert(std::vector<std::string> const& args)
+{
+  if (args.size() != 2) {
+    throw std::runtime_error("convert requires INPUT and OUTPUT");
+  }
+
+  std::unique_ptr<ReportReader> reader = open_report_reader(args[0]);
+  CaptureWriter writer(args[1]);
+
+  size_t count = 0;
+  CaptureRecord record;
+  while (reader->next(record)) {
+    writer.write(record.timestamp, record.data, record.size);
+    count += 1;
+  }
+  writer.close();
+
+  log_info("{}: wrote {} reports", args[1], count);
+  return count == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int analyze(std::vector<std::string> const& files)
+{
+  if (files.empty()) {
+    throw std::runtime_error("analyze requires at least one FILE");
+  }
+
+  std::vector<std::unique_ptr<CaptureAnalyzer>> results(files.size());
+  std::vector<std::exception_ptr> errors(files.size());
+
+  // files are independent, so each worker just takes the next one
+  std::atomic<size_t> next_file = 0;
+  auto worker = [&]{
+    for (size_t i = next_file++; i < files.size(); i = next_file++) {
+      try {
+        auto analyzer = std::make_unique<CaptureAnalyzer>();
+        analyze_file(files[i], *analyzer);
+        results[i] = std::move(analyzer);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+
+  size_t const num_threads = std::min<size_t>(files.size(), std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  CaptureAnalyzer total;
+  int ret = EXIT_SUCCESS;
+  for (size_t i = 0; i < files.size(); ++i)
+  {
+    if (errors[i]) {
+      try {
+        std::rethrow_exception(errors[i]);
+      } catch (std::exception const& err) {
+        log_error("{}: {}", files[i], err.what());
+      }
+      ret = EXIT_FAILURE;
+      continue;
+    }
+
+    std::cout << "== " << files[i] << " ==\n";
+    results[i]->print(std::cout);
+    std::cout << std::endl;
+    total.merge(*results[i]);
+  }
+
+  if (files.size() > 1) {
+    std::cout << "== total ==\n";
+    total.print(std::cout);
+    std::cout << std::endl;
+  }
+
+  return ret;
+}
+
+int export_samples(std::vector<std::string> const& args)
+{
+  if (args.size() != 2) {
+    throw std::runtime_error("export requires INPUT and OUTPUT");
+  }
+
+  std::string const& output = args[1];
+  bool const csv = output.size() >= 4 && output.compare(output.size() - 4, 4, ".csv") == 0;
+
+  Stats const stats = csv ? export_csv(args[0], output) : export_columns(args[0], output);
+
+  std::ostringstream os;
+  os << stats;
+  log_info("{}: {}", output, os.str());
+  return EXIT_SUCCESS;
+}
+
+/** Valid reports packed back to back, from a file or random bytes with
+    the constant bytes fixed up */
+std::vector<uint8_t> load_bench_reports(std::vector<std::string> const& args)
+{
+  std::vector<uint8_t> reports;
+
+  if (!args.empty())
+  {
+    std::unique_ptr<ReportReader> reader = open_report_reader(args[0]);
+    CaptureRecord record;
+    while (reader->next(record)) {
+      if (UDrawDecoder::validate(record.data, record.size) == UDrawDecoder::Error::NONE) {
+        reports.insert(reports.end(), record.data, record.data + UDrawDecoder::REPORT_SIZE);
+      }
+    }
+  }
+  else
+  {
+    size_t const count = 1 << 20;
+    std::mt19937 rng(1);
+    reports.resize(count * UDrawDecoder::REPORT_SIZE);
+    for (uint8_t& byte : reports) {
+      byte = static_cast<uint8_t>(rng());
+    }
+    for (size_t i = 0; i < count; ++i) {
+      uint8_t* const report = reports.data() + i * UDrawDecoder::REPORT_SIZE;
+      memcpy(report + Ps3Layout::HEADER, &Ps3Layout::HEADER_VALUE, sizeof(Ps3Layout::HEADER_VALUE));
+      report[Ps3Layout::TRAILER] = Ps3Layout::TRAILER_VALUE;
+    }
+  }
+
+  return reports;
+}
+
+int bench(std::vector<std::string> const& args)
+{
+  std::vector<uint8_t> const reports = load_bench_reports(args);
+  size_t const count = reports.size() / UDrawDecoder::REPORT_SIZE;
+  if (count == 0) {
+    throw std::runtime_error("no valid reports to benchmark");
+  }
+
+  std::vector<BatchDecoderImpl> const impls = batch_decoders();
+  auto expected = std::make_unique<SampleBatch>();
+  auto batch = std::make_unique<SampleBatch>();
+
+  std::cout << fmt::format("{} reports, {} bytes\n", count, reports.size());
+
+  double scalar_rate = 0.0;
+  int ret = EXIT_SUCCESS;
+  for (BatchDecoderImpl const& impl : impls)
+  {
+    // compare every batch against the reference decoder
+    for (size_t i = 0; i < count; i += SampleBatch::CAPACITY) {
+      size_t const n = std::min(SampleBatch::CAPACITY, count - i);
+      uint8_t const* const data = reports.data() + i * UDrawDecoder::REPORT_SIZE;
+      decode_batch_scalar(data, n, *expected);
+      impl.decode(data, n, *batch);
+
+      for (int col = SampleBatch::MODE; col < SampleBatch::COLUMN_COUNT; ++col) {
+        auto const column = static_cast<SampleBatch::Column>(col);
+        if (batch->size != n ||
+            memcmp(batch->column(column), expected->column(column), n * SampleBatch::element_size(column)) != 0) {
+          log_error("{}: column {} differs from the scalar decoder in reports {}-{}", impl.name, col, i, i + n);
+          ret = EXIT_FAILURE;
+          break;
+        }
+      }
+    }
+
+    // best of several runs to keep scheduling noise out
+    double best = 0.0;
+    for (int run = 0; run < 5; ++run) {
+      auto const start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < count; i += SampleBatch::CAPACITY) {
+        impl.decode(reports.data() + i * UDrawDecoder::REPORT_SIZE,
+                    std::min(SampleBatch::CAPACITY, count - i), *batch);
+      }
+      std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+      best = std::max(best, static_cast<double>(count) / elapsed.count());
+    }
+
+    if (scalar_rate == 0.0) {
+      scalar_rate = best;
+    }
+
+    std::cout << fmt::format("{:<8} {:8.1f} Mreports/s {:8.1f} MB/s {:6.2f}x\n",
+                             impl.name, best / 1e6,
+                             best * UDrawDecoder::REPORT_SIZE / 1e6,
+                             best / scalar_rate);
+  }
+
+  return ret;
+}
+
+/** Correlates the samples published by the driver with the events on
+    its evdev node: every SYN_REPORT is matched with the newest sample
+    received before it. Events emitted from timers, like kinetic
+    scrolling, are not caused by a report and count as outliers. */
+int latency(std::vector<std::string> const& args)
+{
+  if (args.size() < 2 || args.size() > 3) {
+    throw std::runtime_error("latency requires SHM and EVDEV");
+  }
+  size_t const count = args.size() == 3 ? std::stoul(args[2]) : 1000;
+
+  SampleRingReader ring(args[0]);
+  ring.seek_to_end();
+
+  int const fd = open(args[1].c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error(fmt::format("{}: {}", args[1], strerror(errno)));
+  }
+
+  // sample timestamps are CLOCK_MONOTONIC, evdev defaults to realtime
+  int clock = CLOCK_MONOTONIC;
+  if (ioctl(fd, EVIOCSCLOCKID, &clock) < 0) {
+    close(fd);
+    throw std::runtime_error(fmt::format("{}: EVIOCSCLOCKID failed: {}", args[1], strerror(errno)));
+  }
+
+  std::cout << fmt::format("waiting for {} events on {}\n", count, args[1]) << std::flush;
+
+  std::vector<int64_t> latencies;
+  std::vector<Sample> samples(256);
+  std::vector<int64_t> recent;
+  while (latencies.size() < count)
+  {
+    input_event ev;
+    ssize_t const ret = read(fd, &ev, sizeof(ev));
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    } else if (ret != sizeof(ev)) {
+      close(fd);
+      throw std::runtime_error(fmt::format("{}: read failed: {}", args[1], strerror(errno)));
+    }
+
+    if (ev.type != EV_SYN || ev.code != SYN_REPORT) {
+      continue;
+    }
+
+    int64_t const event_time = int64_t(ev.input_event_sec) * 1000000000 + int64_t(ev.input_event_usec) * 1000;
+
+    for (size_t n; (n = ring.poll(samples.data(), samples.size())) != 0;) {
+      for (size_t i = 0; i < n; ++i) {
+        recent.push_back(samples[i].timestamp);
+      }
+    }
+
+    // the newest sample that is not newer than the event caused it
+    auto const it = std::upper_bound(recent.begin(), recent.end(), event_time);
+    if (it != recent.begin()) {
+      latencies.push_back(event_time - *(it - 1));
+      recent.erase(recent.begin(), it - 1);
+    }
+  }
+  close(fd);
+
+  std::sort(latencies.begin(), latencies.end());
+  auto const pct = [&latencies](double p) {
+    size_t const idx = std::min(latencies.size() - 1, static_cast<size_t>(p / 100.0 * static_cast<double>(latencies.size())));
+    return static_cast<double>(latencies[idx]) / 1000.0;
+  };
+
+  // evdev timestamps have microsecond resolution
+  std::cout << fmt::format("latency (us): min {:.0f}  p50 {:.0f}  p90 {:.0f}  p99 {:.0f}  max {:.0f}\n",
+                           pct(0.0), pct(50.0), pct(90.0), pct(99.0), pct(100.0));
+  if (ring.lost() != 0) {
+    std::cout << fmt::format("lost samples: {}\n", ring.lost());
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int generate(std::vector<std::string> const& args)
+{
+  ReportGenerator::Pattern pattern = ReportGenerator::Pattern::MIXED;
+  double rate = 100.0;
+  uint64_t count = 10000;
+  uint32_t seed = 1;
+  std::string output;
+
+  for (size_t i = 0; i < args.size(); ++i)
+  {
+    auto next_arg = [&]() -> std::string const& {
+      if (i + 1 >= args.size()) {
+        throw std::runtime_error(fmt::format("{} requires an argument", args[i]));
+      }
+      return args[++i];
+    };
+
+    if (args[i] == "--pattern") {
+      pattern = ReportGenerator::pattern_from_string(next_arg());
+    } else if (args[i] == "--rate") {
+      rate = std::stod(next_arg());
+    } else if (args[i] == "--count") {
+      count = std::stoull(next_arg());
+    } else if (args[i] == "--seed") {
+      seed = static_cast<uint32_t>(std::stoul(next_arg()));
+    } else if (output.empty() && args[i][0] != '-') {
+      output = args[i];
+    } else {
+      throw std::runtime_error(fmt::format("unknown argument: {}", args[i]));
+    }
+  }
+
+  if (output.empty()) {
+    throw std::runtime_error("generate requires OUTPUT");
+  }
+  if (rate <= 0.0 || count == 0) {
+    throw std::runtime_error("generate requires a positive --rate and --count");
+  }
+
+  ReportGenerator generator(pattern, rate, count, seed);
+  CaptureWriter writer(output);
+
+  CaptureRecord record;
+  while (generator.next(record)) {
+    writer.write(record.timestamp, record.data, record.size);
+  }
+  writer.close();
+
+  log_info("{}: wrote {} reports", output, count);
+  return EXIT_SUCCESS;
+}
+
+int run(int argc, char** argv)
+{
+  std::string command;
+  std::vector<std::string> args;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    if (strcmp("-h", argv[i]) == 0 || strcmp("--help", argv[i]) == 0) {
+      print_help(argv[0]);
+      return EXIT_SUCCESS;
+    } else if (strcmp("-v", argv[i]) == 0 || strcmp("--verbose", argv[i]) == 0) {
+      logmich::g_logger.set_log_level(logmich::LogLevel::DEBUG);
+    } else if (!command.empty()) {
+      // everything after the command belongs to it
+      args.emplace_back(argv[i]);
+    } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      throw std::runtime_error(fmt::format("unknown option: {}", argv[i]));
+    } else {
+      command = argv[i];
+    }
+  }
+
+  if (command == "convert") {
+    return convert(args);
+  } else if (command == "analyze") {
+    return analyze(args);
+  } else if (command == "export") {
+    return export_samples(args);
+  } else if (command == "bench") {
+    return bench(args);
+  } else if (command == "latency") {
+    return latency(args);
+  } else if (command == "generate") {
+    return generate(args);
+  } else if (command.empty()) {
+    print_help(argv[0]);
+    return EXIT_FAILURE;
+  } else {
+    throw std::runtime_error(fmt::format("unknown command: {}", command));
+  }
+}
+
+} // namespace
+} // namespace udraw
+
+int main(int argc, char** argv) try
+{
+  return udraw::run(argc, argv);
+} catch (std::exception const& err) {
+  log_error("exception: {}", err.what());
+  return EXIT_FAILURE;
+}
+
+/* EOF */